@@ -21,14 +21,367 @@
 
 #include "SamInc.h"
 
+StrsSetTag AtcOkErrSet = STRSSET_DEF("OK\r\n\tERROR\r\n");
+
+//state below lives in the current SamCtx
+#define AtcWakeMs	(SamCtxCur()->wakems)	//earliest deadline noted since the last query
+#define AtcWakeRun	(SamCtxCur()->wakerun)	//passes still to run at once after an event
+#define ATCWAKE_PASSES	3		//let units reacting to each other's flags settle
+
+#if SAM_CFG_ATCSTAT_ENABLED || SAM_CFG_ATCRTO_ENABLED
+//Verb a command segment starts with, e.g. "AT+CIPSEND=", "AT+CPSI?"
+static void SamAtcVerbCopy(char * verb, uint8 vmax, char * cmdstr, uint16 len)
+{
+	uint8 n;
+	for(n = 0; n < len && n < vmax - 1; n++)
+	{
+		if(cmdstr[n] == 0x0D || cmdstr[n] == ';') break;
+		verb[n] = cmdstr[n];
+		if(cmdstr[n] == '=' || cmdstr[n] == '?')
+		{//keep set/read forms apart
+			n++;
+			break;
+		}
+	}
+	verb[n] = 0;
+}
+#endif
+
+#if SAM_CFG_ATCSTAT_ENABLED
+#define AtcStat		(SamCtxCur()->stat)
+#define AtcStatCnt	(SamCtxCur()->statcnt)
+
+//Entry of the verb a command segment starts with, the last one is "*" for the overflow
+static uint8 SamAtcStatVerb(char * cmdstr, uint16 len)
+{
+	char verb[sizeof(AtcStat[0].verb)];
+	uint8 i;
+	SamAtcVerbCopy(verb, sizeof(verb), cmdstr, len);
+	for(i = 0; i < AtcStatCnt; i++)
+	{
+		if(strcmp(AtcStat[i].verb, verb) == 0) return(i);
+	}
+	if(AtcStatCnt >= SAM_ATCSTAT_VERB_NUM - 1)
+	{//no verb ever takes the last entry, so none shares its counts with the overflow
+		i = SAM_ATCSTAT_VERB_NUM - 1;
+		if(AtcStatCnt < SAM_ATCSTAT_VERB_NUM)
+		{
+			memset(&AtcStat[i], 0, sizeof(AtcStat[0]));
+			strcpy(AtcStat[i].verb, "*");
+			AtcStatCnt++;
+		}
+		return(i);
+	}
+	memset(&AtcStat[i], 0, sizeof(AtcStat[0]));
+	strcpy(AtcStat[i].verb, verb);
+	AtcStatCnt++;
+	return(i);
+}
+
+//Close the open segment of a channel with its final result
+static void SamAtcStatEnd(HdsAtcTag * phatc, uint8 ret)
+{
+	AtcStatTag * pst;
+	uint32 ms;
+	uint8 b;
+	if(phatc->statid == ATCSTAT_NONE) return;
+	pst = &AtcStat[phatc->statid];
+	phatc->statid = ATCSTAT_NONE;
+	if(ret == OVERTIME_ATCRET)
+	{
+		pst->tmocnt++;
+		return;
+	}
+	if(ret == RETCHAR_TRUE) pst->cnt++;
+	else pst->errcnt++;
+	ms = SamGetMsCnt(phatc->statclk);
+	pst->summs += ms;
+	if(ms > pst->maxms) pst->maxms = ms;
+	for(b = 0; b < ATCSTAT_HBKT - 1 && ms != 0; b++, ms >>= 1);
+	if(pst->hist[b] != 0xFFFF) pst->hist[b]++;
+}
+
+//Final result codes end the open segment
+static void SamAtcStatLine(HdsAtcTag * phatc, char * line, uint16 len)
+{
+	if(phatc->statid == ATCSTAT_NONE) return;
+	AtcStat[phatc->statid].rxbytes += len;
+	if(strcmp(line, "OK\r\n") == 0)
+	{
+		SamAtcStatEnd(phatc, RETCHAR_TRUE);
+	}
+	else if(strncmp(line, "ERROR", 5) == 0 || strncmp(line, "+CME ERROR", 10) == 0 || strncmp(line, "+CMS ERROR", 10) == 0)
+	{
+		SamAtcStatEnd(phatc, RETCHAR_FALSE);
+	}
+}
+#endif
+
+#if SAM_CFG_ATCRTO_ENABLED
+#define AtcRto		(SamCtxCur()->rto)
+#define AtcRtoCnt	(SamCtxCur()->rtocnt)
+
+//Take the latency of the last expected string of the closed segment as a sample
+static void SamAtcRtoCommit(HdsAtcTag * phatc)
+{
+	AtcRtoTag * prto;
+	uint32 r, e;
+	if(phatc->rtoid == ATCRTO_NONE) return;
+	prto = &AtcRto[phatc->rtoid];
+	phatc->rtoid = ATCRTO_NONE;
+	if(phatc->rtoms == ATCRTO_NOSMP) return;
+	r = phatc->rtoms;
+	if(prto->nsmp == 0)
+	{//RFC 6298 first measurement
+		prto->srtt = r;
+		prto->rttvar = r / 2;
+	}
+	else
+	{
+		e = (prto->srtt > r) ? prto->srtt - r : r - prto->srtt;
+		prto->rttvar = (3 * prto->rttvar + e) / 4;
+		prto->srtt = (7 * prto->srtt + r) / 8;
+	}
+	if(prto->nsmp != 0xFF) prto->nsmp++;
+	prto->boff = 0;
+}
+
+//Timeout of a verb in ms, 0 while too few samples
+static uint32 SamAtcRtoCalc(AtcRtoTag * prto)
+{
+	uint32 n;
+	if(prto->nsmp < SAM_ATCRTO_LEARN) return(0);
+	n = prto->srtt + 4 * prto->rttvar;
+	if(n < SAM_ATCRTO_MIN_MS) n = SAM_ATCRTO_MIN_MS;
+	return(n << prto->boff);
+}
+
+//Open the segment of an adaptive command and shorten its wait to the learned timeout
+static void SamAtcRtoArm(HdsAtcTag * phatc, char * cmdstr, uint16 len)
+{
+	char verb[sizeof(AtcRto[0].verb)];
+	uint32 n;
+	uint8 i;
+	if((phatc->type & ARTO_HATCTYP) == 0 || phatc->rtocap == STOP_HATCTMW) return;
+#if SAM_CFG_ATCCOAL_ENABLED
+	if(phatc->coalbp != ATCCOAL_NONE) return;	//a merged line is no sample of its first verb
+#endif
+	SamAtcVerbCopy(verb, sizeof(verb), cmdstr, len);
+	for(i = 0; i < AtcRtoCnt; i++)
+	{
+		if(strcmp(AtcRto[i].verb, verb) == 0) break;
+	}
+	if(i == AtcRtoCnt)
+	{
+		if(AtcRtoCnt >= SAM_ATCRTO_VERB_NUM) return;	//table full: the caller's wait time applies
+		memset(&AtcRto[i], 0, sizeof(AtcRto[0]));
+		strcpy(AtcRto[i].verb, verb);
+		AtcRtoCnt++;
+	}
+	phatc->rtoid = i;
+	phatc->rtoms = ATCRTO_NOSMP;
+	phatc->waitret = phatc->rtocap;
+	n = (SamAtcRtoCalc(&AtcRto[i]) + 7) / 8;
+	if(n != 0 && n < phatc->waitret) phatc->waitret = n;
+}
+
+//The caller matched an expected string, the latest one times the segment
+static void SamAtcRtoSeen(HdsAtcTag * phatc)
+{
+	if(phatc->rtoid != ATCRTO_NONE) phatc->rtoms = SamGetMsCnt(phatc->msclk);
+}
+
+//Timed out: back off the verb like a TCP retransmission timer, no sample
+static void SamAtcRtoExpire(HdsAtcTag * phatc)
+{
+	if(phatc->rtoid == ATCRTO_NONE) return;
+	if(AtcRto[phatc->rtoid].boff < ATCRTO_BOFFMAX) AtcRto[phatc->rtoid].boff++;
+	phatc->rtoid = ATCRTO_NONE;
+}
+#endif
+
+#if SAM_CFG_ATCCOAL_ENABLED
+//Commands never merged: data prompts, long or state changing actions, URC answered ones
+static const char * const AtcCoalDeny[] = {
+	"+CFUN", "+CRESET", "+CPOWD", "+COPS", "+CGACT", "+CGATT=", "+CMUX", "+IPR",
+	"+NETOPEN", "+NETCLOSE", "+CIPOPEN", "+CIPCLOSE", "+CIPSEND", "+CIPRXGET",
+	"+CMGS", "+CMGW", "+CMQTT", "+HTTP", "+CFTP", "+CTTS", "+CCMXPLAY", "+CFOTA",
+};
+
+//A command segment of len bytes may go into a merged line, basic ones only in front
+static uint8 SamAtcCoalOk(char * sp, uint16 len, uint8 first)
+{
+	uint8 i;
+	if(len < 3 || sp[0] != 'A' || sp[1] != 'T') return(RETCHAR_FALSE);	//also the bare AT sync
+	if(sp[2] != '+')
+	{
+		if(first == 0 || strchr("DAHOZ", sp[2]) != NULL) return(RETCHAR_FALSE);
+		if(sp[2] == '&' && (sp[3] == 'F' || sp[3] == 'W')) return(RETCHAR_FALSE);
+		return(RETCHAR_TRUE);
+	}
+	for(i = 0; i < sizeof(AtcCoalDeny) / sizeof(AtcCoalDeny[0]); i++)
+	{
+		if(strncmp(&sp[2], AtcCoalDeny[i], strlen(AtcCoalDeny[i])) == 0) return(RETCHAR_FALSE);
+	}
+	return(RETCHAR_TRUE);
+}
+
+//Merge the segment at cmdstr and the mergeable ones behind it into coalbuf with ';'.
+//RETCHAR_TRUE if two or more went in, *padv is then the atcbuf length they take.
+static uint8 SamAtcCoalMerge(HdsAtcTag * phat, char * cmdstr, uint16 * padv)
+{
+	char * sp;
+	uint16 n, k, adv;
+	uint8 cnt;
+	n = *padv - 1;
+	if(SamAtcCoalOk(cmdstr, n, 1) != RETCHAR_TRUE || n > ATCCOAL_LINEMAX) return(RETCHAR_FALSE);
+	memcpy(phat->coalbuf, cmdstr, n);
+	adv = *padv;
+	sp = &cmdstr[adv];
+	for(cnt = 1; ; cnt++)
+	{
+		for(k = 0; sp[k] != 0x0D && sp[k] != 0x00; k++);
+		if(SamAtcCoalOk(sp, k, 0) != RETCHAR_TRUE || n + 1 + (k - 2) > ATCCOAL_LINEMAX) break;
+		phat->coalbuf[n++] = ';';
+		memcpy(&(phat->coalbuf[n]), &sp[2], k - 2);	//"AT+X" goes in as ";+X"
+		n += k - 2;
+		if(sp[k] == 0x0D) k++;
+		adv += k;
+		sp += k;
+	}
+	if(cnt < 2) return(RETCHAR_FALSE);
+	phat->coalbuf[n++] = 0x0D;
+	phat->coalbuf[n] = 0x00;
+	phat->coalcnt = cnt;
+	*padv = adv;
+	return(RETCHAR_TRUE);
+}
+
+//Final result of a merged line: OK ends it, an error resends its commands one by one
+static uint8 SamAtcCoalLine(HdsAtcTag * phatc)
+{
+	char * line = phatc->retbuf;
+	if(strcmp(line, "OK\r\n") == 0)
+	{
+		phatc->coalbp = ATCCOAL_NONE;
+	}
+	else if(strncmp(line, "ERROR", 5) == 0 || strncmp(line, "+CME ERROR", 10) == 0 || strncmp(line, "+CMS ERROR", 10) == 0)
+	{//the failing command is unknown and the ones behind it did not run: one by one,
+	 //its own result then goes to the unit as for an uncoalesced command
+		DebugTrace("Coalesced %u cmds failed, resend one by one\r\n", phatc->coalcnt);
+		phatc->atcbp = phatc->coalbp;
+		phatc->coalbp = ATCCOAL_NONE;
+		phatc->coaloff = 1;
+		SamSendAtSeg(phatc);
+		return(RETCHAR_TRUE);
+	}
+	return(RETCHAR_FALSE);
+}
+#endif
+
+//Channel io, CMUX DLCs have virtual com ids; returns the bytes the port took
+static uint16 SamComSendV(uint8 comid, SamIovTag * iov, uint8 cnt)
+{
+	uint16 n, k;
+	uint8 i;
+#if SAM_CFG_CMUX_ENABLED
+	if(CMUXCH_IS(comid))
+	{
+		for(n = 0, i = 0; i < cnt; i++)
+		{
+			k = SamCmuxWrite(comid, iov[i].dp, iov[i].len);
+			n += k;
+			if(k < iov[i].len) break;
+		}
+		return(n);
+	}
+#endif
+#if SAM_CFG_COMV_ENABLED
+	(void)i;
+	(void)k;
+	n = SendtoComV(comid, iov, cnt);
+#else
+	for(n = 0, i = 0; i < cnt; i++)
+	{
+		if(iov[i].len == 0) continue;
+		k = SendtoCom(comid, iov[i].dp, iov[i].len);
+		n += k;
+		if(k < iov[i].len) break;	//port is full, the rest waits for the next pump
+	}
+#endif
+	return(n);
+}
+
+//Push queued bytes to the port, RETCHAR_TRUE once none is pending any more
+static uint8 SamAtcTxPump(HdsAtcTag * phatc)
+{
+	SamIovTag * piov;
+	uint16 n, k;
+	if(phatc->txqn == 0) return(RETCHAR_TRUE);
+	n = SamComSendV(phatc->comid, &(phatc->txq[phatc->txqh]), phatc->txqn);
+	if(n != 0) phatc->txclk = SamGetMsCnt(0);
+	while(phatc->txqn != 0)
+	{
+		piov = &(phatc->txq[phatc->txqh]);
+		k = (n < piov->len) ? n : piov->len;
+		piov->dp += k;
+		piov->len -= k;
+		n -= k;
+		if(piov->len != 0) break;
+		phatc->txqh++;
+		phatc->txqn--;
+	}
+	if(phatc->txqn != 0)
+	{
+		if(SamGetMsCnt(phatc->txclk) < ATCTXQ_TMOUT) return(RETCHAR_FALSE);
+		DebugTrace("OT[%u]TxFrags\r\n", phatc->txqn);
+		phatc->txqn = 0;
+	}
+	phatc->txqh = 0;
+	phatc->msclk = SamGetMsCnt(0);	//the response time starts with the last byte out
+	AtcWakeRun = ATCWAKE_PASSES;
+	return(RETCHAR_TRUE);
+}
+
+//Queue fragments behind the pending ones and send what the port takes now
+static void SamAtcTxPut(HdsAtcTag * phatc, SamIovTag * iov, uint8 cnt)
+{
+	uint8 i;
+	if(phatc->txqh + phatc->txqn + cnt > ATCTXQ_MAX)
+	{
+		memmove(phatc->txq, &(phatc->txq[phatc->txqh]), phatc->txqn * sizeof(SamIovTag));
+		phatc->txqh = 0;
+	}
+	for(i = 0; i < cnt && phatc->txqn < ATCTXQ_MAX; i++)
+	{
+		if(iov[i].len == 0) continue;
+		phatc->txq[phatc->txqh + phatc->txqn] = iov[i];
+		phatc->txqn++;
+	}
+	if(i < cnt) DebugTrace("TX queue full, %u frags dropped\r\n", cnt - i);
+	phatc->txclk = SamGetMsCnt(0);
+	SamAtcTxPump(phatc);
+}
+
+static uint16 SamComRead(uint8 comid, char * dp, uint16 dmax)
+{
+#if SAM_CFG_CMUX_ENABLED
+	if(CMUXCH_IS(comid)) return(SamCmuxRead(comid, dp, dmax));
+#endif
+	return(ReadfoCom(comid, dp, dmax));
+}
 
 void SamSendAtSeg(HdsAtcTag * phat)
 { 
 	char disbuf[256];
 	char * cmdstr;
-	uint16 i, m;
+	SamIovTag iov;
+	uint16 i, m, adv;
 	cmdstr = (char *)&(phat->atcbuf[phat->atcbp]);
 	if(cmdstr[0] == 0x00 || cmdstr[0] == 0x0D) return;
+#if SAM_CFG_ATCRTO_ENABLED
+	SamAtcRtoCommit(phat);
+#endif
 	i = 0;
 	while(cmdstr[i] != 0x0D && cmdstr[i] != 0x00) i++;
 	if(cmdstr[i] == 0)
@@ -39,7 +392,18 @@ void SamSendAtSeg(HdsAtcTag * phat)
 	{
 		i++;
 	}
-	phat->atcbp += i;
+	adv = i;
+	phat->segbp = phat->atcbp;
+#if SAM_CFG_ATCCOAL_ENABLED
+	phat->coalbp = ATCCOAL_NONE;
+	if((phat->type & COAL_HATCTYP) != 0 && phat->coaloff == 0 && SamAtcCoalMerge(phat, cmdstr, &adv) == RETCHAR_TRUE)
+	{
+		phat->coalbp = phat->atcbp;
+		cmdstr = phat->coalbuf;
+		i = strlen(cmdstr);
+	}
+#endif
+	phat->atcbp += adv;
 	phat->state = SCMD_HATCSTA;
 	if(phat->atcbuf[phat->atcbp] == 0)
 	{
@@ -60,7 +424,17 @@ void SamSendAtSeg(HdsAtcTag * phat)
 	}
     else
     {
-        SendtoCom(phat->comid, cmdstr, i);
+		iov.dp = cmdstr;
+		iov.len = i;
+		SamAtcTxPut(phat, &iov, 1);
+#if SAM_CFG_ATCSTAT_ENABLED
+		phat->statid = SamAtcStatVerb(cmdstr, i);	//a segment left open is not accounted
+		phat->statclk = SamGetMsCnt(0);
+		AtcStat[phat->statid].txbytes += i;
+#endif
+#if SAM_CFG_ATCRTO_ENABLED
+		SamAtcRtoArm(phat, cmdstr, i);
+#endif
 	    if(i>255) i = 255;
 	    memcpy(disbuf, cmdstr, i);
 	    disbuf[i] = 0;
@@ -78,12 +452,23 @@ uint8 SamSendAtCmd(HdsAtcTag * phatc, char * cmdstr, uint8 type, uint8 timwm)
 	{//
 		return(RETCHAR_FALSE);
 	}
+#if SAM_CFG_ATCRTO_ENABLED
+	SamAtcRtoCommit(phatc);	//before late lines of the previous command are flushed
+#endif
+	if(phatc->txqn != 0)
+	{//atcbuf is reused, bytes of the previous command still pointing into it are dropped
+		DebugTrace("TX %u frags of the previous command dropped\r\n", phatc->txqn);
+		phatc->txqn = 0;
+		phatc->txqh = 0;
+	}
 	
 	do{
-		ret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n");
+		ret = SamChkAtcSet(phatc, &AtcOkErrSet);
 		if(ret == RETURNSR_ATCRET) phatc->retbufp = 0;
 	}while(ret!= NOSTRRET_ATCRET);
 	
+	phatc->dataiovn = phatc->dataiovc;	//fragments set for this command
+	phatc->dataiovc = 0;
 	phatc->atcbuf[0] = 0;
 	strcpy(phatc->atcbuf, cmdstr);
 	phatc->atcbp = 0;
@@ -98,6 +483,12 @@ uint8 SamSendAtCmd(HdsAtcTag * phatc, char * cmdstr, uint8 type, uint8 timwm)
 			phatc->waitret = timwm;  //timwm  : 1024 mS
 			phatc->waitret *= 128;  // timm :  U_8ms
 		}
+#if SAM_CFG_ATCRTO_ENABLED
+		phatc->rtocap = phatc->waitret;
+#endif
+#if SAM_CFG_ATCCOAL_ENABLED
+		phatc->coaloff = 0;
+#endif
 
 		phatc->type = type;
 		SamSendAtSeg(phatc);
@@ -110,120 +501,382 @@ uint8 SamSendAtCmd(HdsAtcTag * phatc, char * cmdstr, uint8 type, uint8 timwm)
 
 
 
+//Refill the staging block with one ReadfoCom call once it is used up
+static uint16 SamAtcRxFill(HdsAtcTag * phatc)
+{
+	uint16 n;
+	if(phatc->rxbufh < phatc->rxbuft)
+	{
+		return(phatc->rxbuft - phatc->rxbufh);
+	}
+	n = SamComRead(phatc->comid, phatc->rxbuf, ATRXBUFLEN);
+	if(n > ATRXBUFLEN) n = 0;
+	phatc->rxbufh = 0;
+	phatc->rxbuft = n;
+	return(n);
+}
+
+//Slots interested in a URC line: owners of every declared prefix it starts with,
+//plus the slots which declared no prefix at all
+static uint16 SamAtcUrcRoute(HdsAtcTag * phatc, char * ustr)
+{
+	uint16 m;
+	uint8 nd;
+	m = phatc->bcmsk & ~(phatc->urcmsk);
+	if(phatc->urcmsk == 0) return(m);
+	nd = 0;
+	for(; *ustr != 0; ustr++)
+	{
+		for(nd = phatc->urcnode[nd].child; nd != 0 && phatc->urcnode[nd].ch != *ustr; nd = phatc->urcnode[nd].next);
+		if(nd == 0) break;
+		m |= phatc->urcnode[nd].fmsk;
+	}
+	return(m);
+}
+
 uint8 SamChkAtcRet(HdsAtcTag * phatc, char * efsm)
+{
+	StrsSetTag eset;
+	eset.exps = efsm;
+	eset.built = 0;		//compiled only when a frame has to be matched
+	return(SamChkAtcSet(phatc, &eset));
+}
+
+//Data phase at the prompt: fragments in place, else databuf
+static uint8 SamAtcSendData(HdsAtcTag * phatc)
+{
+	SamIovTag iov;
+	uint16 n;
+	uint8 i;
+	if(phatc->dataiovn != 0)
+	{
+		for(n = 0, i = 0; i < phatc->dataiovn; i++) n += phatc->dataiov[i].len;
+		SamAtcTxPut(phatc, phatc->dataiov, phatc->dataiovn);
+		phatc->dataiovn = 0;
+	}
+	else if(phatc->databufp != ATCRDATAPT_VMAX && phatc->databuf != NULL)
+	{
+		n = phatc->databufp;
+		iov.dp = phatc->databuf;
+		iov.len = n;
+		SamAtcTxPut(phatc, &iov, 1);
+	}
+	else
+	{
+		return(RETCHAR_FALSE);
+	}
+#if SAM_CFG_ATCSTAT_ENABLED
+	if(phatc->statid != ATCSTAT_NONE) AtcStat[phatc->statid].txbytes += n;
+#endif
+	DebugTrace("SM[%u]Bytes\r\n", n);
+	return(RETCHAR_TRUE);
+}
+
+//Line announcing a length-framed payload: arm counted-byte mode for its rule
+static void SamAtcBinStart(HdsAtcTag * phatc)
+{
+	AtcBinRuleTag * prule;
+	char * sp;
+	uint16 n;
+	uint8 f;
+	for(prule = phatc->binhd; prule != NULL; prule = prule->next)
+	{
+		n = (uint16)strlen(prule->head);
+		if(strncmp(phatc->retbuf, prule->head, n) == 0) break;
+	}
+	if(prule == NULL) return;
+	sp = &(phatc->retbuf[n]);
+	for(f = prule->lfld; f != 0 && sp != NULL; f--)
+	{
+		sp = strchr(sp, ',');
+		if(sp != NULL) sp++;
+	}
+	if(sp == NULL || *sp < '0' || *sp > '9') return;
+	for(n = 0; *sp >= '0' && *sp <= '9'; sp++)
+	{
+		n = n*10 + (*sp - '0');
+	}
+	if(n == 0)
+	{
+		prule->psink(prule->pd, phatc->retbuf, 0, 0);
+		return;
+	}
+	phatc->pbin = prule;
+	phatc->binlen = n;
+	phatc->binrest = n;
+	phatc->binclk = SamGetMsCnt(0);
+}
+
+//Hand arrived payload bytes to the sink, RETCHAR_TRUE when none is pending any more
+static uint8 SamAtcBinDrain(HdsAtcTag * phatc)
+{
+	AtcBinRuleTag * prule = phatc->pbin;	//NULL: owner unlinked, bytes are dropped
+	char * sp;
+	uint16 n;
+	while(phatc->binrest != 0 && SamAtcRxFill(phatc) != 0)
+	{
+		sp = &(phatc->rxbuf[phatc->rxbufh]);
+		n = phatc->rxbuft - phatc->rxbufh;
+		if(n > phatc->binrest) n = phatc->binrest;
+		phatc->rxbufh += n;
+		phatc->binrest -= n;
+		phatc->binclk = SamGetMsCnt(0);
+#if SAM_CFG_ATCSTAT_ENABLED
+		if(phatc->statid != ATCSTAT_NONE) AtcStat[phatc->statid].rxbytes += n;
+#endif
+		if(prule != NULL) prule->psink(prule->pd, sp, n, phatc->binrest);
+	}
+	if(phatc->binrest == 0)
+	{
+		DebugTrace("RM[%u]Bytes\r\n", phatc->binlen);
+	}
+	else if(SamGetMsCnt(phatc->binclk) >= ATCBIN_TMOUT)
+	{
+		DebugTrace("OT[%u]Bytes\r\n", phatc->binrest);
+		if(prule != NULL) prule->psink(prule->pd, NULL, 0, phatc->binrest);
+		phatc->binrest = 0;
+	}
+	else
+	{
+		return(RETCHAR_FALSE);
+	}
+	phatc->pbin = NULL;
+	AtcWakeRun = ATCWAKE_PASSES;
+	return(RETCHAR_TRUE);
+}
+
+//Append a response line of the active request to its rspbuf
+static void SamAtcReqRsp(AtcReqTag * preq, char * line)
+{
+	uint16 k;
+	if(preq->rspbuf == NULL || preq->rspmax == 0) return;
+	k = (uint16)strlen(line);
+	if(preq->rsplen + k >= preq->rspmax) k = preq->rspmax - 1 - preq->rsplen;
+	memcpy(&(preq->rspbuf[preq->rsplen]), line, k);
+	preq->rsplen += k;
+	preq->rspbuf[preq->rsplen] = 0;
+}
+
+//retbuf is full without a line end, pass it to the active request as a part
+static void SamAtcReqPart(HdsAtcTag * phatc)
+{
+	AtcReqTag * preq = phatc->preq;
+	phatc->retbuf[phatc->retbufp] = 0;
+	SamAtcReqRsp(preq, phatc->retbuf);
+	if(preq->pcb != NULL) preq->pcb(preq->pd, preq, PARTLINE_ATCRET, phatc->retbuf);
+	phatc->retbufp = 0;
+	phatc->retbuf[0] = 0;
+	phatc->reqpart = 1;
+}
+
+//A long line is the active request's own unless it has a "+XXX:" head none of the sent commands has
+static uint8 SamAtcReqOwns(HdsAtcTag * phatc)
+{
+	char * line = phatc->retbuf;
+	char * cmd;
+	uint16 n, p;
+	if(phatc->reqpart != 0 || line[0] != '+') return(RETCHAR_TRUE);
+	for(n = 1; n < phatc->retbufp && line[n] != ':'; n++);
+	if(n >= phatc->retbufp) return(RETCHAR_TRUE);
+	for(p = phatc->segbp; p < phatc->atcbp; p++)
+	{
+		cmd = &(phatc->atcbuf[p]);
+		if(p != phatc->segbp && cmd[-1] != 0x0D) continue;
+		if(strncmp(&cmd[2], line, n) == 0 && (cmd[2 + n] == '=' || cmd[2 + n] == '?' || cmd[2 + n] == 0x0D || cmd[2 + n] == 0)) return(RETCHAR_TRUE);
+	}
+	return(RETCHAR_FALSE);
+}
+
+uint8 SamChkAtcSet(HdsAtcTag * phatc, StrsSetTag * pset)
 {
 	uint32 clk, n;
+	uint16 m, k;
 	uint8  temp, t;
-	if((phatc->type & CRLF_HATCTYP) != 0)
+	char * sp;
+	if(phatc->txqn != 0) SamAtcTxPump(phatc);	//resume a partial write
+	if(phatc->binrest != 0 && SamAtcBinDrain(phatc) == RETCHAR_FALSE)
+	{
+		//payload still arriving, no line framing meanwhile
+	}
+	else if((phatc->type & CRLF_HATCTYP) != 0)
 	{
-		while(ReadfoCom(phatc->comid, (char *)&temp, 1) ==1)
+		while(SamAtcRxFill(phatc) != 0)
 		{
-			if((temp == 0x0D || temp == 0x0A) && phatc->retbufp == 0)
+			sp = &(phatc->rxbuf[phatc->rxbufh]);
+			n = phatc->rxbuft - phatc->rxbufh;
+			if(phatc->retbufp == 0 && phatc->reqpart == 0)
 			{
-				continue;
+				for(m = 0; m < n && (sp[m] == 0x0D || sp[m] == 0x0A); m++);
+				phatc->rxbufh += m;
+				if(m == n) continue;
+				sp += m;
+				n -= m;
+			}
+			//span of ordinary bytes up to the next frame delimiter of the current mode
+			if((phatc->type & (RHCD_HATCTYP|RISP_HATCTYP|RIGR_HATCTYP)) == 0)
+			{
+				char * ep = (char *)memchr(sp, 0x0A, n);
+				m = (ep == NULL) ? n : (uint16)(ep - sp);
+			}
+			else
+			{
+				for(m = 0; m < n; m++)
+				{
+					temp = sp[m];
+					if(temp == 0x0A) break;
+					if((phatc->type & RHCD_HATCTYP) != 0 && temp == ',') break;
+					if((phatc->type & RISP_HATCTYP) != 0 && temp == ' ') break;
+					if((phatc->type & RIGR_HATCTYP) != 0 && temp == '>') break;
+				}
 			}
-			else if(temp == 0x0A)
+			if(m != 0)
+			{
+				if(phatc->retbufp >= (ATRETBUFLEN -2) && phatc->preq != NULL && SamAtcReqOwns(phatc) == RETCHAR_TRUE)
+				{//a request gets its long lines in parts instead of cut
+					SamAtcReqPart(phatc);
+				}
+				k = 0;
+				if(phatc->retbufp < (ATRETBUFLEN -2))
+				{
+					k = (ATRETBUFLEN -2) - phatc->retbufp;
+					if(k > m) k = m;
+					memcpy(&(phatc->retbuf[phatc->retbufp]), sp, k);
+					phatc->retbufp += k;
+				}
+				if(k < m && phatc->preq != NULL && SamAtcReqOwns(phatc) == RETCHAR_TRUE)
+				{
+					phatc->rxbufh += k;
+					continue;
+				}
+				phatc->rxbufh += m;
+				if(m == n) continue;
+			}
+			temp = phatc->rxbuf[phatc->rxbufh++];
+			if(temp == 0x0A)
 			{
 				phatc->retbuf[phatc->retbufp++] = 0x0A;
 				phatc->retbuf[phatc->retbufp]  = 0x00;
-				temp = StrsCmp(phatc->retbuf, efsm);
+				AtcWakeRun = ATCWAKE_PASSES;	//units act on lines, run them again at once
+				if(phatc->reqpart != 0)
+				{//last part of a long line
+					phatc->reqpart = 0;
+					return(RETURNSR_ATCRET);
+				}
+#if SAM_CFG_ATCSTAT_ENABLED
+				SamAtcStatLine(phatc, phatc->retbuf, phatc->retbufp);
+#endif
+#if SAM_CFG_ATCCOAL_ENABLED
+				if(phatc->coalbp != ATCCOAL_NONE && SamAtcCoalLine(phatc) == RETCHAR_TRUE) return(NOSTRRET_ATCRET);
+#endif
+				if(phatc->binhd != NULL) SamAtcBinStart(phatc);
+				temp = StrsSetCmp(phatc->retbuf, pset);
 				DebugTrace("RM%u:%u:%u<%s",phatc->comid,temp,phatc->retbufp, phatc->retbuf);
 				if(temp != 0)
 				{
+#if SAM_CFG_ATCRTO_ENABLED
+					SamAtcRtoSeen(phatc);
+#endif
 					return(temp); //return the index of return string;
 				}
 				else
 				{
-					for(t = 0; t < MDMFUNARRAY_MAX; t++)
-					{
-						if(phatc->fun[t].pfunData != NULL && phatc->fun[t].pBcFun != NULL)
-						{
-							if(RETCHAR_NONE == phatc->fun[t].pBcFun(phatc->fun[t].pfunData, phatc->retbuf))
-							{
-								continue;
-							}
-							else
-							{
-								DebugTrace("Fun_URCBcF=%u:%s",phatc->retbufp, phatc->retbuf);
-								phatc->retbufp = 0;
-								return(NOSTRRET_ATCRET);
-							}
-						}								
-					}
-					if(t == MDMFUNARRAY_MAX)
+					m = SamAtcUrcRoute(phatc, phatc->retbuf);
+					for(t = 0; m != 0; t++, m >>= 1)
 					{
-						if(RETCHAR_NONE == phatc->MdmUrcBcFun(phatc->pMdmhost, phatc->retbuf))
+						if((m & 0x01) == 0 || phatc->fun[t].pfunData == NULL || phatc->fun[t].pBcFun == NULL)
 						{
-							return(RETURNSR_ATCRET);
+							continue;
 						}
-						else
+						if(RETCHAR_NONE != phatc->fun[t].pBcFun(phatc->fun[t].pfunData, phatc->retbuf))
 						{
-							DebugTrace("Mdm_URCBcF=%u:%s",phatc->retbufp, phatc->retbuf);
+							DebugTrace("Fun_URCBcF=%u:%s",phatc->retbufp, phatc->retbuf);
 							phatc->retbufp = 0;
 							return(NOSTRRET_ATCRET);
 						}
 					}
+					if(phatc->MdmUrcBcFun == NULL || RETCHAR_NONE == phatc->MdmUrcBcFun(phatc->pMdmhost, phatc->retbuf))
+					{
+						return(RETURNSR_ATCRET);
+					}
+					else
+					{
+						DebugTrace("Mdm_URCBcF=%u:%s",phatc->retbufp, phatc->retbuf);
+						phatc->retbufp = 0;
+						return(NOSTRRET_ATCRET);
+					}
 				}
 			}
-			else if((phatc->type & RHCD_HATCTYP) != 0 && temp == ',')
+			else if(temp == ',')
 			{//HEADSTR: 10,xxxxxxxxxx
 				phatc->retbuf[phatc->retbufp++] = ',';
 				phatc->retbuf[phatc->retbufp]  = 0x00;
-				temp = StrsCmp(phatc->retbuf, efsm);
+				temp = StrsSetCmp(phatc->retbuf, pset);
 				if(temp != 0)
 				{
 					DebugTrace("RM%u:%u:%u<%s",phatc->comid,temp, phatc->retbufp, phatc->retbuf);
+#if SAM_CFG_ATCRTO_ENABLED
+					SamAtcRtoSeen(phatc);
+#endif
+					AtcWakeRun = ATCWAKE_PASSES;
 					return(temp);
 				}
 			}
-			else if((phatc->type & RISP_HATCTYP) != 0 && temp == ' ')
+			else if(temp == ' ')
 			{//>  space....to send 
 				phatc->retbuf[phatc->retbufp++] = ' ';
 				phatc->retbuf[phatc->retbufp]  = 0x00;
-				temp = StrsCmp(phatc->retbuf, efsm);
-				if(temp != 0 && phatc->databufp != ATCRDATAPT_VMAX && phatc->databuf != NULL)
+				temp = StrsSetCmp(phatc->retbuf, pset);
+				if(temp != 0 && (phatc->dataiovn != 0 || (phatc->databufp != ATCRDATAPT_VMAX && phatc->databuf != NULL)))
 				{
-					SendtoCom(phatc->comid, phatc->databuf, phatc->databufp);
 					DebugTrace("RM[%02X]%u<%s\r\n",temp, phatc->retbufp, phatc->retbuf);
-        			DebugTrace("SM[%u]Bytes\r\n",phatc->databufp);
+					SamAtcSendData(phatc);
 					phatc->retbufp = 0;
 					phatc->retbuf[phatc->retbufp]  = 0x00;
 					phatc->msclk = SamGetMsCnt(0);
 					phatc->type &= ~RISP_HATCTYP;
 				}
 			}
-			else if((phatc->type & RIGR_HATCTYP) != 0 && temp == '>')
+			else
 			{//> Greater... 
 				phatc->retbuf[phatc->retbufp++] = '>';
 				phatc->retbuf[phatc->retbufp]  = 0x00;
-				temp = StrsCmp(phatc->retbuf, efsm);
-				if(temp != 0 && phatc->databufp != ATCRDATAPT_VMAX && phatc->databuf != NULL)
+				temp = StrsSetCmp(phatc->retbuf, pset);
+				if(temp != 0 && (phatc->dataiovn != 0 || (phatc->databufp != ATCRDATAPT_VMAX && phatc->databuf != NULL)))
 				{
-					SendtoCom(phatc->comid, phatc->databuf, phatc->databufp);
 					DebugTrace("RM[%02X]%u<%s\r\n",temp, phatc->retbufp, phatc->retbuf);
-        			DebugTrace("SM[%u]Bytes\r\n",phatc->databufp);
+					SamAtcSendData(phatc);
 					phatc->retbufp = 0;
 					phatc->retbuf[phatc->retbufp]  = 0x00;
 					phatc->msclk = SamGetMsCnt(0);
 					phatc->type &= ~RIGR_HATCTYP;
 				}
 			}
-			else if(phatc->retbufp < (ATRETBUFLEN -2))
-			{
-				phatc->retbuf[phatc->retbufp++] = temp;
-			}
 		}
 	}
 	else if(phatc->type == BCNT_HATCTYP && phatc->databufp != ATCRDATAPT_VMAX && phatc->databuf != NULL)
 	{
-		while(ReadfoCom(phatc->comid, (char *)&temp, 1) ==1)
+		while(phatc->retbufp < phatc->databufp)
 		{
-			phatc->databuf[phatc->retbufp++] = temp;
+			m = phatc->databufp - phatc->retbufp;
+			if(phatc->rxbufh < phatc->rxbuft)
+			{//staged bytes first
+				k = phatc->rxbuft - phatc->rxbufh;
+				if(k > m) k = m;
+				memcpy(&(phatc->databuf[phatc->retbufp]), &(phatc->rxbuf[phatc->rxbufh]), k);
+				phatc->rxbufh += k;
+			}
+			else
+			{
+				k = SamComRead(phatc->comid, &(phatc->databuf[phatc->retbufp]), m);
+				if(k == 0 || k > m) break;
+			}
+			phatc->retbufp += k;
 			if(phatc->retbufp >= phatc->databufp)
 			{
 				phatc->type &= ~BCNT_HATCTYP;
 				phatc->type |= CRLF_HATCTYP;
 				DebugTrace("RM[%u]Bytes\r\n", phatc->retbufp);
+				AtcWakeRun = ATCWAKE_PASSES;
 				return(RECVBCNT_ATCRET);
 			}
 		}
@@ -237,11 +890,12 @@ uint8 SamChkAtcRet(HdsAtcTag * phatc, char * efsm)
 		{
 			phatc->delayms = 0;
             DebugTrace("WM< Fin Delay\r\n");
+			AtcWakeRun = ATCWAKE_PASSES;
 			return(DELAYFIN_ATCRET);
 		}
 		return(NOSTRRET_ATCRET);
 	}
-	else if(phatc->waitret != STOP_HATCTMW && phatc->waitret != OVER_HATCTMW)
+	else if(phatc->waitret != STOP_HATCTMW && phatc->waitret != OVER_HATCTMW && phatc->txqn == 0)
 	{
 		n = phatc->waitret;
 		n *= 8;
@@ -251,8 +905,18 @@ uint8 SamChkAtcRet(HdsAtcTag * phatc, char * efsm)
 			phatc->waitret = OVER_HATCTMW;
 			phatc->retbuf[phatc->retbufp] = 0x00;
 	        DebugTrace("OT%u<%s\r\n", phatc->retbufp, phatc->retbuf);
+#if SAM_CFG_ATCSTAT_ENABLED
+			SamAtcStatEnd(phatc, OVERTIME_ATCRET);
+#endif
+#if SAM_CFG_ATCRTO_ENABLED
+			SamAtcRtoExpire(phatc);
+#endif
+#if SAM_CFG_ATCCOAL_ENABLED
+			phatc->coalbp = ATCCOAL_NONE;
+#endif
 			phatc->state = SCED_HATCSTA;
 			phatc->retbufp = 0x00;
+			AtcWakeRun = ATCWAKE_PASSES;
 			return(OVERTIME_ATCRET);
 		}
 	}	
@@ -268,12 +932,19 @@ HdsAtcTag * SamAtcInit(HdsAtcTag * pmems, uint8 cid)
 	phatc->state = IDLE_HATCSTA;
 	phatc->retbufp = 0;
 	phatc->atcbp = 0;
+	phatc->segbp = 0;
+	phatc->rxbufh = 0;
+	phatc->rxbuft = 0;
 	
 	phatc->waitret = STOP_HATCTMW;
 	phatc->delayms = 0;
 	phatc->type = 0;
 	phatc->databuf = NULL;
 	phatc->databufp = ATCRDATAPT_VMAX;
+	phatc->dataiovc = 0;
+	phatc->dataiovn = 0;
+	phatc->txqh = 0;
+	phatc->txqn = 0;
 	
 	for(i = 0; i < MDMFUNARRAY_MAX; i++)
 	{
@@ -283,11 +954,48 @@ HdsAtcTag * SamAtcInit(HdsAtcTag * pmems, uint8 cid)
 	}
 
 	phatc->MdmUrcBcFun = NULL;
+	phatc->bcmsk = 0;
+	phatc->urcmsk = 0;
+	phatc->urcncnt = 0;
+
+	phatc->fpt = 0;
+	phatc->fkeep = 0;
+	phatc->reqhd = NULL;
+	phatc->reqtl = NULL;
+	phatc->preq = NULL;
+	phatc->reqpart = 0;
+
+	phatc->binhd = NULL;
+	phatc->pbin = NULL;
+	phatc->binrest = 0;
+#if SAM_CFG_ATCSTAT_ENABLED
+	phatc->statid = ATCSTAT_NONE;
+#endif
+#if SAM_CFG_ATCRTO_ENABLED
+	phatc->rtoid = ATCRTO_NONE;
+	phatc->rtocap = STOP_HATCTMW;
+#endif
+#if SAM_CFG_ATCCOAL_ENABLED
+	phatc->coalbp = ATCCOAL_NONE;
+	phatc->coaloff = 0;
+#endif
 
 	return(phatc);
 }
 
 
+uint8 SamAtcSetDataV(HdsAtcTag * phatc, SamIovTag * iov, uint8 cnt)
+{
+	uint8 i;
+	if(cnt > ATCDATAIOV_MAX || (cnt != 0 && iov == NULL)) return(RETCHAR_FALSE);
+	for(i = 0; i < cnt; i++)
+	{
+		phatc->dataiov[i] = iov[i];
+	}
+	phatc->dataiovc = cnt;
+	return(RETCHAR_TRUE);
+}
+
 uint8 SamAtcFunLink(HdsAtcTag * phatc, void * pfundat, SamMdmFunTag pfunpro, SamUrcBcFunTag pbcfun)
 {
 	uint8 i;
@@ -297,6 +1005,15 @@ uint8 SamAtcFunLink(HdsAtcTag * phatc, void * pfundat, SamMdmFunTag pfunpro, Sam
 		phatc->fun[i].pfunData = pfundat;
 		phatc->fun[i].pfunProc = pfunpro;
 		phatc->fun[i].pBcFun = pbcfun;
+		phatc->fun[i].prio = NORM_FUNPRIO;
+		phatc->fun[i].budms = 0;
+		phatc->fun[i].runclk = SamTmrNow();
+#if SAM_CFG_FUNACCT_ENABLED
+		phatc->fun[i].runcnt = 0;
+		phatc->fun[i].sumus = 0;
+		phatc->fun[i].maxus = 0;
+#endif
+		if(pbcfun != NULL) phatc->bcmsk |= (uint16)(1 << i);
 		return(i);
 	}
 	return(MDMFUNARRAY_MAX);
@@ -304,17 +1021,117 @@ uint8 SamAtcFunLink(HdsAtcTag * phatc, void * pfundat, SamMdmFunTag pfunpro, Sam
 
 uint8 SamAtcFunUnlink(HdsAtcTag * phatc, uint8 fid)
 {
+	AtcBinRuleTag ** pprule;
+	uint16 i;
 	if(fid >= MDMFUNARRAY_MAX) return(MDMFUNARRAY_MAX);
 	if(phatc->fun[fid].pfunData != NULL || phatc->fun[fid].pfunProc != NULL)
 	{
 		phatc->fun[fid].pfunData = NULL;
 		phatc->fun[fid].pfunProc = NULL;
 		phatc->fun[fid].pBcFun = NULL;
+		phatc->bcmsk &= ~(uint16)(1 << fid);
+		if((phatc->urcmsk & (1 << fid)) != 0)
+		{
+			phatc->urcmsk &= ~(uint16)(1 << fid);
+			for(i = 0; i < phatc->urcncnt; i++)
+			{
+				phatc->urcnode[i].fmsk &= ~(uint16)(1 << fid);
+			}
+			if(phatc->urcmsk == 0) phatc->urcncnt = 0;	//no prefix left, drop the trie
+		}
+		for(pprule = &(phatc->binhd); *pprule != NULL;)
+		{
+			if((*pprule)->fid != fid)
+			{
+				pprule = &((*pprule)->next);
+				continue;
+			}
+			if(phatc->pbin == *pprule) phatc->pbin = NULL;	//rest of its payload is dropped
+			*pprule = (*pprule)->next;
+		}
 		return(fid);
 	}
 	return(MDMFUNARRAY_MAX);
 }
 
+uint8 SamAtcFunPrio(HdsAtcTag * phatc, uint8 fid, uint8 prio, uint16 budms)
+{
+	if(fid >= MDMFUNARRAY_MAX || phatc->fun[fid].pfunData == NULL || prio > LOW_FUNPRIO) return(RETCHAR_FALSE);
+	phatc->fun[fid].prio = prio;
+	phatc->fun[fid].budms = budms;
+	return(RETCHAR_TRUE);
+}
+
+uint8 SamAtcFunYield(HdsAtcTag * phatc)
+{
+	uint32 now, age, left;
+	uint8 i;
+
+	now = SamTmrNow();
+	left = 0xFFFFFFFF;
+	for(i = 0; i < MDMFUNARRAY_MAX; i++)
+	{
+		if(i == phatc->fpt || phatc->fun[i].budms == 0 || phatc->fun[i].pfunProc == NULL) continue;
+		age = now - phatc->fun[i].runclk;
+		if(age >= phatc->fun[i].budms) return(RETCHAR_TRUE);
+		if(phatc->fun[i].budms - age < left) left = phatc->fun[i].budms - age;
+	}
+	if(left != 0xFFFFFFFF) SamDeadlineNote(left);	//a pass when the next budget runs out
+	return(RETCHAR_FALSE);
+}
+
+uint8 SamAtcUrcLink(HdsAtcTag * phatc, uint8 fid, char * prefix)
+{
+	uint8 nd, c;
+	if(fid >= MDMFUNARRAY_MAX || prefix == NULL || prefix[0] == 0) return(RETCHAR_FALSE);
+	if(phatc->urcncnt == 0)
+	{
+		phatc->urcnode[0].ch = 0;
+		phatc->urcnode[0].next = 0;
+		phatc->urcnode[0].child = 0;
+		phatc->urcnode[0].fmsk = 0;
+		phatc->urcncnt = 1;
+	}
+	nd = 0;
+	for(; *prefix != 0; prefix++)
+	{
+		for(c = phatc->urcnode[nd].child; c != 0 && phatc->urcnode[c].ch != *prefix; c = phatc->urcnode[c].next);
+		if(c == 0)
+		{
+			if(phatc->urcncnt >= ATURCBUFLEN) return(RETCHAR_FALSE);
+			c = (uint8)(phatc->urcncnt++);
+			phatc->urcnode[c].ch = *prefix;
+			phatc->urcnode[c].child = 0;
+			phatc->urcnode[c].fmsk = 0;
+			phatc->urcnode[c].next = phatc->urcnode[nd].child;
+			phatc->urcnode[nd].child = c;
+		}
+		nd = c;
+	}
+	phatc->urcnode[nd].fmsk |= (uint16)(1 << fid);
+	phatc->urcmsk |= (uint16)(1 << fid);
+	return(RETCHAR_TRUE);
+}
+
+uint8 SamAtcBinLink(HdsAtcTag * phatc, uint8 fid, AtcBinRuleTag * prule, char * head, uint8 lfld, SamAtcSinkTag psink, void * pd)
+{
+	AtcBinRuleTag * p;
+	if(fid >= MDMFUNARRAY_MAX || prule == NULL || psink == NULL || head == NULL) return(RETCHAR_FALSE);
+	if(head[0] == 0 || strlen(head) >= sizeof(prule->head)) return(RETCHAR_FALSE);
+	for(p = phatc->binhd; p != NULL && p != prule; p = p->next);
+	if(p == NULL)
+	{
+		prule->next = phatc->binhd;
+		phatc->binhd = prule;
+	}
+	strcpy(prule->head, head);
+	prule->lfld = lfld;
+	prule->fid = fid;
+	prule->psink = psink;
+	prule->pd = pd;
+	return(RETCHAR_TRUE);
+}
+
 uint8 SamAtcFunUrcBroadCast(HdsAtcTag * phatc, char * notifaction)
 {
 	uint8 t, n;
@@ -331,9 +1148,306 @@ uint8 SamAtcFunUrcBroadCast(HdsAtcTag * phatc, char * notifaction)
 }
 
 
+uint8 SamAtcReqSubmit(HdsAtcTag * phatc, AtcReqTag * preq)
+{
+	if(phatc == NULL || preq == NULL || preq->cmd == NULL) return(RETCHAR_FALSE);
+	if(preq->state == WAIT_ATCREQ || preq->state == BUSY_ATCREQ) return(RETCHAR_FALSE);
+	preq->next = NULL;
+	preq->state = WAIT_ATCREQ;
+	preq->ret = NOSTRRET_ATCRET;
+	preq->rsplen = 0;
+	if(preq->rspbuf != NULL && preq->rspmax != 0) preq->rspbuf[0] = 0;
+	if(phatc->reqhd == NULL)
+	{
+		phatc->reqhd = preq;
+	}
+	else
+	{
+		phatc->reqtl->next = preq;
+	}
+	phatc->reqtl = preq;
+	AtcWakeRun = ATCWAKE_PASSES;
+	return(RETCHAR_TRUE);
+}
+
+//Take the active request off the channel and report its final result
+static void SamAtcReqDone(HdsAtcTag * phatc, AtcReqTag * preq, char * line)
+{
+	phatc->preq = NULL;
+	phatc->reqpart = 0;
+	phatc->state = IDLE_HATCSTA;
+	phatc->waitret = STOP_HATCTMW;
+	phatc->delayms = 0;
+	preq->state = DONE_ATCREQ;
+	if(preq->pcb != NULL) preq->pcb(preq->pd, preq, preq->ret, line);
+	phatc->retbufp = 0;
+	phatc->retbuf[0] = 0;
+}
+
+void SamAtcReqFlush(HdsAtcTag * phatc, uint8 ret)
+{
+	AtcReqTag * preq;
+	if(phatc->preq != NULL)
+	{
+		phatc->preq->ret = ret;
+		SamAtcReqDone(phatc, phatc->preq, NULL);
+	}
+	while(phatc->reqhd != NULL)
+	{
+		preq = phatc->reqhd;
+		phatc->reqhd = preq->next;
+		preq->next = NULL;
+		preq->ret = ret;
+		preq->state = DONE_ATCREQ;
+		if(preq->pcb != NULL) preq->pcb(preq->pd, preq, ret, NULL);
+	}
+	phatc->reqtl = NULL;
+}
+
+uint8 SamAtcReqProc(HdsAtcTag * phatc)
+{
+	AtcReqTag * preq;
+	uint8 ret, nfin;
+	if(phatc->binrest != 0) SamAtcBinDrain(phatc);	//payloads flow even while a unit holds the channel
+	while(1)
+	{
+		preq = phatc->preq;
+		if(preq == NULL)
+		{
+			if(phatc->reqhd == NULL || phatc->fkeep != 0) return(RETCHAR_FREE);
+			preq = phatc->reqhd;
+			phatc->reqhd = preq->next;
+			if(phatc->reqhd == NULL) phatc->reqtl = NULL;
+			preq->next = NULL;
+			preq->state = BUSY_ATCREQ;
+			phatc->preq = preq;
+			if(preq->pset == NULL) preq->pset = &AtcOkErrSet;
+			if(SamSendAtCmd(phatc, preq->cmd, (preq->type == 0) ? CRLF_HATCTYP : preq->type, preq->timwm) != RETCHAR_TRUE)
+			{
+				preq->ret = OVERTIME_ATCRET;
+				SamAtcReqDone(phatc, preq, NULL);
+				continue;
+			}
+		}
+		nfin = (preq->nfin == 0) ? 2 : preq->nfin;
+		ret = SamChkAtcSet(phatc, preq->pset);
+		if(ret == NOSTRRET_ATCRET)
+		{
+			return(RETCHAR_KEEP);
+		}
+		else if(ret == OVERTIME_ATCRET)
+		{
+			preq->ret = ret;
+			SamAtcReqDone(phatc, preq, NULL);
+		}
+		else if(ret == DELAYFIN_ATCRET || ret <= nfin)
+		{
+			if(ret != DELAYFIN_ATCRET && (preq->ret == NOSTRRET_ATCRET || preq->ret == 1)) preq->ret = ret;
+			if(phatc->state != SCED_HATCSTA)
+			{
+				SamSendAtSeg(phatc);
+				phatc->retbufp = 0;
+			}
+			else
+			{
+				if(preq->ret == NOSTRRET_ATCRET) preq->ret = 1;
+				SamAtcReqDone(phatc, preq, (ret == DELAYFIN_ATCRET) ? NULL : phatc->retbuf);
+			}
+		}
+		else
+		{//intermediate line
+			SamAtcReqRsp(preq, phatc->retbuf);
+			if(preq->pcb != NULL) preq->pcb(preq->pd, preq, NOSTRRET_ATCRET, phatc->retbuf);
+			phatc->retbufp = 0;
+			phatc->retbuf[0] = 0;
+		}
+	}
+}
+
+
+#if SAM_CFG_ATCSTAT_ENABLED
+const AtcStatTag * SamAtcStatGet(uint8 idx)
+{
+	if(idx >= AtcStatCnt) return(NULL);
+	return(&AtcStat[idx]);
+}
+
+const AtcStatTag * SamAtcStatFind(char * verb)
+{
+	uint8 i;
+	if(verb == NULL) return(NULL);
+	for(i = 0; i < AtcStatCnt; i++)
+	{
+		if(strcmp(AtcStat[i].verb, verb) == 0) return(&AtcStat[i]);
+	}
+	return(NULL);
+}
+
+void SamAtcStatReset(void)
+{
+	uint8 i;
+	AtcStatCnt = 0;
+	for(i = 0; i < ATCBUS_CHMAX; i++)
+	{
+		if(pAtcBusArray[i] != NULL) pAtcBusArray[i]->statid = ATCSTAT_NONE;
+	}
+}
+
+void SamAtcStatDump(void)
+{
+	AtcStatTag * pst;
+	char hbuf[ATCSTAT_HBKT * 16];
+	uint32 n, m, k;
+	uint8 i, b;
+	DebugTrace("ATC verb             ok   err   tmo   avg   max   p90      out       in\r\n");
+	for(i = 0; i < AtcStatCnt; i++)
+	{
+		pst = &AtcStat[i];
+		n = pst->cnt + pst->errcnt;
+		for(m = 0, b = 0; b < ATCSTAT_HBKT; b++) m += pst->hist[b];
+		for(k = 0, b = 0; b < ATCSTAT_HBKT - 1; b++)
+		{//90% of the timed segments are below 2^b ms
+			k += pst->hist[b];
+			if(k*10 >= m*9) break;
+		}
+		DebugTrace("%-16s%6u%6u%6u%6u%6u%6u%9u%9u\r\n", pst->verb, pst->cnt, pst->errcnt, pst->tmocnt,
+			(n == 0) ? 0 : pst->summs / n, pst->maxms, (m == 0) ? 0 : (1u << b), pst->txbytes, pst->rxbytes);
+		for(k = 0, b = 0; b < ATCSTAT_HBKT; b++)
+		{
+			if(pst->hist[b] != 0) k += sprintf(&hbuf[k], "  <%ums:%u", 1u << b, pst->hist[b]);
+		}
+		if(k != 0) DebugTrace("%s\r\n", hbuf);
+	}
+}
+#endif
+
+
+#if SAM_CFG_FUNACCT_ENABLED
+void SamAtcFunAcctReset(void)
+{
+	uint8 i, j;
+	for(i = 0; i < ATCBUS_CHMAX; i++)
+	{
+		if(pAtcBusArray[i] == NULL) continue;
+		for(j = 0; j < MDMFUNARRAY_MAX; j++)
+		{
+			pAtcBusArray[i]->fun[j].runcnt = 0;
+			pAtcBusArray[i]->fun[j].sumus = 0;
+			pAtcBusArray[i]->fun[j].maxus = 0;
+		}
+	}
+}
+
+void SamAtcFunAcctDump(void)
+{
+	MdmFunTag * pfun;
+	uint8 i, j;
+	DebugTrace("ch fid prio      runs     total_us   avg_us   max_us  unit\r\n");
+	for(i = 0; i < ATCBUS_CHMAX; i++)
+	{
+		if(pAtcBusArray[i] == NULL) continue;
+		for(j = 0; j < MDMFUNARRAY_MAX; j++)
+		{
+			pfun = &(pAtcBusArray[i]->fun[j]);
+			if(pfun->pfunData == NULL) continue;
+			DebugTrace("%2u%4u%5u%10u%13u%9u%9u  %p\r\n", i, j, pfun->prio, pfun->runcnt, pfun->sumus,
+				(pfun->runcnt == 0) ? 0 : pfun->sumus / pfun->runcnt, pfun->maxus, pfun->pfunData);
+		}
+	}
+}
+#endif
+
+
+#if SAM_CFG_ATCRTO_ENABLED
+uint32 SamAtcRtoGet(char * verb)
+{
+	uint8 i;
+	if(verb == NULL) return(0);
+	for(i = 0; i < AtcRtoCnt; i++)
+	{
+		if(strcmp(AtcRto[i].verb, verb) == 0) return(SamAtcRtoCalc(&AtcRto[i]));
+	}
+	return(0);
+}
+#endif
+
+
+void SamDeadlineNote(uint32 ms)
+{
+	if(ms == 0) AtcWakeRun = ATCWAKE_PASSES;
+	if(ms < AtcWakeMs) AtcWakeMs = ms;
+}
+
+//Time until the channel needs to be run without new received bytes
+static uint32 SamAtcDeadline(HdsAtcTag * phatc)
+{
+	uint32 clk, n, d;
+	if(phatc->rxbufh < phatc->rxbuft && phatc->fkeep == 0) return(0);	//staged bytes not framed yet, a holding unit notes its own ticks
+	if(phatc->reqhd != NULL && phatc->preq == NULL && phatc->fkeep == 0) return(0);
+	d = SAM_CFG_IDLE_MAX_MS;
+	if(phatc->txqn != 0) d = ATCTXQ_POLLMS;	//port full, retry soon
+	if(phatc->binrest != 0)
+	{
+		clk = SamGetMsCnt(phatc->binclk);
+		n = (clk < ATCBIN_TMOUT) ? ATCBIN_TMOUT - clk : 0;
+		if(n < d) d = n;
+	}
+	//a timer already past is left armed until someone checks the channel,
+	//the wake at its expiry was given, so only timers still running count
+	if(phatc->delayms != 0)
+	{
+		clk = SamGetMsCnt(phatc->msclk);
+		if(clk < phatc->delayms && phatc->delayms - clk < d) d = phatc->delayms - clk;
+	}
+	else if(phatc->waitret != STOP_HATCTMW && phatc->waitret != OVER_HATCTMW && phatc->txqn == 0)
+	{
+		clk = SamGetMsCnt(phatc->msclk);
+		n = (uint32)phatc->waitret * 8;
+		if(clk < n && n - clk < d) d = n - clk;
+	}
+	return(d);
+}
+
+uint32 SamNextDeadlineMs(void)
+{
+	uint32 d, n;
+	uint8 i;
+	d = AtcWakeMs;
+	AtcWakeMs = SAM_CFG_IDLE_MAX_MS;
+	if(AtcWakeRun != 0)
+	{
+		AtcWakeRun--;
+		return(0);
+	}
+	n = SamTmrNextMs();
+	if(n < d) d = n;
+	for(i = 0; i < ATCBUS_CHMAX && d != 0; i++)
+	{
+		if(pAtcBusArray[i] == NULL) continue;
+		n = SamAtcDeadline(pAtcBusArray[i]);
+		if(n < d) d = n;
+	}
+	return(d);
+}
+
+
 //Data in URC by Bytes be Read!
 uint16 SamAtcDubRead(HdsAtcTag * phatc, uint16 len, char * dp)
 {
-	return(ReadfoCom(phatc->comid, dp, len));
+	uint16 n, m;
+	n = 0;
+	if(phatc->rxbufh < phatc->rxbuft)
+	{//bytes staged by the framer come first
+		n = phatc->rxbuft - phatc->rxbufh;
+		if(n > len) n = len;
+		memcpy(dp, &(phatc->rxbuf[phatc->rxbufh]), n);
+		phatc->rxbufh += n;
+	}
+	if(n < len)
+	{
+		m = SamComRead(phatc->comid, &dp[n], len - n);
+		if(m <= (len - n)) n += m;
+	}
+	return(n);
 }
 
@@ -29,21 +29,117 @@ extern "C"
 
 #define ATCMDBUFLEN	256
 #define ATRETBUFLEN	512
+#ifndef ATRXBUFLEN
+#define ATRXBUFLEN	256		//receive staging block per ReadfoCom call, 1: byte by byte
+#endif
 
-#define ATURCBUFLEN	256
+#define ATURCBUFLEN	256		//URC prefix trie nodes per channel, node index is uint8
 #define ATURCHDLCNT	16
 
+typedef struct{
+	char	ch;			//prefix byte leading to this node
+	uint8	next;		//next sibling node, 0: none
+	uint8	child;		//first child node, 0: none
+	uint16	fmsk;		//fun[] slots owning the prefix ending here
+}AtcUrcNodeTag;
+
 typedef unsigned char (* SamMdmFunTag)(void * pd);
 typedef unsigned char (* SamUrcBcFunTag)(void * pd, char * ustr);
 typedef struct{
 	void *	pfunData; 
 	SamMdmFunTag pfunProc;
 	SamUrcBcFunTag pBcFun;
+	uint8	prio;		//see .prio of MdmFunTag
+	uint16	budms;		//latency budget: waiting longer puts the slot first, 0: none
+	uint32	runclk;		//wheel time of the last run
+#if SAM_CFG_FUNACCT_ENABLED
+	uint32	runcnt;		//runs since linked
+	uint32	sumus;		//total execution time in us
+	uint32	maxus;		//longest run in us
+#endif
 }MdmFunTag;
 #define MDMFUNARRAY_MAX	16
 
+//.prio of MdmFunTag
+enum{
+	RT_FUNPRIO = 0,		//latency bound work, e.g. socket receive
+	HIGH_FUNPRIO,
+	NORM_FUNPRIO,		//SamAtcFunLink default
+	LOW_FUNPRIO,		//bulk work, e.g. SMS, TTS, FOTA
+};
+#define FUNPRIO_AGEMS	250		//waiting this long outweighs one class
+#define FUNPRIO_AGEMAX	60000	//waiting counted up to this
+
+
+typedef struct AtcReqTag AtcReqTag;
+typedef void (* SamAtcReqCbTag)(void * pd, AtcReqTag * preq, uint8 ret, char * line);
+struct AtcReqTag{
+	AtcReqTag * next;		//queue link, owned by the channel while queued
+	char *	cmd;			//command segments as for SamSendAtCmd, kept by the caller until done
+	StrsSetTag * pset;		//expected strings, NULL: AtcOkErrSet
+	uint8	nfin;			//leading pset entries which end a segment, 0: 2 (OK, ERROR)
+	uint8	type;			//recieve mode, 0: CRLF_HATCTYP
+	uint8	timwm;			//wait time per segment, 1024 ms units
+	uint8	state;			//see .state of AtcReqTag
+	uint8	ret;			//final result: pset index or OVERTIME_ATCRET
+	SamAtcReqCbTag pcb;		//callback for intermediate lines and completion, may be NULL
+	void *	pd;				//callback data
+	char *	rspbuf;			//collects the intermediate lines, may be NULL
+	uint16	rspmax;
+	uint16	rsplen;
+};
+
+//.state of AtcReqTag
+#define IDLE_ATCREQ		0x00
+#define WAIT_ATCREQ		0x01	//queued
+#define BUSY_ATCREQ		0x02	//on the channel
+#define DONE_ATCREQ		0x03
+
+
+typedef struct AtcBinRuleTag AtcBinRuleTag;
+typedef void (* SamAtcSinkTag)(void * pd, char * dp, uint16 len, uint16 rest);
+struct AtcBinRuleTag{
+	AtcBinRuleTag * next;	//rule link, owned by the channel while linked
+	char	head[24];		//line prefix, e.g. "+CMQTTRXTOPIC: 0,"
+	uint8	lfld;			//comma separated field behind head holding the length, 0: the first
+	uint8	fid;			//fun[] slot owning the rule
+	SamAtcSinkTag psink;	//receives the payload spans
+	void *	pd;				//sink data
+};
+#define ATCBIN_TMOUT	2000	//ms without payload bytes before a payload is cut short
+
+#define ATCSTAT_HBKT	16
+typedef struct{
+	char	verb[16];	//command up to '=', e.g. "AT+CIPSEND=", "AT+CPSI?"
+	uint32	cnt;		//segments ended by OK
+	uint32	errcnt;		//segments ended by ERROR, +CME ERROR, +CMS ERROR
+	uint32	tmocnt;		//segments timed out
+	uint32	summs;		//latency sum of cnt and errcnt
+	uint32	maxms;
+	uint32	txbytes;	//command and data phase bytes
+	uint32	rxbytes;	//received bytes while the segment was open
+	uint16	hist[ATCSTAT_HBKT];	//latency to the final result, bucket b: [2^(b-1), 2^b) ms, b 0: 0 ms
+}AtcStatTag;
+#define ATCSTAT_NONE	0xFF
+
+typedef struct{
+	char	verb[16];	//command up to '=', as for AtcStatTag
+	uint32	srtt;		//smoothed response time, ms
+	uint32	rttvar;		//response time variation, ms
+	uint8	nsmp;		//samples taken, saturates at 255
+	uint8	boff;		//timeouts since the last sample, doubles the timeout each
+}AtcRtoTag;
+#define ATCRTO_NONE		0xFF
+#define ATCRTO_NOSMP	0xFFFFFFFF
+#define ATCRTO_BOFFMAX	4
 
 #define ATCRDATAPT_VMAX	5000
+#define ATCDATAIOV_MAX	4
+#define ATCTXQ_MAX		(ATCDATAIOV_MAX + 1)
+#define ATCTXQ_TMOUT	2000	//ms without the port taking a byte before unsent bytes are dropped
+#define ATCTXQ_POLLMS	1		//retry period of a partial write
+#define ATCCOAL_LINEMAX	200		//merged command line length, within the modem's line buffer
+#define ATCCOAL_NONE	0xFFFF
 typedef struct{
 	uint8  	comid;		//ATC com channel id
 	uint8	logid;
@@ -57,9 +153,21 @@ typedef struct{
 	char	atcbuf[ATCMDBUFLEN];
 	uint16  retbufp;
 	uint16	atcbp;
+	uint16	segbp;		//atcbuf start of the segment(s) last sent, up to atcbp
+
+	char	rxbuf[ATRXBUFLEN];	//staging block of received bytes not yet framed
+	uint16	rxbufh;				//next byte to frame
+	uint16	rxbuft;				//number of valid bytes in rxbuf
 
 	char *    databuf;     //user data interface
 	uint16    databufp;		
+	SamIovTag dataiov[ATCDATAIOV_MAX];	//data phase fragments, sent in place at the prompt
+	uint8	dataiovc;	//fragments set for the next command
+	uint8	dataiovn;	//fragments armed for the current command
+	SamIovTag txq[ATCTXQ_MAX];	//bytes the port has not taken yet, in place in atcbuf or caller buffers
+	uint8	txqh;		//first pending fragment
+	uint8	txqn;		//pending fragments
+	uint32	txclk;		//last time the port took bytes
 
 	uint16	 delayms;	// delay U_ms
 
@@ -69,6 +177,39 @@ typedef struct{
 
 	MdmFunTag fun[MDMFUNARRAY_MAX];
 	uint8 	fpt;
+	uint8	fkeep;		//fun[fpt] holds the channel (RETCHAR_KEEP)
+
+	AtcReqTag * reqhd;	//queued requests
+	AtcReqTag * reqtl;
+	AtcReqTag * preq;	//request on the channel
+	uint8	reqpart;	//retbuf continues a line given to preq in parts
+
+	uint16	bcmsk;		//fun[] slots with a URC handler
+	uint16	urcmsk;		//fun[] slots routed by declared URC prefixes
+	uint16	urcncnt;	//used nodes of urcnode, node 0 is the root
+	AtcUrcNodeTag urcnode[ATURCBUFLEN];
+
+	AtcBinRuleTag * binhd;	//linked length-framed payload rules
+	AtcBinRuleTag * pbin;	//rule of the payload being received
+	uint16	binlen;
+	uint16	binrest;		//payload bytes still to deliver
+	uint32	binclk;
+
+#if SAM_CFG_ATCSTAT_ENABLED
+	uint8	statid;		//AtcStatTag of the open segment, ATCSTAT_NONE: none
+	uint32	statclk;	//send time of the open segment
+#endif
+#if SAM_CFG_ATCRTO_ENABLED
+	uint8	rtoid;		//AtcRtoTag of the open adaptive segment, ATCRTO_NONE: none
+	uint16	rtocap;		//wait time given by the caller, U_8ms
+	uint32	rtoms;		//latency of the last expected string matched, ATCRTO_NOSMP: none
+#endif
+#if SAM_CFG_ATCCOAL_ENABLED
+	char	coalbuf[ATCCOAL_LINEMAX + 2];	//merged line on the way
+	uint16	coalbp;		//atcbuf offset of the merged segments, ATCCOAL_NONE: none open
+	uint8	coalcnt;	//segments merged
+	uint8	coaloff;	//a merged line failed, the rest of the command goes one by one
+#endif
 
 }HdsAtcTag;
 
@@ -85,6 +226,8 @@ typedef struct{
 #define	RHCD_HATCTYP	0x02	//-->AT+XXX\r, <-- +CARECV: 7,3432423 //,COMMON
 #define RISP_HATCTYP	0x04	//-->AT+XXX\r, <-- >  //>  >SPACE
 #define RIGR_HATCTYP	0x08	//-->AT+XXX\r, <-- >  //>  Greater
+#define ARTO_HATCTYP	0x10	//wait time learned per verb, timwm stays the cap (SAM_CFG_ATCRTO_ENABLED)
+#define COAL_HATCTYP	0x20	//consecutive segments merged into one ';' line (SAM_CFG_ATCCOAL_ENABLED)
 
 //.waitret
 #define OVER_HATCTMW	0x0000
@@ -95,6 +238,7 @@ typedef struct{
 #define NOSTRRET_ATCRET 	0x00
 #define DELAYFIN_ATCRET		0xF0	//Delay timing completed
 #define RETURNSR_ATCRET		0xF1	//Received unknown string
+#define PARTLINE_ATCRET		0xF2	//Part of a line longer than retbuf, to an AtcReqTag callback
 
 #define RECVBCNT_ATCRET		0xFB	//Received the specified number of bytes
 	
@@ -118,7 +262,9 @@ extern HdsAtcTag * SamAtcInit(HdsAtcTag * pmems, uint8 cid);
  *
  * This function processes and sends an AT command segment from the buffer.
  * It adds a carriage return if necessary, updates the buffer pointer and state,
- * and either sends the command or sets a delay.
+ * and either sends the command or sets a delay. Bytes the port does not take at
+ * once are queued and resumed by SamChkAtcSet; the response timeout starts when
+ * the last one has been taken.
  *
  * @param phat Pointer to the HdsAtcTag structure containing AT command information.
  */
@@ -135,6 +281,19 @@ extern void 	SamSendAtSeg(HdsAtcTag *        phat);
  * @param cmdstr Pointer to the AT command string.
  * @param type Type of the AT command.
  * @param timwm Timeout value for waiting for a response.
+ *        With ARTO_HATCTYP in type each segment waits srtt + 4 * rttvar of its verb
+ *        instead, once learned, but never longer than timwm. Queries only: units send
+ *        again after a timeout, a data send or other action would be done twice.
+ *        With COAL_HATCTYP in type consecutive segments are sent as one line, e.g.
+ *        "AT+CGPADDR\rAT+CSQ\r" as "AT+CGPADDR;+CSQ\r", skipping bare AT, delays,
+ *        basic commands behind the first and a deny-list of prompting or long running
+ *        commands. Their info lines come in order ahead of one OK, which ends the
+ *        merged segments together. The result is not split per sub-command: the modem
+ *        answers a merged line with one final result and does not tell which command
+ *        of it failed. On an error the merged segments are sent again one by one, the
+ *        rest of the command too, so the failing one reports its own result; the ones
+ *        ahead of it run twice and their lines show up twice. Use it for queries and
+ *        settings that can be written again only.
  * @return RETCHAR_TRUE if the command is sent successfully, RETCHAR_FALSE otherwise.
  */
 extern uint8 	SamSendAtCmd(HdsAtcTag *        phatc, char * cmdstr, uint8 type, uint8 timwm);
@@ -144,6 +303,9 @@ extern uint8 	SamSendAtCmd(HdsAtcTag *        phatc, char * cmdstr, uint8 type,
  *
  * This function reads data from the COM port, checks for specific response strings,
  * and calls callback functions if necessary. It also handles delays and timeouts.
+ * Received data is pulled in blocks of up to ATRXBUFLEN bytes per ReadfoCom call and
+ * framed from the channel staging buffer; bytes behind a returned frame stay staged
+ * for the next call.
  *
  * @param phatc Pointer to the HdsAtcTag structure containing AT command information.
  * @param efsm Pointer to the string containing expected response strings.
@@ -151,6 +313,38 @@ extern uint8 	SamSendAtCmd(HdsAtcTag *        phatc, char * cmdstr, uint8 type,
  */
 extern uint8 	SamChkAtcRet(HdsAtcTag * phatc,  char * efsm);
 
+/**
+ * @brief Check the return status of an AT command against a compiled pattern set.
+ *
+ * Same as SamChkAtcRet, with the expected response strings given as a StrsSetTag
+ * defined once per call site (see STRSSET_DEF), so they are not re-tokenized per line.
+ *
+ * @param phatc Pointer to the HdsAtcTag structure containing AT command information.
+ * @param pset Pointer to the pattern set of expected response strings.
+ * @return The index of the matching response string, or other status codes.
+ */
+extern uint8 	SamChkAtcSet(HdsAtcTag * phatc,  StrsSetTag * pset);
+
+//shared "OK\r\n\tERROR\r\n" pattern set
+extern StrsSetTag AtcOkErrSet;
+
+
+/**
+ * @brief Set the data phase of the next command as a list of fragments.
+ *
+ * Applies to the next SamSendAtCmd only. At its '>' prompt the fragments (e.g. header,
+ * user buffer, Ctrl-Z trailer) are sent straight from the caller's memory, in one
+ * SendtoComV call where the port has one. The descriptors are copied, the data is not;
+ * it must stay valid until the response, a partial write resumes from it. Takes
+ * precedence over databuf/databufp.
+ *
+ * @param phatc Pointer to the HdsAtcTag structure.
+ * @param iov Pointer to the fragment descriptors.
+ * @param cnt Number of fragments, up to ATCDATAIOV_MAX, 0 clears them.
+ * @return RETCHAR_TRUE if set, RETCHAR_FALSE if cnt is too big.
+ */
+extern uint8	SamAtcSetDataV(HdsAtcTag * phatc, SamIovTag * iov, uint8 cnt);
+
 
 /**
  * @brief Link a callback function to an HdsAtcTag structure.
@@ -178,6 +372,73 @@ extern uint8	SamAtcFunLink(HdsAtcTag * phatc, void * pfundat, SamMdmFunTag pfunp
  */
 extern uint8 SamAtcFunUnlink(HdsAtcTag * phatc, uint8 fid);
 
+/**
+ * @brief Set the scheduling class of a linked function slot.
+ *
+ * When no slot holds the channel, SamMdmProc runs the slots by class, a slot waiting
+ * FUNPRIO_AGEMS counting as one class higher, so low classes still get their turn.
+ * A slot waiting longer than its latency budget runs before all others. A slot in
+ * the middle of a transaction (RETCHAR_KEEP) is not preempted, it lets the others
+ * run at its idle waits through SamAtcFunYield.
+ *
+ * @param phatc Pointer to the HdsAtcTag structure.
+ * @param fid Index of the function slot returned by SamAtcFunLink.
+ * @param prio Class, see .prio of MdmFunTag.
+ * @param budms Latency budget in ms, 0 for none.
+ * @return RETCHAR_TRUE if set, RETCHAR_FALSE if the slot is invalid.
+ */
+extern uint8 SamAtcFunPrio(HdsAtcTag * phatc, uint8 fid, uint8 prio, uint16 budms);
+
+/**
+ * @brief Check whether the slot holding the channel should let the others run.
+ *
+ * A unit calls it where it holds the channel (RETCHAR_KEEP) with no command in
+ * flight, e.g. a pause between the commands of a transaction, and returns
+ * RETCHAR_FREE instead of RETCHAR_KEEP when told to. It then runs with the others
+ * and goes on from the same step. Notes a deadline for the next budget running out.
+ *
+ * @param phatc Pointer to the HdsAtcTag structure.
+ * @return RETCHAR_TRUE if another slot waited longer than its latency budget.
+ */
+extern uint8 SamAtcFunYield(HdsAtcTag * phatc);
+
+
+/**
+ * @brief Declare a URC prefix owned by a linked function slot.
+ *
+ * Unsolicited lines starting with the prefix are routed only to the slot's URC handler,
+ * found with one walk of the channel prefix trie. Slots that never declare a prefix keep
+ * receiving every unsolicited line as before. Prefixes are dropped by SamAtcFunUnlink.
+ *
+ * @param phatc Pointer to the HdsAtcTag structure.
+ * @param fid Index of the function slot returned by SamAtcFunLink.
+ * @param prefix Pointer to the URC prefix string, e.g. "+CMTI:".
+ * @return RETCHAR_TRUE if the prefix is registered, RETCHAR_FALSE if invalid or the trie is full.
+ */
+extern uint8 SamAtcUrcLink(HdsAtcTag * phatc, uint8 fid, char * prefix);
+
+
+/**
+ * @brief Link a length-framed payload rule owned by a linked function slot.
+ *
+ * A received line starting with head announces lfld-th field bytes of binary payload
+ * right behind it (e.g. "+CIPRXGET: 2,0,", "+CMQTTRXPAYLOAD: 0,"). The line itself is
+ * handled as usual; the framer then switches to counted-byte mode and hands the payload
+ * to psink in spans as it arrives, without blocking, with rest the bytes still to come.
+ * A zero length payload gives one empty span. dp is NULL if the payload is cut short
+ * after ATCBIN_TMOUT ms without data. Rules are dropped by SamAtcFunUnlink.
+ *
+ * @param phatc Pointer to the HdsAtcTag structure.
+ * @param fid Index of the function slot returned by SamAtcFunLink.
+ * @param prule Pointer to the caller owned rule, relinking it updates it.
+ * @param head Pointer to the line prefix, copied into the rule.
+ * @param lfld Index of the length field behind head.
+ * @param psink Pointer to the payload sink.
+ * @param pd Pointer passed to the sink.
+ * @return RETCHAR_TRUE if linked, RETCHAR_FALSE if invalid.
+ */
+extern uint8 SamAtcBinLink(HdsAtcTag * phatc, uint8 fid, AtcBinRuleTag * prule, char * head, uint8 lfld, SamAtcSinkTag psink, void * pd);
+
 
 /**
  * @brief Broadcast an URC (Unsolicited Result Code) notification to all registered callback functions.
@@ -193,11 +454,146 @@ extern uint8 SamAtcFunUnlink(HdsAtcTag * phatc, uint8 fid);
 extern uint8 SamAtcFunUrcBroadCast(HdsAtcTag * phatc, char * notifaction);
 
 
+/**
+ * @brief Queue an AT request on a channel.
+ *
+ * Requests are sent one at a time in submit order, whenever no functional unit holds
+ * the channel. Each segment of cmd ends on one of the first nfin strings of pset, a
+ * delay or a timeout; other matches and unknown lines are passed to pcb with
+ * NOSTRRET_ATCRET and appended to rspbuf. A line longer than retbuf is passed in
+ * parts, each but the last with PARTLINE_ATCRET, if it is the request's own: no
+ * "+XXX:" head or the head of the command sent. A long URC in between is cut as
+ * without a request. After the last segment pcb is called
+ * once more with the final result: the first failing segment result, else the last one.
+ * The request and the strings it points to must stay valid until then.
+ *
+ * @param phatc Pointer to the HdsAtcTag structure.
+ * @param preq Pointer to the caller owned request.
+ * @return RETCHAR_TRUE if queued, RETCHAR_FALSE if invalid or already pending.
+ */
+extern uint8 SamAtcReqSubmit(HdsAtcTag * phatc, AtcReqTag * preq);
+
+/**
+ * @brief Drop pending requests of a channel.
+ *
+ * The active request and all queued ones are completed with the given result.
+ *
+ * @param phatc Pointer to the HdsAtcTag structure.
+ * @param ret Result passed to the callbacks, e.g. OVERTIME_ATCRET.
+ */
+extern void SamAtcReqFlush(HdsAtcTag * phatc, uint8 ret);
+
+/**
+ * @brief Run the request queue of a channel.
+ *
+ * Called by the channel scheduler. Starts the next queued request when the channel is
+ * free and drives the active one; a finished request is followed by the next one in
+ * the same call.
+ *
+ * @param phatc Pointer to the HdsAtcTag structure.
+ * @return RETCHAR_KEEP while a request holds the channel, RETCHAR_FREE otherwise.
+ */
+extern uint8 SamAtcReqProc(HdsAtcTag * phatc);
+
+
+/**
+ * @brief Note a time at which the caller needs to be run again.
+ *
+ * Functional units call it with the time left to their next step timer tick, API
+ * entries with 0 when they hand work to a unit. The earliest noted time is taken
+ * into account by the next SamNextDeadlineMs call.
+ *
+ * @param ms Time from now in ms.
+ */
+extern void SamDeadlineNote(uint32 ms);
+
+/**
+ * @brief Get the time the host may sleep before the next driver run.
+ *
+ * Aggregates the pending AT timeouts and delays of all channels, queued requests,
+ * payload timeouts, the next SamTmr expiry and the times noted with SamDeadlineNote
+ * since the last call, capped to SAM_CFG_IDLE_MAX_MS. After a received line, a timer event or a 0 note it
+ * returns 0 for a few passes, so units reacting to each other settle at once.
+ * Received data is not covered: the host sleeps until its port has data or the
+ * deadline passes, then runs the driver.
+ *
+ * @return Time from now in ms, 0 to run again at once.
+ */
+extern uint32 SamNextDeadlineMs(void);
+
+
+#if SAM_CFG_ATCSTAT_ENABLED
+/**
+ * @brief Get the statistics of an AT verb.
+ *
+ * Each command segment is timed from SamSendAtSeg to its OK, ERROR, +CME ERROR or
+ * +CMS ERROR line, or counted as a timeout, and accounted to the verb it starts with,
+ * on all channels together.
+ *
+ * @param idx Index of the verb, from 0 in first use order.
+ * @return Pointer to the statistics, NULL if idx is not used.
+ */
+extern const AtcStatTag * SamAtcStatGet(uint8 idx);
+
+/**
+ * @brief Find the statistics of an AT verb by name.
+ *
+ * @param verb Pointer to the verb string, e.g. "AT+CIPSEND=".
+ * @return Pointer to the statistics, NULL if the verb has not been sent.
+ */
+extern const AtcStatTag * SamAtcStatFind(char * verb);
+
+/**
+ * @brief Clear all AT verb statistics.
+ */
+extern void SamAtcStatReset(void);
+
+/**
+ * @brief Print the AT verb statistics as a table with DebugTrace.
+ *
+ * One row per verb: counts, average, max and 90th percentile latency (bucket
+ * upper bound) in ms, bytes out and in, followed by the non-empty histogram buckets.
+ */
+extern void SamAtcStatDump(void);
+#endif
+
+#if SAM_CFG_FUNACCT_ENABLED
+/**
+ * @brief Clear the execution time accounting of all linked function slots.
+ */
+extern void SamAtcFunAcctReset(void);
+
+/**
+ * @brief Print the execution time accounting with DebugTrace.
+ *
+ * One row per linked slot of each AT channel: class, runs since linked or the last
+ * reset, total, average and longest run in us by GetSysUsCnt, and the unit data pointer.
+ */
+extern void SamAtcFunAcctDump(void);
+#endif
+
+
+#if SAM_CFG_ATCRTO_ENABLED
+/**
+ * @brief Get the adaptive timeout of an AT verb.
+ *
+ * Segments sent with ARTO_HATCTYP are timed from the command, or its '>' prompt, to
+ * the last expected string the caller matched before the next command. The samples
+ * are smoothed as a TCP retransmission timer (RFC 6298); each timeout doubles the
+ * verb's timeout until the next sample, up to ATCRTO_BOFFMAX times.
+ *
+ * @param verb Pointer to the verb string, e.g. "AT+CSQ".
+ * @return Timeout in ms, 0 while fewer than SAM_ATCRTO_LEARN samples were taken.
+ */
+extern uint32 SamAtcRtoGet(char * verb);
+#endif
+
+
 /**
  * @brief Read data from the COM port in URC mode(only the URC handle).
  *
  * This function reads a specified number of bytes from the COM port associated
- * with the HdsAtcTag structure.
+ * with the HdsAtcTag structure. Bytes already staged by the framer are returned first.
  *
  * @param phatc Pointer to the HdsAtcTag structure.
  * @param len Number of bytes to read.
@@ -13,29 +13,15 @@
 #include "SamAtc.h"
 #include "SamAudio.h"
 
-#define	AUDIO_WRITE_BUF_LEN 128
-
-typedef struct{
-    uint8 sta;
-    uint8 step;
-    uint8 dcnt;
-    uint8 runlink; //for run link in atclink  
-    uint32 msclk;  //for recode sysclk
-    uint8 stim;    //second timer for user  
-    HdsAtcTag* phatc;
-    char writeBuf[AUDIO_WRITE_BUF_LEN];
-    uint16 writeCount;
-    sam_audio_callback audioCallback;
-    sam_audio_urc_callback audioURCCallback;
-}Audio_Tag_T;
-
-
-Audio_Tag_T mAudioTag;
-
-extern HdsAtcTag * pAtcBusArray[];
 static unsigned char sam_audio_proc(void *pAudioTag);
 static unsigned char sam_audio_urc_cb(void *pAudio, char *urcStr);
 
+static StrsSetTag audio_play_rsp = STRSSET_DEF("+CCMXPLAY:\r\n\tOK\r\n\tERROR\r\n");
+static StrsSetTag audio_stop_rsp = STRSSET_DEF("+CCMXSTOP:\r\n\tOK\r\n\tERROR\r\n");
+static StrsSetTag audio_rec_rsp = STRSSET_DEF("+CREC: memory full\r\n\t+CREC:\tOK\r\n\tERROR\r\n");
+static StrsSetTag audio_recstop_rsp = STRSSET_DEF("+CREC: 0\r\n\tOK\r\n\tERROR\r\n");
+static StrsSetTag audio_recsta_rsp = STRSSET_DEF("+CREC: 0\r\n\t+CREC: 1\r\n\tOK\r\n\tERROR\r\n");
+
 
 /**
  * @brief Play an audio file, where the file format is amr,wav,mp3 or pcm.
@@ -48,7 +34,7 @@ static unsigned char sam_audio_urc_cb(void *pAudio, char *urcStr);
  *               Please check the input parameters correctly. 
  */
 int sam_audio_play(char *fileName,uint8 playPath,uint8 repeat) {
-    Audio_Tag_T *pAudioTag = &mAudioTag;
+    Audio_Tag_T *pAudioTag = &(SamCtxCur()->audio);
     if(fileName == NULL || playPath > 2) {
         return -1;
     }
@@ -72,7 +58,7 @@ int sam_audio_play(char *fileName,uint8 playPath,uint8 repeat) {
  *  The TTS module is executing other tasks,please try late.
  */
 int sam_audio_stop_playing(void) {
-    Audio_Tag_T *pAudioTag = &mAudioTag;
+    Audio_Tag_T *pAudioTag = &(SamCtxCur()->audio);
     if(pAudioTag->sta == AUDIO_STOP_PLAYING) {
         return 0;
     } else if(pAudioTag->sta != AUDIO_IDLE) {
@@ -91,7 +77,7 @@ int sam_audio_stop_playing(void) {
  *  The TTS module is executing other tasks,please try late.
  */
 int sam_audio_get_record_status(void){
-    Audio_Tag_T *pAudioTag = &mAudioTag;
+    Audio_Tag_T *pAudioTag = &(SamCtxCur()->audio);
     if(pAudioTag->sta == AUDIO_RECORDING_STATUS) {
         return 0;
     } else if(pAudioTag->sta != AUDIO_IDLE) {
@@ -116,7 +102,7 @@ int sam_audio_get_record_status(void){
  *               Please check the input parameters correctly. 
  */
 int sam_audio_record_start(const char *fileName,uint8 recordPath){
-    Audio_Tag_T *pAudioTag = &mAudioTag;
+    Audio_Tag_T *pAudioTag = &(SamCtxCur()->audio);
     if(pAudioTag->sta == AUDIO_RECORD_START) {
         return 0;
     } else if(pAudioTag->sta != AUDIO_IDLE) {
@@ -138,7 +124,7 @@ int sam_audio_record_start(const char *fileName,uint8 recordPath){
  *  The TTS module is executing other tasks,please try late.
  */
 int sam_audio_record_stop(void){
-    Audio_Tag_T *pAudioTag = &mAudioTag;
+    Audio_Tag_T *pAudioTag = &(SamCtxCur()->audio);
     if(pAudioTag->sta == AUDIO_RECORD_STOP) {
         return 0;
     } else if(pAudioTag->sta != AUDIO_IDLE) {
@@ -162,7 +148,7 @@ int sam_audio_record_stop(void){
  *               Please check the input parameters correctly. 
  */
 int sam_audio_init(uint8 atcIndex,sam_audio_callback audioCallback,sam_audio_urc_callback urcCallback) {
-    Audio_Tag_T *pAudioTag = &mAudioTag;
+    Audio_Tag_T *pAudioTag = &(SamCtxCur()->audio);
     if(atcIndex >= ATCBUS_CHMAX) {
         return -1;
     }
@@ -172,8 +158,9 @@ int sam_audio_init(uint8 atcIndex,sam_audio_callback audioCallback,sam_audio_urc
     pAudioTag->dcnt = 0;
     pAudioTag->stim = 0;
     pAudioTag->writeCount = 0;
-    pAudioTag->msclk = SamGetMsCnt(0);
+    pAudioTag->stmr = SamTmrStart(pAudioTag->stmr, 1000, 1000);
     pAudioTag->runlink =	SamAtcFunLink(pAudioTag->phatc, pAudioTag, sam_audio_proc, sam_audio_urc_cb);
+    SamAtcFunPrio(pAudioTag->phatc, pAudioTag->runlink, LOW_FUNPRIO, 0);
     pAudioTag->audioCallback = audioCallback;
     pAudioTag->audioURCCallback = urcCallback;
     return 0;
@@ -186,15 +173,16 @@ int sam_audio_init(uint8 atcIndex,sam_audio_callback audioCallback,sam_audio_urc
  */
 int sam_audio_deinit(void)
 {
-	Audio_Tag_T *pAudioTag = &mAudioTag;
+	Audio_Tag_T *pAudioTag = &(SamCtxCur()->audio);
 	SamAtcFunUnlink(pAudioTag->phatc, pAudioTag->runlink);
+	SamTmrStop(pAudioTag->stmr);
+	pAudioTag->stmr = 0;
 	return 0;
 }
 
 unsigned char sam_audio_proc(void *pAudioTag)
 {
 	uint8 ratcret;
-	uint32 clk;
     char value[6];
 	Audio_Tag_T * pAudio = NULL;
 	HdsAtcTag * phatc = NULL;
@@ -208,13 +196,7 @@ unsigned char sam_audio_proc(void *pAudioTag)
         return ('E'+2);
     }
 
-	clk = SamGetMsCnt(pAudio->msclk);
-	while(clk >= 1000)
-	{
-		pAudio->msclk +=1000;
-		pAudio->stim += 1;
-		clk -= 1000;
-	}
+	pAudio->stim += SamTmrPeriod(&(pAudio->stmr), 1000);
 	
 	switch(pAudio->sta)
 	{
@@ -226,7 +208,7 @@ unsigned char sam_audio_proc(void *pAudioTag)
 			    char data[128] = {0};
                 char *pStr = "AT+CCMXPLAY=";
 			    phatc->type = CRLF_HATCTYP;
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) {
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) {
                     phatc->retbufp = 0;
                 }
                 memcpy(data,pStr,strlen(pStr));
@@ -239,7 +221,7 @@ unsigned char sam_audio_proc(void *pAudioTag)
 			else if(pAudio->step == 1)
 			{
 			    pAudio->phatc->type = CRLF_HATCTYP;
-				ratcret = SamChkAtcRet(pAudio->phatc, "+CCMXPLAY:\r\n\tOK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(pAudio->phatc, &audio_play_rsp);
 				if(ratcret == NOSTRRET_ATCRET) {
                 	return RETCHAR_KEEP;
 				} else if(ratcret == OVERTIME_ATCRET || ratcret == 3) {
@@ -267,7 +249,7 @@ unsigned char sam_audio_proc(void *pAudioTag)
 			if(pAudio->step == 0)
 			{
 			    phatc->type = CRLF_HATCTYP;
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) {
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) {
                     phatc->retbufp = 0;
                 }
                 SamSendAtCmd(phatc, "AT+CCMXSTOP\r\n", CRLF_HATCTYP, 80);
@@ -278,7 +260,7 @@ unsigned char sam_audio_proc(void *pAudioTag)
 			else if(pAudio->step == 1)
 			{
 			    pAudio->phatc->type = CRLF_HATCTYP;
-				ratcret = SamChkAtcRet(pAudio->phatc, "+CCMXSTOP:\r\n\tOK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(pAudio->phatc, &audio_stop_rsp);
 				if(ratcret == NOSTRRET_ATCRET) {
                 	return RETCHAR_KEEP;
 				}
@@ -310,7 +292,7 @@ unsigned char sam_audio_proc(void *pAudioTag)
 			    char data[128] = {0};
                 char *pStr = "AT+CREC=";
 			    phatc->type = CRLF_HATCTYP;
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) {
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) {
                     phatc->retbufp = 0;
                 }
                 memcpy(data,pStr,strlen(pStr));
@@ -323,7 +305,7 @@ unsigned char sam_audio_proc(void *pAudioTag)
 			else if(pAudio->step == 1)
 			{
 			    pAudio->phatc->type = CRLF_HATCTYP;
-				ratcret = SamChkAtcRet(pAudio->phatc, "+CREC: memory full\r\n\t+CREC:\tOK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(pAudio->phatc, &audio_rec_rsp);
 				if(ratcret == NOSTRRET_ATCRET) {
                 	return RETCHAR_KEEP;
 				} else if(ratcret == OVERTIME_ATCRET || ratcret == 4) {
@@ -356,7 +338,7 @@ unsigned char sam_audio_proc(void *pAudioTag)
 			if(pAudio->step == 0)
 			{
 			    phatc->type = CRLF_HATCTYP;
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) {
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) {
                     phatc->retbufp = 0;
                 }
                 SamSendAtCmd(phatc, "AT+CREC=0\r\n", CRLF_HATCTYP, 80);
@@ -367,7 +349,7 @@ unsigned char sam_audio_proc(void *pAudioTag)
 			else if(pAudio->step == 1)
 			{
 			    pAudio->phatc->type = CRLF_HATCTYP;
-				ratcret = SamChkAtcRet(pAudio->phatc, "+CREC: 0\r\n\tOK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(pAudio->phatc, &audio_recstop_rsp);
 				if(ratcret == NOSTRRET_ATCRET) {
                 	return RETCHAR_KEEP;
 				} else if(ratcret == OVERTIME_ATCRET || ratcret == 3) {
@@ -395,7 +377,7 @@ unsigned char sam_audio_proc(void *pAudioTag)
 		if(pAudio->step == 0)
 		{
 		    phatc->type = CRLF_HATCTYP;
-			while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) {
+			while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) {
                 phatc->retbufp = 0;
             }
             SamSendAtCmd(phatc, "AT+CREC?\r\n", CRLF_HATCTYP, 80);
@@ -406,7 +388,7 @@ unsigned char sam_audio_proc(void *pAudioTag)
 		else if(pAudio->step == 1)
 		{
 		    pAudio->phatc->type = CRLF_HATCTYP;
-			ratcret = SamChkAtcRet(pAudio->phatc, "+CREC: 0\r\n\t+CREC: 1\r\n\tOK\r\n\tERROR\r\n");
+			ratcret = SamChkAtcSet(pAudio->phatc, &audio_recsta_rsp);
 			if(ratcret == NOSTRRET_ATCRET) {
             	return RETCHAR_KEEP;
 			} else if(ratcret == OVERTIME_ATCRET || ratcret == 4) {
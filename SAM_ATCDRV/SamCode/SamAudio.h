@@ -26,6 +26,23 @@ typedef enum{
 typedef void (* sam_audio_callback)(Audio_Status_E audioStatus,char *result);
 typedef char (* sam_audio_urc_callback)(char *urcStr);
 
+#define	AUDIO_WRITE_BUF_LEN 128
+
+//Audio unit state, one per SamCtx
+typedef struct{
+    uint8 sta;
+    uint8 step;
+    uint8 dcnt;
+    uint8 runlink; //for run link in atclink  
+    SamTmrId stmr;  //second tick timer
+    uint8 stim;    //second timer for user  
+    HdsAtcTag* phatc;
+    char writeBuf[AUDIO_WRITE_BUF_LEN];
+    uint16 writeCount;
+    sam_audio_callback audioCallback;
+    sam_audio_urc_callback audioURCCallback;
+}Audio_Tag_T;
+
 
 /**
  * @brief Play an audio file, where the file format is amr,wav,mp3 or pcm.
@@ -0,0 +1,404 @@
+/**
+ * @file 	SamCmux.c
+ * @brief   3GPP 27.010 multiplexer between the UART and the AT channels
+ * @details Basic option framing (0xF9 flags, FCS over the header, UIH data frames),
+ *			start up with AT+CMUX=0 and SABM/UA, and demultiplexing of received
+ *			frames into one buffer per DLC.
+ *
+ * @version 1.0.0
+ * @date 	2025-08-01
+ * @author 	Alex <fanbing.kong@sunseaaiot.com>
+ * @copyright Copyright (c) 2025, SIMCom Wireless Solutions Limited. All rights reserved.
+ *
+ * @note
+ *
+ *
+ */
+//---------------------------------------------------------------------------
+
+#define __SAMCMUX_C
+
+#include "SamInc.h"
+
+#define CMUX_FLAG	0xF9
+#define CMUX_SABM	0x2F
+#define CMUX_UA		0x63
+#define CMUX_DM		0x0F
+#define CMUX_DISC	0x43
+#define CMUX_UIH	0xEF
+#define CMUX_PF		0x10
+
+#define CMUX_CMDTMO	2000	//ms, wait OK of AT+CMUX
+#define CMUX_SABMTMO	1000	//ms, wait UA of SABM
+
+//27.010 FCS, reversed 0x07 polynomial
+static uint8 SamCmuxFcs(uint8 fcs, uint8 * dp, uint16 len)
+{
+	uint8 i;
+	while(len--)
+	{
+		fcs ^= *dp++;
+		for(i = 0; i < 8; i++)
+		{
+			fcs = (fcs & 0x01) ? ((fcs >> 1) ^ 0xE0) : (fcs >> 1);
+		}
+	}
+	return(fcs);
+}
+
+//Send pending bytes, a stall longer than ATCTXQ_TMOUT drops them
+static void SamCmuxTxPump(SamCmuxTag * pmux)
+{
+	uint16 n;
+	if(pmux->txn == 0) return;
+	n = SendtoCom(pmux->comid, &(pmux->txbuf[pmux->txh]), pmux->txn);
+	if(n > pmux->txn) n = 0;
+	if(n != 0) pmux->txclk = SamGetMsCnt(0);
+	pmux->txh += n;
+	pmux->txn -= n;
+	if(pmux->txn != 0 && SamGetMsCnt(pmux->txclk) >= ATCTXQ_TMOUT)
+	{
+		DebugTrace("OT[%u]CMUX TxBytes\r\n", pmux->txn);
+		pmux->txn = 0;
+	}
+	if(pmux->txn == 0) pmux->txh = 0;
+}
+
+//Queue bytes behind the pending ones, all or none, and send what the port takes now
+static uint8 SamCmuxTxPut(SamCmuxTag * pmux, char * dp, uint16 len)
+{
+	if((uint32)pmux->txn + len > sizeof(pmux->txbuf)) return(RETCHAR_FALSE);
+	if((uint32)pmux->txh + pmux->txn + len > sizeof(pmux->txbuf))
+	{
+		memmove(pmux->txbuf, &(pmux->txbuf[pmux->txh]), pmux->txn);
+		pmux->txh = 0;
+	}
+	if(pmux->txn == 0) pmux->txclk = SamGetMsCnt(0);
+	memcpy(&(pmux->txbuf[pmux->txh + pmux->txn]), dp, len);
+	pmux->txn += len;
+	SamCmuxTxPump(pmux);
+	return(RETCHAR_TRUE);
+}
+
+static uint8 SamCmuxFrame(SamCmuxTag * pmux, uint8 dlci, uint8 cr, uint8 ctrl, char * dp, uint16 len)
+{
+	uint8 fb[SAM_CMUX_N1 + 8];
+	uint16 h;
+	fb[0] = CMUX_FLAG;
+	fb[1] = (uint8)((dlci << 2) | (cr << 1) | 0x01);
+	fb[2] = ctrl;
+	if(len < 128)
+	{
+		fb[3] = (uint8)((len << 1) | 0x01);
+		h = 4;
+	}
+	else
+	{
+		fb[3] = (uint8)(len << 1);
+		fb[4] = (uint8)(len >> 7);
+		h = 5;
+	}
+	if(len != 0) memcpy(&fb[h], dp, len);
+	fb[h + len] = 0xFF - SamCmuxFcs(0xFF, &fb[1], h - 1);
+	fb[h + len + 1] = CMUX_FLAG;
+	return(SamCmuxTxPut(pmux, (char *)fb, h + len + 2));
+}
+
+static void SamCmuxRxFrame(SamCmuxTag * pmux)
+{
+	CmuxDlcTag * pdlc;
+	uint8 dlci, ctrl;
+	uint16 i, t;
+
+	dlci = pmux->fhdr[0] >> 2;
+	ctrl = pmux->fhdr[1] & ~CMUX_PF;
+	if(dlci >= CMUX_DLCMAX)
+	{
+		if(ctrl == CMUX_SABM) SamCmuxFrame(pmux, dlci, 0, CMUX_DM | CMUX_PF, NULL, 0);
+		return;
+	}
+	pdlc = &(pmux->dlc[dlci]);
+	switch(ctrl)
+	{
+		case CMUX_SABM :
+			pdlc->sta = OPEN_DLCSTA;
+			SamCmuxFrame(pmux, dlci, 0, CMUX_UA | CMUX_PF, NULL, 0);
+			break;
+		case CMUX_UA :
+			pdlc->sta = OPEN_DLCSTA;
+			break;
+		case CMUX_DM :
+			pdlc->sta = CLOSE_DLCSTA;
+			break;
+		case CMUX_DISC :
+			pdlc->sta = CLOSE_DLCSTA;
+			SamCmuxFrame(pmux, dlci, 0, CMUX_UA | CMUX_PF, NULL, 0);
+			if(dlci == 0)
+			{
+				DebugTrace("CMUX Closed by Modem!\r\n");
+				pmux->sta = NONE_CMUXSTA;
+			}
+			break;
+		case CMUX_UIH :
+			if(dlci == 0)
+			{//control channel: answer commands (C/R bit of the type) with the same message
+				if(pmux->flen != 0 && pmux->flen <= SAM_CMUX_N1 && (pmux->fbuf[0] & 0x02) != 0)
+				{
+					pmux->fbuf[0] &= ~0x02;
+					SamCmuxFrame(pmux, 0, 1, CMUX_UIH, pmux->fbuf, pmux->flen);
+				}
+				break;
+			}
+			for(i = 0; i < pmux->flen; i++)
+			{
+				t = pdlc->rxt + 1;
+				if(t >= SAM_CMUX_RXBUF_SIZE) t = 0;
+				if(t == pdlc->rxh)
+				{
+					pmux->drops += pmux->flen - i;
+					break;
+				}
+				pdlc->rxbuf[pdlc->rxt] = pmux->fbuf[i];
+				pdlc->rxt = t;
+			}
+			break;
+		default :
+			break;
+	}
+}
+
+static void SamCmuxRxByte(SamCmuxTag * pmux, uint8 c)
+{
+	switch(pmux->fsta)
+	{
+		case 0 :	//opening flag
+			if(c == CMUX_FLAG) pmux->fsta = 1;
+			break;
+		case 1 :	//address, repeated flags skipped
+			if(c == CMUX_FLAG) break;
+			pmux->fhdr[0] = c;
+			pmux->fhlen = 1;
+			pmux->fsta = 2;
+			break;
+		case 2 :	//control
+			pmux->fhdr[pmux->fhlen++] = c;
+			pmux->fsta = 3;
+			break;
+		case 3 :	//length, one or two bytes
+		case 4 :
+			pmux->fhdr[pmux->fhlen++] = c;
+			if(pmux->fsta == 3)
+			{
+				pmux->flen = c >> 1;
+			}
+			else
+			{
+				pmux->flen |= (uint16)c << 7;
+			}
+			pmux->fpos = 0;
+			if(pmux->fsta == 3 && (c & 0x01) == 0)
+			{
+				pmux->fsta = 4;
+			}
+			else if(pmux->flen > sizeof(pmux->fbuf))
+			{
+				pmux->fsta = 0;
+			}
+			else
+			{
+				pmux->fsta = (pmux->flen != 0) ? 5 : 6;
+			}
+			break;
+		case 5 :	//information field
+			pmux->fbuf[pmux->fpos++] = c;
+			if(pmux->fpos >= pmux->flen) pmux->fsta = 6;
+			break;
+		case 6 :	//FCS over address, control and length
+			pmux->fsta = (SamCmuxFcs(SamCmuxFcs(0xFF, pmux->fhdr, pmux->fhlen), &c, 1) == 0xCF) ? 7 : 0;
+			break;
+		default :	//closing flag, may open the next frame
+			if(c == CMUX_FLAG)
+			{
+				SamCmuxRxFrame(pmux);
+				pmux->fsta = 1;
+			}
+			else
+			{
+				pmux->fsta = 0;
+			}
+			break;
+	}
+}
+
+//Demultiplex everything pending on the physical port
+static void SamCmuxPump(SamCmuxTag * pmux)
+{
+	char buf[128];
+	uint16 n, i;
+	do{
+		n = ReadfoCom(pmux->comid, buf, sizeof(buf));
+		if(n > sizeof(buf)) n = 0;
+		for(i = 0; i < n; i++)
+		{
+			SamCmuxRxByte(pmux, (uint8)buf[i]);
+		}
+	}while(n == sizeof(buf));
+}
+
+SamCmuxTag * SamCmuxInit(SamCmuxTag * pmux, uint8 comid)
+{
+	uint8 i;
+	if(pmux == NULL) return(NULL);
+	pmux->comid = comid;
+	pmux->sta = NONE_CMUXSTA;
+	pmux->step = 0;
+	pmux->dcnt = 0;
+	pmux->fsta = 0;
+	pmux->drops = 0;
+	pmux->txh = 0;
+	pmux->txn = 0;
+	for(i = 0; i < CMUX_DLCMAX; i++)
+	{
+		pmux->dlc[i].sta = CLOSE_DLCSTA;
+		pmux->dlc[i].rxh = 0;
+		pmux->dlc[i].rxt = 0;
+	}
+	SamCtxCur()->pcmux = pmux;
+	return(pmux);
+}
+
+uint8 SamCmuxProc(SamCmuxTag * pmux)
+{
+	uint32 clk;
+	uint16 n;
+	uint8 i;
+	if(pmux == NULL) return(RETCHAR_FALSE);
+	SamCmuxTxPump(pmux);
+	switch(pmux->sta)
+	{
+		case NONE_CMUXSTA :
+			for(i = 0; i < CMUX_DLCMAX; i++)
+			{
+				pmux->dlc[i].sta = CLOSE_DLCSTA;
+			}
+			do{
+				n = ReadfoCom(pmux->comid, pmux->fbuf, sizeof(pmux->fbuf));
+			}while(n != 0 && n <= sizeof(pmux->fbuf));
+			pmux->txn = 0;	//frames of the closed link
+			SamCmuxTxPut(pmux, "AT+CMUX=0\r", 10);
+			DebugTrace("CMUX Start on %u!\r\n", pmux->comid);
+			pmux->fpos = 0;
+			pmux->msclk = SamGetMsCnt(0);
+			pmux->sta = WCMD_CMUXSTA;
+			break;
+		case WCMD_CMUXSTA :
+			n = ReadfoCom(pmux->comid, &(pmux->fbuf[pmux->fpos]), sizeof(pmux->fbuf) - 1 - pmux->fpos);
+			if(n <= sizeof(pmux->fbuf) - 1 - pmux->fpos) pmux->fpos += n;
+			pmux->fbuf[pmux->fpos] = 0;
+			if(Strsearch(pmux->fbuf, "OK\r\n") != 0 || SamGetMsCnt(pmux->msclk) >= CMUX_CMDTMO)
+			{
+				if(Strsearch(pmux->fbuf, "OK\r\n") == 0 && ++pmux->dcnt < 3)
+				{
+					pmux->sta = NONE_CMUXSTA;
+					break;
+				}
+				//OK, or no answer to AT+CMUX at all: the modem may already run the multiplexer
+				pmux->sta = OPEN_CMUXSTA;
+				pmux->step = 0;
+				pmux->dcnt = 0;
+				pmux->fsta = 0;
+				pmux->msclk = SamGetMsCnt(0);
+				SamCmuxFrame(pmux, 0, 1, CMUX_SABM | CMUX_PF, NULL, 0);
+			}
+			else if(pmux->fpos >= sizeof(pmux->fbuf) - 1)
+			{
+				memmove(pmux->fbuf, &(pmux->fbuf[pmux->fpos - 3]), 3);	//keep a split "OK\r\n"
+				pmux->fpos = 3;
+			}
+			break;
+		case OPEN_CMUXSTA :
+			SamCmuxPump(pmux);
+			if(pmux->sta != OPEN_CMUXSTA) break;
+			if(pmux->dlc[pmux->step].sta == OPEN_DLCSTA)
+			{
+				pmux->step++;
+				pmux->dcnt = 0;
+				if(pmux->step >= CMUX_DLCMAX)
+				{
+					DebugTrace("CMUX %u DLCs Open!\r\n", pmux->step - 1);
+					pmux->sta = RUN_CMUXSTA;
+					return(RETCHAR_TRUE);
+				}
+				pmux->msclk = SamGetMsCnt(0);
+				SamCmuxFrame(pmux, pmux->step, 1, CMUX_SABM | CMUX_PF, NULL, 0);
+			}
+			else if(SamGetMsCnt(pmux->msclk) >= CMUX_SABMTMO)
+			{
+				if(++pmux->dcnt >= 5)
+				{
+					pmux->dcnt = 0;
+					pmux->sta = NONE_CMUXSTA;
+					break;
+				}
+				pmux->msclk = SamGetMsCnt(0);
+				SamCmuxFrame(pmux, pmux->step, 1, CMUX_SABM | CMUX_PF, NULL, 0);
+			}
+			break;
+		case RUN_CMUXSTA :
+			SamCmuxPump(pmux);
+			if(pmux->sta != RUN_CMUXSTA) break;
+			if(pmux->txn != 0) SamDeadlineNote(ATCTXQ_POLLMS);	//port full, retry soon
+			return(RETCHAR_TRUE);
+		default :
+			pmux->sta = NONE_CMUXSTA;
+			break;
+	}
+	if(pmux->sta == WCMD_CMUXSTA || pmux->sta == OPEN_CMUXSTA)
+	{//start up timers, answers wake the host by themselves
+		n = (pmux->sta == WCMD_CMUXSTA) ? CMUX_CMDTMO : CMUX_SABMTMO;
+		clk = SamGetMsCnt(pmux->msclk);
+		SamDeadlineNote((clk < n) ? n - clk : 0);
+	}
+	else
+	{
+		SamDeadlineNote(0);
+	}
+	if(pmux->txn != 0) SamDeadlineNote(ATCTXQ_POLLMS);
+	return(RETCHAR_FALSE);
+}
+
+uint16 SamCmuxWrite(uint8 vcom, char * dp, uint16 dlen)
+{
+	SamCmuxTag * pmux = SamCtxCur()->pcmux;
+	uint16 n, k;
+	uint8 d;
+	d = vcom - CMUXCH_BASE;
+	if(pmux == NULL || pmux->sta != RUN_CMUXSTA || d == 0 || d >= CMUX_DLCMAX) return(0);
+	if(pmux->dlc[d].sta != OPEN_DLCSTA) return(0);
+	SamCmuxTxPump(pmux);
+	for(n = 0; n < dlen; n += k)
+	{
+		k = dlen - n;
+		if(k > SAM_CMUX_N1) k = SAM_CMUX_N1;
+		if(SamCmuxFrame(pmux, d, 1, CMUX_UIH, &dp[n], k) != RETCHAR_TRUE) break;	//the AT channel offers the rest again
+	}
+	return(n);
+}
+
+uint16 SamCmuxRead(uint8 vcom, char * dp, uint16 dmax)
+{
+	SamCmuxTag * pmux = SamCtxCur()->pcmux;
+	CmuxDlcTag * pdlc;
+	uint16 n;
+	uint8 d;
+	d = vcom - CMUXCH_BASE;
+	if(pmux == NULL || d == 0 || d >= CMUX_DLCMAX) return(0);
+	if(pmux->sta == RUN_CMUXSTA) SamCmuxPump(pmux);
+	pdlc = &(pmux->dlc[d]);
+	for(n = 0; n < dmax && pdlc->rxh != pdlc->rxt; n++)
+	{
+		dp[n] = pdlc->rxbuf[pdlc->rxh++];
+		if(pdlc->rxh >= SAM_CMUX_RXBUF_SIZE) pdlc->rxh = 0;
+	}
+	return(n);
+}
@@ -0,0 +1,133 @@
+/**
+ * @file 	SamCmux.h
+ * @brief   3GPP 27.010 multiplexer between the UART and the AT channels
+ * @details Runs the basic option of 27.010 over one physical com port and exposes
+ *			each opened DLC as a virtual com id, so every DLC can carry its own
+ *			HdsAtcTag channel. SamAtc sends and reads virtual com ids through this
+ *			layer instead of SendtoCom/ReadfoCom.
+ *
+ * @version 1.0.0
+ * @date 	2025-08-01
+ * @author 	Alex <fanbing.kong@sunseaaiot.com>
+ * @copyright Copyright (c) 2025, SIMCom Wireless Solutions Limited. All rights reserved.
+ *
+ * @note
+ *		Startup: AT+CMUX=0 on the plain port, then SABM/UA on DLC0 and DLC1..n.
+ *
+ */
+
+//---------------------------------------------------------------------------
+#ifndef __SAMCMUX_H
+#define __SAMCMUX_H
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CMUX_DLCMAX		(SAM_CMUX_DLC_NUM + 1)	//DLC0 is the control channel
+
+//virtual com id of DLC n (1..SAM_CMUX_DLC_NUM)
+#define CMUXCH_BASE		0x40
+#define CMUXCH_DLC(n)	(CMUXCH_BASE + (n))
+#define CMUXCH_IS(c)	(((c) & 0xF0) == CMUXCH_BASE)
+
+typedef struct{
+	uint8	sta;
+	uint16	rxh;		//next byte to read
+	uint16	rxt;		//next byte to write
+	char	rxbuf[SAM_CMUX_RXBUF_SIZE];
+}CmuxDlcTag;
+
+typedef struct{
+	uint8	comid;		//physical com port
+	uint8	sta;
+	uint8	step;		//DLC being opened
+	uint8	dcnt;
+	uint32	msclk;
+
+	uint8	fsta;		//receive frame state
+	uint8	fhdr[4];	//address, control and length bytes of the frame
+	uint8	fhlen;
+	uint16	flen;
+	uint16	fpos;
+	char	fbuf[SAM_CMUX_N1 + 8];
+
+	uint32	drops;		//received bytes lost on full DLC buffers
+
+	char	txbuf[SAM_CMUX_TXBUF_SIZE];	//whole frames, the port has not taken them yet
+	uint16	txh;		//first pending byte
+	uint16	txn;		//pending bytes
+	uint32	txclk;		//last time the port took bytes
+
+	CmuxDlcTag dlc[CMUX_DLCMAX];
+}SamCmuxTag;
+
+//.sta of SamCmuxTag
+#define NONE_CMUXSTA	0x00
+#define WCMD_CMUXSTA	0x01	//wait OK of AT+CMUX
+#define OPEN_CMUXSTA	0x02	//SABM/UA of dlc[step]
+#define RUN_CMUXSTA		0x03
+
+//.sta of CmuxDlcTag
+#define CLOSE_DLCSTA	0x00
+#define OPEN_DLCSTA		0x01
+
+
+/**
+ * @brief Initialize a multiplexer on a physical com port.
+ *
+ * One multiplexer per SamCtx; the virtual com ids resolve to the last one initialized
+ * in the current context.
+ *
+ * @param pmux Pointer to the SamCmuxTag structure.
+ * @param comid Physical com port id, e.g. ATCCH_A.
+ * @return Pointer to the initialized structure, or NULL if pmux is NULL.
+ */
+extern SamCmuxTag * SamCmuxInit(SamCmuxTag * pmux, uint8 comid);
+
+/**
+ * @brief Run the multiplexer start up and link supervision.
+ *
+ * Sends AT+CMUX=0, opens DLC0..SAM_CMUX_DLC_NUM and restarts after the link is closed
+ * by the modem. Call it periodically before the AT channels are processed.
+ *
+ * @param pmux Pointer to the SamCmuxTag structure.
+ * @return RETCHAR_TRUE when all DLCs are open, RETCHAR_FALSE otherwise.
+ */
+extern uint8 SamCmuxProc(SamCmuxTag * pmux);
+
+/**
+ * @brief Send data on a DLC.
+ *
+ * Data is split into UIH frames of up to SAM_CMUX_N1 bytes. Frames the port does not
+ * take at once wait in txbuf; when it has no room for the next frame the write stops
+ * there and the caller offers the rest again, as with a partial SendtoCom.
+ *
+ * @param vcom Virtual com id, CMUXCH_DLC(n).
+ * @param dp Pointer to the data.
+ * @param dlen Number of bytes.
+ * @return Number of bytes accepted, 0 if the DLC is not open or txbuf is full.
+ */
+extern uint16 SamCmuxWrite(uint8 vcom, char * dp, uint16 dlen);
+
+/**
+ * @brief Read received data of a DLC.
+ *
+ * Pending bytes of the physical port are demultiplexed to all DLCs first.
+ *
+ * @param vcom Virtual com id, CMUXCH_DLC(n).
+ * @param dp Pointer to the buffer.
+ * @param dmax Buffer size.
+ * @return Number of bytes read.
+ */
+extern uint16 SamCmuxRead(uint8 vcom, char * dp, uint16 dmax);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * @file 	SamCtx.c
+ * @brief   Context holding the state of one modem stack
+ * @details SamCtxDef backs the global API, further contexts are set up by the
+ *			application after SamCtxInit and SamCtxUse.
+ *
+ * @version 1.0.0
+ * @date 	2025-08-01
+ * @author 	Alex <fanbing.kong@sunseaaiot.com>
+ * @copyright Copyright (c) 2025, SIMCom Wireless Solutions Limited. All rights reserved.
+ *
+ * @note
+ *
+ *
+ */
+//---------------------------------------------------------------------------
+
+#define __SAMCTX_C
+
+#include "SamInc.h"
+
+SamCtxTag SamCtxDef = {.dbg = {.level = SAM_DBG_LEVEL_DEF}, .wakems = SAM_CFG_IDLE_MAX_MS};
+SAM_CTX_TLS SamCtxTag * pSamCtx = &SamCtxDef;
+
+void SamCtxInit(SamCtxTag * pctx)
+{
+	if(pctx == NULL) return;
+	memset(pctx, 0, sizeof(SamCtxTag));
+	if(pctx != pSamCtx) memcpy(&(pctx->dbg), &(pSamCtx->dbg), offsetof(sam_dbg_ctx_t, buffer));
+	else pctx->dbg.level = SAM_DBG_LEVEL_DEF;
+	pctx->wakems = SAM_CFG_IDLE_MAX_MS;
+}
+
+SamCtxTag * SamCtxUse(SamCtxTag * pctx)
+{
+	SamCtxTag * pold = pSamCtx;
+	pSamCtx = (pctx != NULL) ? pctx : &SamCtxDef;
+	return(pold);
+}
+
+HdsAtcTag * SamCtxAtc(SamCtxTag * pctx, uint8 idx)
+{
+	if(pctx == NULL) pctx = &SamCtxDef;
+	if(idx >= ATCBUS_CHMAX) return(NULL);
+	return(pctx->patc[idx]);
+}
+
+uint8 SamCtxRun(SamCtxTag * pctx, uint32 budus)
+{
+	SamCtxTag * pold;
+	uint8 ret = RETCHAR_FALSE;
+
+	if(pctx == NULL) return(RETCHAR_FALSE);
+	pold = SamCtxUse(pctx);
+#if SAM_CFG_CMUX_ENABLED
+	if(pctx->pcmux != NULL && SamCmuxProc(pctx->pcmux) != RETCHAR_TRUE)
+	{
+		SamCtxUse(pold);
+		return(RETCHAR_FALSE);
+	}
+#endif
+	if(pctx->pmdm != NULL)
+	{
+		SamMdmProcBud(pctx->pmdm, budus);
+		ret = RETCHAR_TRUE;
+	}
+	SamCtxUse(pold);
+	return(ret);
+}
+
+uint32 SamCtxNextDeadlineMs(SamCtxTag * pctx)
+{
+	SamCtxTag * pold;
+	uint32 d;
+
+	if(pctx == NULL) return(SAM_CFG_IDLE_MAX_MS);
+	pold = SamCtxUse(pctx);
+	d = SamNextDeadlineMs();
+	SamCtxUse(pold);
+	return(d);
+}
@@ -0,0 +1,137 @@
+/**
+ * @file 	SamCtx.h
+ * @brief   Context holding the state of one modem stack
+ * @details A SamCtx owns what used to be process-wide: the AT channels, the modem
+ *			host its units are linked to, the CMUX host, the timer wheel, the
+ *			wake/deadline state, the AT statistics and timeout tables, the TTS and
+ *			audio units, the uplink batch window and the logging state. The unit
+ *			APIs keep their signatures and act on the current context of the
+ *			calling thread, which SamCtxRun selects for one pass and SamCtxUse
+ *			selects until changed.
+ *
+ * @version 1.0.0
+ * @date 	2025-08-01
+ * @author 	Alex <fanbing.kong@sunseaaiot.com>
+ * @copyright Copyright (c) 2025, SIMCom Wireless Solutions Limited. All rights reserved.
+ *
+ * @note
+ *		SamCtxDef is the current context until another one is used, so a single
+ *		stack runs as before without touching this API. With several stacks,
+ *		SendtoCom/ReadfoCom tell them apart by SamCtxCur() or by distinct com ids,
+ *		and SAM_CFG_CTXTLS_ENABLED is needed when they run on separate threads.
+ *
+ */
+
+//---------------------------------------------------------------------------
+#ifndef __SAMCTX_H
+#define __SAMCTX_H
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if SAM_CFG_CTXTLS_ENABLED
+#if defined(_MSC_VER)
+#define SAM_CTX_TLS		__declspec(thread)
+#else
+#define SAM_CTX_TLS		__thread
+#endif
+#else
+#define SAM_CTX_TLS
+#endif
+
+typedef struct SamCtxTag SamCtxTag;
+struct SamCtxTag{
+	sam_dbg_ctx_t	dbg;		//logging state, see SamDebug.h
+
+	HdsAtcTag *		patc[ATCBUS_CHMAX];	//AT channels, pAtcBusArray of the context
+	void *			pmdm;		//TMdmTag of the last SamMdmInit
+	SamCmuxTag *	pcmux;		//multiplexer of the last SamCmuxInit
+	SamTmrWheelTag	tmr;
+
+	uint32			wakems;		//earliest deadline noted since the last query
+	uint8			wakerun;	//passes still to run at once after an event
+#if SAM_CFG_ATCSTAT_ENABLED
+	AtcStatTag		stat[SAM_ATCSTAT_VERB_NUM];
+	uint8			statcnt;
+#endif
+#if SAM_CFG_ATCRTO_ENABLED
+	AtcRtoTag		rto[SAM_ATCRTO_VERB_NUM];
+	uint8			rtocnt;
+#endif
+
+	TTS_Tag_T		tts;
+	Audio_Tag_T		audio;
+	SamPwrTag		pwr;		//power saving and uplink batching, see SamPwr.h
+};
+
+extern SamCtxTag SamCtxDef;
+extern SAM_CTX_TLS SamCtxTag * pSamCtx;
+
+//Context the unit APIs act on
+#define SamCtxCur()		(pSamCtx)
+
+
+/**
+ * @brief Initialize a context.
+ *
+ * Clears all state and copies the logging setup of the current context, so the
+ * output functions and levels set with sam_dbg_init carry over.
+ *
+ * @param pctx Pointer to the SamCtxTag structure.
+ */
+extern void SamCtxInit(SamCtxTag * pctx);
+
+/**
+ * @brief Make a context current on the calling thread.
+ *
+ * The unit init functions (SamAtcInit, SamMdmInit, SamCmuxInit, sam_tts_init ...)
+ * register into the current context, so use the context before setting it up.
+ *
+ * @param pctx Context to use, NULL for SamCtxDef.
+ * @return The context current before.
+ */
+extern SamCtxTag * SamCtxUse(SamCtxTag * pctx);
+
+/**
+ * @brief Get an AT channel of a context.
+ *
+ * @param pctx Context, NULL for SamCtxDef.
+ * @param idx Channel index, 0..ATCBUS_CHMAX-1.
+ * @return The channel, NULL if idx is out of range or not initialized.
+ */
+extern HdsAtcTag * SamCtxAtc(SamCtxTag * pctx, uint8 idx);
+
+/**
+ * @brief Run one pass of a context.
+ *
+ * Makes pctx current, runs its multiplexer and SamMdmProcBud of its modem, and
+ * restores the context current before.
+ *
+ * @param pctx Context to run.
+ * @param budus Time budget of the pass in us, 0: unbounded.
+ * @return RETCHAR_TRUE when the modem ran, RETCHAR_FALSE while the multiplexer is
+ *		starting or no modem is initialized.
+ */
+extern uint8 SamCtxRun(SamCtxTag * pctx, uint32 budus);
+
+/**
+ * @brief Get the time until a context needs its next pass, see SamNextDeadlineMs.
+ *
+ * @param pctx Context to check.
+ * @return Time in ms.
+ */
+extern uint32 SamCtxNextDeadlineMs(SamCtxTag * pctx);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
+/*****************************************************************************
+**                            End Of File
+******************************************************************************/
@@ -28,27 +28,8 @@ static const char *level_names[] = {
     "NONE", "ERROR", "WARN", "INFO", "DEBUG", "TRACE"
 };
 
-/* Global debug level */
-#ifdef SAM_DBG_LEVEL
-static sam_dbg_level_e global_dbg_level = SAM_DBG_LEVEL;
-#else
-static sam_dbg_level_e global_dbg_level = SAM_DBG_LEVEL_INFO;
-#endif 
-
-/* Module-specific debug levels */
-static sam_dbg_level_e module_dbg_levels[SAM_MOD_MAX];
-
-/* Custom output function */
-static sam_dbg_output_func_t custom_output_func = NULL;
-
-/* Custom get system time function */
-static sam_dbg_gettime_func_t custom_gettime_func = NULL;
-
-/* Default buffer size for log messages */
-#define SAM_DBG_BUFFER_SIZE 1024
-
-/* Internal buffer for log messages */
-static char dbg_buffer[SAM_DBG_BUFFER_SIZE];
+/* Logging state of the current context */
+#define DBGCTX (SamCtxCur()->dbg)
 
 /**
  * @brief Get the current time as a string.
@@ -58,9 +39,9 @@ static char dbg_buffer[SAM_DBG_BUFFER_SIZE];
  */
 static int get_current_time(char *buffer, uint16_t size) {
 
-    if (custom_gettime_func != NULL)
+    if (DBGCTX.gettime != NULL)
     {
-        return custom_gettime_func(buffer, size);
+        return DBGCTX.gettime(buffer, size);
     }
 
 #if defined( _WIN32) || defined(__linux__)     
@@ -108,9 +89,9 @@ static int get_current_time(char *buffer, uint16_t size) {
 static void internal_output(char *msg) {
     uint16_t len = strlen(msg);
     
-    if (custom_output_func != NULL) {
+    if (DBGCTX.output != NULL) {
         /* Use custom output function */
-        custom_output_func(msg, len);
+        DBGCTX.output(msg, len);
     } else {
         /* Default output to standard output */
         fwrite(msg, 1, len, stdout);
@@ -156,12 +137,12 @@ static void vprintf_loc(sam_dbg_level_e level, sam_module_id_e module, const cha
     /* Generate the log message prefix */
     int prefix_len = 0;
     if (module < SAM_MOD_MAX) {
-	prefix_len = snprintf(dbg_buffer, SAM_DBG_BUFFER_SIZE, 
+	prefix_len = snprintf(DBGCTX.buffer, SAM_DBG_BUFFER_SIZE, 
                              "[%s] [%s] [%s] [%s:%d] ", 
                              time_str, module_names[module], level_names[level], base_file, line);
     }
     else {
-	prefix_len = snprintf(dbg_buffer, SAM_DBG_BUFFER_SIZE, 
+	prefix_len = snprintf(DBGCTX.buffer, SAM_DBG_BUFFER_SIZE, 
                              "[%s] [%s] [%s:%d] ", 
                              time_str, level_names[level], base_file, line);
     }
@@ -171,17 +152,17 @@ static void vprintf_loc(sam_dbg_level_e level, sam_module_id_e module, const cha
     }
     
     /* Append the formatted message */
-    vsnprintf(dbg_buffer + prefix_len, SAM_DBG_BUFFER_SIZE - prefix_len, fmt, ap);
+    vsnprintf(DBGCTX.buffer + prefix_len, SAM_DBG_BUFFER_SIZE - prefix_len, fmt, ap);
     
     /* Ensure the message ends with a newline */
-    int total_len = strlen(dbg_buffer);
-    if (total_len < SAM_DBG_BUFFER_SIZE - 1 && dbg_buffer[total_len - 1] != '\n') {
-        dbg_buffer[total_len] = '\n';
-        dbg_buffer[total_len + 1] = '\0';
+    int total_len = strlen(DBGCTX.buffer);
+    if (total_len < SAM_DBG_BUFFER_SIZE - 1 && DBGCTX.buffer[total_len - 1] != '\n') {
+        DBGCTX.buffer[total_len] = '\n';
+        DBGCTX.buffer[total_len + 1] = '\0';
     }
     
     /* Output the log message */
-    internal_output(dbg_buffer);
+    internal_output(DBGCTX.buffer);
 }
 
 /**
@@ -206,7 +187,7 @@ static void vprintf_dbg(sam_dbg_level_e level, const char *fmt, va_list ap) {
 #endif	
     
     /* Generate the log message prefix */
-    int prefix_len = snprintf(dbg_buffer, SAM_DBG_BUFFER_SIZE, 
+    int prefix_len = snprintf(DBGCTX.buffer, SAM_DBG_BUFFER_SIZE, 
                              "[%s][%s] ", 
                              time_str, level_names[level]);
     
@@ -215,17 +196,17 @@ static void vprintf_dbg(sam_dbg_level_e level, const char *fmt, va_list ap) {
     }
     
     /* Append the formatted message */
-    vsnprintf(dbg_buffer + prefix_len, SAM_DBG_BUFFER_SIZE - prefix_len, fmt, ap);
+    vsnprintf(DBGCTX.buffer + prefix_len, SAM_DBG_BUFFER_SIZE - prefix_len, fmt, ap);
     
     /* Ensure the message ends with a newline */
-    int total_len = strlen(dbg_buffer);
-    if (total_len < SAM_DBG_BUFFER_SIZE - 1 && dbg_buffer[total_len - 1] != '\n') {
-        dbg_buffer[total_len] = '\n';
-        dbg_buffer[total_len + 1] = '\0';
+    int total_len = strlen(DBGCTX.buffer);
+    if (total_len < SAM_DBG_BUFFER_SIZE - 1 && DBGCTX.buffer[total_len - 1] != '\n') {
+        DBGCTX.buffer[total_len] = '\n';
+        DBGCTX.buffer[total_len + 1] = '\0';
     }
     
     /* Output the log message */
-    internal_output(dbg_buffer);
+    internal_output(DBGCTX.buffer);
 }
 
 /* Implement the functions declared in the header file */
@@ -234,7 +215,7 @@ static void vprintf_dbg(sam_dbg_level_e level, const char *fmt, va_list ap) {
  * @param level The new global debug level.
  */
 void sam_dbg_set_level(sam_dbg_level_e level) {
-    global_dbg_level = level;
+    DBGCTX.level = level;
 }
 
 /**
@@ -242,7 +223,7 @@ void sam_dbg_set_level(sam_dbg_level_e level) {
  * @return The current global debug level.
  */
 sam_dbg_level_e sam_dbg_get_level(void) {
-    return global_dbg_level;
+    return DBGCTX.level;
 }
 
 /**
@@ -252,7 +233,7 @@ sam_dbg_level_e sam_dbg_get_level(void) {
  */
 void sam_dbg_set_module_level(sam_module_id_e module, sam_dbg_level_e level) {
     if (module < SAM_MOD_MAX) {
-        module_dbg_levels[module] = level;
+        DBGCTX.module_level[module] = level;
     }
 }
 
@@ -263,9 +244,9 @@ void sam_dbg_set_module_level(sam_module_id_e module, sam_dbg_level_e level) {
  */
 sam_dbg_level_e sam_dbg_get_module_level(sam_module_id_e module) {
     if (module < SAM_MOD_MAX) {
-        return module_dbg_levels[module];
+        return DBGCTX.module_level[module];
     }
-    return global_dbg_level;
+    return DBGCTX.level;
 }
 
 /**
@@ -273,7 +254,7 @@ sam_dbg_level_e sam_dbg_get_module_level(sam_module_id_e module) {
  * @param func The custom output function, or NULL to restore the default.
  */
 void sam_dbg_set_output(sam_dbg_output_func_t func) {
-    custom_output_func = func;
+    DBGCTX.output = func;
 }
 
 /**
@@ -281,7 +262,7 @@ void sam_dbg_set_output(sam_dbg_output_func_t func) {
  * @param func The custom gettime function, or NULL to restore the default.
  */
 void sam_dbg_set_gettime(sam_dbg_gettime_func_t func) {
-    custom_gettime_func = func;
+    DBGCTX.gettime = func;
 }
 
 /**
@@ -293,7 +274,7 @@ void sam_dbg_set_gettime(sam_dbg_gettime_func_t func) {
  * @param fmt The format string.
  */
 void sam_dbg_printf_loc(sam_dbg_level_e level, sam_module_id_e module, const char *file, int line, const char *fmt, ...) {
-    if (level <= global_dbg_level && level != SAM_DBG_LEVEL_NONE) {
+    if (level <= DBGCTX.level && level != SAM_DBG_LEVEL_NONE) {
         va_list ap;
         va_start(ap, fmt);
         vprintf_loc(level, module, file, line, fmt, ap);
@@ -307,7 +288,7 @@ void sam_dbg_printf_loc(sam_dbg_level_e level, sam_module_id_e module, const cha
  * @param fmt The format string.
  */
 void sam_dbg_printf(sam_dbg_level_e level, const char *fmt, ...) {
-    if (level <= global_dbg_level && level != SAM_DBG_LEVEL_NONE) {
+    if (level <= DBGCTX.level && level != SAM_DBG_LEVEL_NONE) {
         va_list ap;
         va_start(ap, fmt);
         vprintf_dbg(level, fmt, ap);
@@ -321,24 +302,24 @@ void sam_dbg_printf(sam_dbg_level_e level, const char *fmt, ...) {
  */
 void sam_dbg_init(sam_dbg_output_func_t output, sam_dbg_gettime_func_t gettime) {
     /* set customer function */
-    custom_output_func = output;
-    custom_gettime_func = gettime;
+    DBGCTX.output = output;
+    DBGCTX.gettime = gettime;
     
     /* Set default module debug levels to the global level */
     for (int i = 0; i < SAM_MOD_MAX; i++) {
-        module_dbg_levels[i] = global_dbg_level;
+        DBGCTX.module_level[i] = DBGCTX.level;
     }
 
 #ifdef SAM_MQTT_DBG_LEVEL
-	module_dbg_levels[SAM_MOD_MQTT] = SAM_MQTT_DBG_LEVEL;
+	DBGCTX.module_level[SAM_MOD_MQTT] = SAM_MQTT_DBG_LEVEL;
 #endif
 
 #ifdef SAM_HTTP_DBG_LEVEL
-	module_dbg_levels[SAM_MOD_HTTP] = SAM_HTTP_DBG_LEVEL;
+	DBGCTX.module_level[SAM_MOD_HTTP] = SAM_HTTP_DBG_LEVEL;
 #endif
 
 #ifdef SAM_SMS_DBG_LEVEL
-	module_dbg_levels[SAM_MOD_SMS] = SAM_SMS_DBG_LEVEL;
+	DBGCTX.module_level[SAM_MOD_SMS] = SAM_SMS_DBG_LEVEL;
 #endif
 
 }
@@ -352,7 +333,7 @@ void DebugTrace(const char *format, ...)
 	char tbuf[16];
 	char buf[1025];
 
-	//if (SAM_DBG_LEVEL_TRACE > global_dbg_level ) return; 
+	//if (SAM_DBG_LEVEL_TRACE > DBGCTX.level ) return; 
 
 	t = GetSysTickCnt();
 	snprintf(tbuf, 16, "%09u:", t);
@@ -59,6 +59,24 @@ typedef void (*sam_dbg_output_func_t)(char *msg, uint16_t len);
  */
 typedef int (*sam_dbg_gettime_func_t)(char *buffer, uint16_t len);
 
+/* Level a context starts with */
+#ifdef SAM_DBG_LEVEL
+#define SAM_DBG_LEVEL_DEF      SAM_DBG_LEVEL
+#else
+#define SAM_DBG_LEVEL_DEF      SAM_DBG_LEVEL_INFO
+#endif
+
+/**
+ * @brief Logging state of one SamCtx, the functions below act on the current context.
+ */
+typedef struct {
+    sam_dbg_level_e level;                        /**< Global debug level */
+    sam_dbg_level_e module_level[SAM_MOD_MAX];    /**< Module-specific debug levels */
+    sam_dbg_output_func_t output;                 /**< Custom output function */
+    sam_dbg_gettime_func_t gettime;               /**< Custom get system time function */
+    char buffer[SAM_DBG_BUFFER_SIZE];             /**< Message being formatted */
+} sam_dbg_ctx_t;
+
 /**
  * @brief Initialize the debug logging system.
  * @note Should be called at system startup.
@@ -73,6 +73,9 @@ uint8_t Sam_Fota_Process(struct Sam_Fota_t* self);
 #define Sam_Mdm_Atc_checkAtRsp SamChkAtcRet
 #define Sam_Mdm_Atc_sendAtCmd SamSendAtCmd
 #define Sam_Mdm_Atc_sendAtSeg SamSendAtSeg
+#define Sam_Mdm_Atc_checkAtSet SamChkAtcSet
+
+static StrsSetTag fotaUrcSet = STRSSET_DEF("+CFOTA: FOTA,START\r\t+CFOTA: FOTA,START \t+CFOTA: FOTA,ERROR\r\t+CFOTA: FOTA,END\r\t+CFOTA: DOWNLOADING:\t+CFOTA: UPDATE:\t+CFOTA: UPDATE SUCCESS.\t+CFOTA: UPDATE FAIL\t+CFOTA: ");
 
 static void Sam_Mdm_Atc_clearAtRevBuff(Sam_Mdm_Atc_t* self) {
     if (self == NULL)
@@ -104,7 +107,7 @@ Sam_Fota_t* Sam_Fota_Create(const Sam_Fota_Config_t* config) {
     self->base.state = FOTA_STATE_IDLE;
     self->base.step = 0;
     self->base.dcnt = 0;
-    self->base.msclk = SamGetMsCnt(0);
+    self->base.stmr = SamTmrStart(0, 1000, 1000);
     self->base.sclk = 0;
     
     // Set default values
@@ -117,6 +120,8 @@ Sam_Fota_t* Sam_Fota_Create(const Sam_Fota_Config_t* config) {
     
         self->phatc = pAtcBusArray[self->config.atChannelId];	    
         self->runlink =	SamAtcFunLink(self->phatc, self, (SamMdmFunTag)Sam_Fota_Process, (SamUrcBcFunTag)handleAtUrc);
+        SamAtcFunPrio(self->phatc, self->runlink, LOW_FUNPRIO, 0);
+        SamAtcUrcLink(self->phatc, self->runlink, "+CFOTA:");
     }
     
     // Set default methods
@@ -148,6 +153,8 @@ void Sam_Fota_Destroy(Sam_Fota_t* self) {
     if (self->phatc != NULL) {
         // Unregister URC handler
         SamAtcFunUnlink(self->phatc, self->runlink);
+        SamTmrStop(self->base.stmr);
+        self->base.stmr = 0;
     }
     
     free(self);
@@ -202,7 +209,7 @@ bool Sam_Fota_Init(struct Sam_Fota_t* self, const char * cfgstr) {
     self->base.state = FOTA_STATE_IDLE;
     self->base.step = 0;
     self->base.dcnt = 0;
-    self->base.msclk = SamGetMsCnt(0);
+    self->base.stmr = SamTmrStart(self->base.stmr, 1000, 1000);  // rearm the timer of Create, 0 takes one
     self->base.sclk = 0;
     
     // Set default values
@@ -212,6 +219,8 @@ bool Sam_Fota_Init(struct Sam_Fota_t* self, const char * cfgstr) {
     self->phatc = pAtcBusArray[self->config.atChannelId];
 	    
     self->runlink =	SamAtcFunLink(self->phatc, self, (SamMdmFunTag)Sam_Fota_Process, (SamUrcBcFunTag)handleAtUrc);
+    SamAtcFunPrio(self->phatc, self->runlink, LOW_FUNPRIO, 0);
+    SamAtcUrcLink(self->phatc, self->runlink, "+CFOTA:");
     SAM_DBG_MODULE(SAM_MOD_FOTA, SAM_DBG_LEVEL_TRACE, "Fota module initialized. runlink = %d\n", self->runlink);
     return true;
 }
@@ -232,6 +241,8 @@ bool Sam_Fota_Deinit(struct Sam_Fota_t* self) {
     // Cleanup resources
     if (self->phatc != NULL) {
         SamAtcFunUnlink(self->phatc, self->runlink);
+        SamTmrStop(self->base.stmr);
+        self->base.stmr = 0;
         self->phatc = NULL;
     }
     
@@ -264,6 +275,7 @@ bool Sam_Fota_Init(struct Sam_Fota_t* self, const Sam_Fota_Config_t* config) {
     
     // Register URC handler
     self->base.runlink = SamAtcFunLink(self->phatc, self, NULL, handleAtUrc);
+    SamAtcUrcLink(self->phatc, self->base.runlink, "+CFOTA:");
     if (self->base.runlink == 0) {
         SAM_DBG_MODULE(SAM_MOD_FOTA, SAM_DBG_LEVEL_ERROR, "Failed to register URC handler\n");
         return false;
@@ -289,6 +301,8 @@ bool Sam_Fota_Deinit(struct Sam_Fota_t* self) {
     // Cleanup resources
     if (self->phatc != NULL) {
         SamAtcFunUnlink(self->phatc, self->base.runlink);
+        SamTmrStop(self->base.stmr);
+        self->base.stmr = 0;
         self->phatc = NULL;
     }
     
@@ -471,14 +485,7 @@ uint8_t Sam_Fota_Process(struct Sam_Fota_t* self) {
     }
 
     uint8_t result = RETCHAR_FREE;
-    uint32_t clk = 0;
-    clk = SamGetMsCnt(self->base.msclk);
-    while(clk >= 1000)
-    {
-    	self->base.msclk +=1000;
-    	self->base.sclk += 1;
-    	clk -= 1000;
-    }
+    self->base.sclk += SamTmrPeriod(&(self->base.stmr), 1000);
 
     // ݲͬ״̬
     switch (self->base.state) {
@@ -486,7 +493,7 @@ uint8_t Sam_Fota_Process(struct Sam_Fota_t* self) {
             {
                 if (self->base.step == 0)
                 { 
-                    while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
+                    while(Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
 
                     char atCmd[1024];
                     snprintf(atCmd, sizeof(atCmd), AT_FOTA_DOWNLOAD, self->config.channel, self->config.mode, self->config.serverUrl, self->config.username, self->config.password);
@@ -497,7 +504,7 @@ uint8_t Sam_Fota_Process(struct Sam_Fota_t* self) {
                 else if (self->base.step == 1)
                 {
                     uint8_t ratcret = 0;
-                    ratcret = Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n");
+                    ratcret = Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet);
                     if (ratcret == NOSTRRET_ATCRET)
                     {
                         // continue wait
@@ -619,7 +626,7 @@ static uint8_t handleAtUrc(void* context, char* urcBuff) {
     Sam_Fota_t* self = (Sam_Fota_t*)context;
     uint8_t temp = 0;
     
-    temp = StrsCmp(urcBuff, "+CFOTA: FOTA,START\r\t+CFOTA: FOTA,START \t+CFOTA: FOTA,ERROR\r\t+CFOTA: FOTA,END\r\t+CFOTA: DOWNLOADING:\t+CFOTA: UPDATE:\t+CFOTA: UPDATE SUCCESS.\t+CFOTA: UPDATE FAIL\t+CFOTA: ");
+    temp = StrsSetCmp(urcBuff, &fotaUrcSet);
 //    SAM_DBG_MODULE(SAM_MOD_FOTA, SAM_DBG_LEVEL_ERROR, "handleAtUrc: %s, temp=%d\n", urcBuff, temp);
 
     if (temp == 1) // received +CFOTA: FOTA,START\r
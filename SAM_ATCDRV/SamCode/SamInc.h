@@ -21,6 +21,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 
 
 #ifdef __cplusplus
@@ -56,8 +57,15 @@ typedef enum{
 	
 }SamRetChar;
 
+//one fragment of a vectored send
+typedef struct{
+	char *	dp;
+	uint16	len;
+}SamIovTag;
+
 #include "SamSub.h"
 #include "SamDebug.h"
+#include "SamTmr.h"
 #include "SamAtc.h"
 #include "SamMdm.h"
 #include "SamMqtt.h"
@@ -66,17 +74,30 @@ typedef enum{
 #include "SamTTS.h"
 #include "SamFota.h"
 #include "SamSms.h"
+#include "SamCmux.h"
+#include "SamPwr.h"
 
+#if SAM_CFG_CMUX_ENABLED
+#define ATCBUS_CHMAX	SAM_CMUX_DLC_NUM	//one AT channel per DLC
+#else
 #define ATCBUS_CHMAX	1
-extern HdsAtcTag *pAtcBusArray[ATCBUS_CHMAX];
+#endif
+#include "SamCtx.h"
+#define pAtcBusArray	(SamCtxCur()->patc)	//AT channels of the current context
 
 
 //Functions that require external implementation
 #define 	ATCCH_A		0x01
 #define		DBGCH_A		0x02
 extern unsigned int  GetSysTickCnt(void);
+#if SAM_CFG_PROCBUD_ENABLED || SAM_CFG_FUNACCT_ENABLED
+extern unsigned int  GetSysUsCnt(void);
+#endif
 extern unsigned short SendtoCom(unsigned char com, char *dp, unsigned short dlen);
 extern unsigned short ReadfoCom(unsigned char com, char *dp,  unsigned short dmax);
+#if SAM_CFG_COMV_ENABLED
+extern unsigned short SendtoComV(unsigned char com, SamIovTag *iov, unsigned char cnt);
+#endif
 
 
 #ifdef __cplusplus
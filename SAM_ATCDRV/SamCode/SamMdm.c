@@ -21,33 +21,802 @@
 
 #include "SamInc.h"
 
+static StrsSetTag MdmInitRetSet = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CPIN:\t+CGATT:\t+CPSI:\t+CGPADDR:\t+SIMEI:\t+ICCID:\t+CGMR:\t+CSQ:\t+CGCONTRDP:");
+static StrsSetTag MdmPollRetSet = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CSQ:\t+CPIN:\t+CPSI:");
+
+static StrsSetTag MdmPdnRetSet = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CME ERROR");
+static StrsSetTag MdmUserAtcSet = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CME ERROR\t+CMS ERROR");
+static StrsSetTag MdmLinkRetSet = STRSSET_DEF("OK\r\n\tERROR\r\n\t+IPR:\t+CME ERROR");
+static StrsSetTag MdmUrcSet = STRSSET_DEF("+SIMCARD: NOT AVAILABLE\t+CGEV: ME DETACH\t+CGEV: NW DETACH\t+CGEV: ME PDN DEACT\t+CGEV: NW PDN DEACT\t+CPIN: READY\t+CPIN:\t+CREG:\t+CGREG:\t+CEREG:");
+
+//PS is registered while GPRS or EPS reports home or roaming, domains not reported yet do not count
+static void SamMdmRegUpdate(TMdmTag * pmdm)
+{
+	uint8 i, known, reg;
+	known = 0;
+	reg = 0;
+	for(i = GPRS_MDMREG; i <= EPS_MDMREG; i++)
+	{
+		if(pmdm->regsta[i] == NONE_MDMREG) continue;
+		known = 1;
+		if(pmdm->regsta[i] == 1 || pmdm->regsta[i] == 5) reg = 1;
+	}
+	if(known == 0) return;
+	if(reg != 0)
+	{
+		pmdm->conditon |= PSREG_MDMCND;
+	}
+	else if((pmdm->conditon & PSREG_MDMCND) != 0)
+	{
+		pmdm->conditon &= ~(PSREG_MDMCND);
+		pmdm->urcbmk |= RECHK_MDMURC;
+		DebugTrace("PS network lost!\r\n");
+	}
+}
+
+//+CREG: <stat>[,"<lac>","<ci>"[,<AcT>]] as URC, +CREG: <n>,<stat>[,...] as query response
+static void SamMdmRegLine(TMdmTag * pmdm, uint8 dom, char * urcstr)
+{
+	char fld[12];
+	char * p;
+	uint8 n;
+
+	p = strchr(urcstr, ':');
+	if(p == NULL || GetPmrStr(p + 1, ',', 0, fld, sizeof(fld)) == 0) return;
+	n = 1;	//field of <stat>
+	if(GetPmrStr(p + 1, ',', 1, fld, sizeof(fld)) == 0 || fld[0] == '"')
+	{
+		pmdm->regurc |= (1 << dom);
+		n = 0;
+	}
+	else
+	{//query response, reporting is on unless <n> in field 0 is 0
+		GetPmrStr(p + 1, ',', 0, fld, sizeof(fld));
+		if(fld[0] != '0') pmdm->regurc |= (1 << dom);
+	}
+	GetPmrStr(p + 1, ',', n, fld, sizeof(fld));
+	if(fld[0] < '0' || fld[0] > '9') return;
+	pmdm->regsta[dom] = (uint8)(fld[0] - '0');
+	if(GetPmrStr(p + 1, ',', n + 1, fld, sizeof(fld)) > 2 && fld[0] == '"')
+	{
+		pmdm->radio.lac = (uint16)strtoul(fld + 1, NULL, 16);
+	}
+	if(GetPmrStr(p + 1, ',', n + 2, fld, sizeof(fld)) > 2 && fld[0] == '"')
+	{
+		pmdm->radio.cellid = strtoul(fld + 1, NULL, 16);
+	}
+	if(dom != CS_MDMREG) SamMdmRegUpdate(pmdm);
+}
+
+//Context n (cid - 1) has no address any more, its tries are kept
+static void SamMdmPdnDown(TMdmTag * pmdm, uint8 n)
+{
+	uint8 tries;
+	tries = pmdm->pdn[n].tries;
+	memset(&(pmdm->pdn[n]), 0, sizeof(TMdmPdnTag));
+	pmdm->pdn[n].tries = tries;
+	pmdm->conditon &= ~((IPABIT_MDMCND<<n) & IPBMSK_MDMCND);
+	if((pmdm->conditon & IPBMSK_MDMCND) == 0) pmdm->conditon &= ~(IPACT_MDMCND);
+}
+
+//All contexts down, for a detach or a new bring-up
+static void SamMdmPdnReset(TMdmTag * pmdm)
+{
+	memset(pmdm->pdn, 0, sizeof(pmdm->pdn));
+	pmdm->conditon &= ~(IPACT_MDMCND | IPBMSK_MDMCND);
+}
+
+//+CGEV: NW PDN DEACT <cid>, the address of the context is gone
+static void SamMdmPdnDeact(TMdmTag * pmdm, char * urcstr)
+{
+	char * p;
+	uint32 cid;
+	p = strstr(urcstr, "DEACT");
+	if(p == NULL) return;
+	cid = strtoul(p + 5, NULL, 10);
+	if(cid >= 1 && cid <= MDMPDN_MAX)
+	{
+		SamMdmPdnDown(pmdm, (uint8)(cid - 1));
+		pmdm->pdn[cid - 1].tries = 0;
+	}
+	pmdm->urcbmk |= RECHK_MDMURC;
+}
+
+//Starts of the comma separated fields of sp, up to max, returns the fields found
+static uint8 SamMdmFields(char * sp, char ** fp, uint8 max)
+{
+	uint8 n;
+	for(n = 0; n < max && sp != NULL; n++)
+	{
+		while(*sp == ' ') sp++;
+		fp[n] = sp;
+		sp = strchr(sp, ',');
+		if(sp != NULL) sp++;
+	}
+	return(n);
+}
+
+//Address field of +CGPADDR or +CGCONTRDP, quoted or not: dotted decimal (4 or 16
+//octets, 8 or 32 with a subnet mask) or IPv6 colon hex. Returns the octets of the
+//address to dp, 4 or 16, 0 for none
+static uint8 SamMdmAddrGet(const char * sp, uint8 * dp)
+{
+	uint8 oct[32];
+	uint8 n, z;
+	uint32 v;
+	char * ep;
+	if(*sp == '"') sp++;
+	for(ep = (char *)sp; (*ep >= '0' && *ep <= '9') || (*ep >= 'A' && *ep <= 'F') || (*ep >= 'a' && *ep <= 'f') || *ep == '.'; ep++);
+	if(*ep != ':')
+	{
+		for(n = 0; n < 32; )
+		{
+			v = strtoul(sp, &ep, 10);
+			if(ep == sp || v > 255) break;
+			oct[n++] = (uint8)v;
+			if(*ep != '.') break;
+			sp = ep + 1;
+		}
+		if(n == 8) n = 4;
+		if(n == 32) n = 16;
+		if(n != 4 && n != 16) return(0);
+		memcpy(dp, oct, n);
+		return(n);
+	}
+	//8 groups, one "::" standing for the zero groups left out
+	n = 0;
+	z = 0xFF;
+	if(sp[0] == ':' && sp[1] == ':')
+	{
+		z = 0;
+		sp += 2;
+	}
+	while(n < 8)
+	{
+		v = strtoul(sp, &ep, 16);
+		if(ep == sp || v > 0xFFFF) break;
+		oct[2 * n] = (uint8)(v >> 8);
+		oct[2 * n + 1] = (uint8)v;
+		n++;
+		if(ep[0] != ':') break;
+		if(ep[1] == ':' && z == 0xFF)
+		{
+			z = n;
+			sp = ep + 2;
+		}
+		else
+		{
+			sp = ep + 1;
+		}
+	}
+	if(z == 0xFF)
+	{
+		if(n != 8) return(0);
+	}
+	else
+	{
+		if(n > 7) return(0);
+		memmove(&oct[16 - 2 * (n - z)], &oct[2 * z], 2 * (n - z));
+		memset(&oct[2 * z], 0, 16 - 2 * n);
+	}
+	memcpy(dp, oct, 16);
+	return(16);
+}
+
+static uint8 SamMdmAddrNz(const uint8 * dp, uint8 len)
+{
+	while(len-- > 0)
+	{
+		if(dp[len] != 0) return(1);
+	}
+	return(0);
+}
+
+static const char * const MdmRatStr[] = {"NO SERVICE", "GSM", "WCDMA", "LTE", "CAT-M", "NB-IOT", "NR5G"};
+
+//+CPSI: <mode>,<op>,<mcc>-<mnc>,<lac>,<cellid>,... the fields are split in one pass,
+//LTE, CAT-M and NB-IoT go on <band>,<earfcn>,<dlbw>,<ulbw>,<rsrq>,<rsrp>,<rssi>,<sinr>
+//and GSM on <arfcn band>,<rxlev>
+static void SamMdmRadioCpsi(TMdmTag * pmdm, char * sp)
+{
+	TMdmRadioTag * prad = &(pmdm->radio);
+	char * fp[14];
+	char * ep;
+	uint8 n, i;
+	n = SamMdmFields(sp, fp, 14);
+	prad->rat = OTHER_MDMRAT;
+	for(i = 0; i < sizeof(MdmRatStr) / sizeof(MdmRatStr[0]); i++)
+	{
+		if(strncmp(fp[0], MdmRatStr[i], strlen(MdmRatStr[i])) == 0)
+		{
+			prad->rat = i;
+			break;
+		}
+	}
+	prad->band = 0;
+	prad->rsrp = UNKN_MDMRAD;
+	prad->rsrq = UNKN_MDMRAD;
+	prad->rssi = UNKN_MDMRAD;
+	prad->sinr = UNKN_MDMRAD;
+	if(prad->rat == NONE_MDMRAT || n < 5)
+	{
+		prad->mcc = 0;
+		prad->mnc = 0;
+		prad->lac = 0;
+		prad->cellid = 0;
+	}
+	else
+	{
+		prad->mcc = (uint16)strtoul(fp[2], &ep, 10);
+		prad->mnc = (*ep == '-') ? (uint16)strtoul(ep + 1, NULL, 10) : 0;
+		prad->lac = (uint16)strtoul(fp[3], NULL, 16);
+		prad->cellid = strtoul(fp[4], NULL, 0);
+	}
+	if((prad->rat == LTE_MDMRAT || prad->rat == CATM_MDMRAT || prad->rat == NBIOT_MDMRAT) && n >= 14)
+	{
+		ep = strstr(fp[6], "BAND");
+		if(ep != NULL && ep < fp[7]) prad->band = (uint16)strtoul(ep + 4, NULL, 10);
+		prad->rsrq = (int16)strtol(fp[10], NULL, 10);
+		prad->rsrp = (int16)strtol(fp[11], NULL, 10);
+		prad->rssi = (int16)strtol(fp[12], NULL, 10);
+		prad->sinr = (int16)strtol(fp[13], NULL, 10);
+	}
+	else if(prad->rat == GSM_MDMRAT && n >= 7)
+	{
+		prad->rssi = (int16)(strtol(fp[6], NULL, 10) * 10);
+	}
+	prad->tick = SamTmrNow();
+	pmdm->radhis[pmdm->radhead] = *prad;
+	pmdm->radhead = (uint8)((pmdm->radhead + 1) % SAM_MDM_RADIO_HIS);
+	if(pmdm->radcnt < SAM_MDM_RADIO_HIS) pmdm->radcnt++;
+}
+
+//+CGPADDR: <cid>[,<addr>[,<addr>]], IPv4 and/or IPv6, with or without quotes
+static void SamMdmRadioAddr(TMdmTag * pmdm, char * sp)
+{
+	TMdmPdnTag * ppdn;
+	char * fp[3];
+	uint8 ip[16];
+	uint8 n, i;
+	uint32 cid;
+	n = SamMdmFields(sp, fp, 3);
+	cid = strtoul(fp[0], NULL, 10);
+	if(cid < 1 || cid > MDMPDN_MAX) return;
+	ppdn = &(pmdm->pdn[cid - 1]);
+	memset(ppdn->ip4, 0, sizeof(ppdn->ip4));
+	memset(ppdn->ip6, 0, sizeof(ppdn->ip6));
+	for(i = 1; i < n; i++)
+	{
+		if(SamMdmAddrGet(fp[i], ip) == 4)
+		{
+			memcpy(ppdn->ip4, ip, 4);
+		}
+		else if(SamMdmAddrGet(fp[i], ip) == 16)
+		{
+			memcpy(ppdn->ip6, ip, 16);
+		}
+	}
+	if(SamMdmAddrNz(ppdn->ip4, 4) == 0 && SamMdmAddrNz(ppdn->ip6, 16) == 0)
+	{
+		if(ppdn->state == UP_MDMPDN) SamMdmPdnDown(pmdm, (uint8)(cid - 1));
+		return;
+	}
+	ppdn->state = UP_MDMPDN;
+	ppdn->tries = 0;
+	pmdm->conditon |= ((IPABIT_MDMCND<<(cid - 1)) & IPBMSK_MDMCND);
+	pmdm->conditon |= IPACT_MDMCND;
+	DebugTrace("IPAddr%u:%u.%u.%u.%u\r\n", cid, ppdn->ip4[0], ppdn->ip4[1], ppdn->ip4[2], ppdn->ip4[3]);
+}
+
+//+CGCONTRDP: <cid>,<bearer>,<apn>,<addr and mask>,<gw>,<dns1>,<dns2>,<pcscf1>,<pcscf2>,
+//<im cn>,<lipa>,<IPv4 MTU>, one line per address family of the context
+static void SamMdmRadioCtx(TMdmTag * pmdm, char * sp)
+{
+	TMdmPdnTag * ppdn;
+	char * fp[12];
+	uint8 ip[16];
+	uint8 n, i;
+	uint32 cid;
+	n = SamMdmFields(sp, fp, 12);
+	cid = strtoul(fp[0], NULL, 10);
+	if(cid < 1 || cid > MDMPDN_MAX || n < 4) return;
+	ppdn = &(pmdm->pdn[cid - 1]);
+	if(SamMdmAddrGet(fp[3], ip) == 16)
+	{
+		for(i = 0; i < 2 && 5 + i < n; i++)
+		{
+			if(SamMdmAddrGet(fp[5 + i], ip) == 16) memcpy(ppdn->dns6[i], ip, 16);
+		}
+	}
+	else
+	{
+		for(i = 0; i < 2 && 5 + i < n; i++)
+		{
+			if(SamMdmAddrGet(fp[5 + i], ip) == 4) memcpy(ppdn->dns4[i], ip, 4);
+		}
+		if(n >= 12) ppdn->mtu = (uint16)strtoul(fp[11], NULL, 10);
+	}
+}
+
+uint8 SamMdmRadioLine(TMdmTag * pmdm, char * line)
+{
+	char * ep;
+	if(pmdm == NULL || line == NULL) return(0);
+	while(*line == '\r' || *line == '\n' || *line == ' ') line++;
+	if(strncmp(line, "+CPSI:", 6) == 0)
+	{
+		SamMdmRadioCpsi(pmdm, line + 6);
+		return(CPSI_MDMRAD);
+	}
+	if(strncmp(line, "+CSQ:", 5) == 0)
+	{//+CSQ: <rssi>,<ber>
+		pmdm->radio.csq = (uint8)strtoul(line + 5, &ep, 10);
+		pmdm->radio.ber = (*ep == ',') ? (uint8)strtoul(ep + 1, NULL, 10) : 99;
+		return(CSQ_MDMRAD);
+	}
+	if(strncmp(line, "+CGPADDR:", 9) == 0)
+	{
+		SamMdmRadioAddr(pmdm, line + 9);
+		return(CGPADDR_MDMRAD);
+	}
+	if(strncmp(line, "+CGCONTRDP:", 11) == 0)
+	{
+		SamMdmRadioCtx(pmdm, line + 11);
+		return(CGCONTRDP_MDMRAD);
+	}
+	return(0);
+}
+
+TMdmPdnTag * SamMdmPdnGet(TMdmTag * pmdm, uint8 cid)
+{
+	if(pmdm == NULL || cid < 1 || cid > MDMPDN_MAX || pmdm->pdn[cid - 1].state != UP_MDMPDN) return(NULL);
+	return(&(pmdm->pdn[cid - 1]));
+}
+
+uint8 SamMdmRadioGet(TMdmTag * pmdm, uint8 back, TMdmRadioTag * prad)
+{
+	if(pmdm == NULL || prad == NULL || back >= pmdm->radcnt) return(RETCHAR_FALSE);
+	*prad = pmdm->radhis[(pmdm->radhead + SAM_MDM_RADIO_HIS - 1 - back) % SAM_MDM_RADIO_HIS];
+	return(RETCHAR_TRUE);
+}
+
 unsigned char SamMdmUrcCbfun(void * pvmdm, char * urcstr)
 {
 	TMdmTag * pmdm = NULL;
-	uint8 temp;
-	char myurcstr[256];
 	
 	pmdm = (TMdmTag *)pvmdm; 
 	
-	sprintf(myurcstr, "+SIMCARD: NOT AVAILABLE\t+CGEV: ME DETACH");
-	temp = StrsCmp(urcstr, myurcstr);
-	if(temp == 1)
+	switch(StrsSetCmp(urcstr, &MdmUrcSet))
 	{
-		pmdm->urcbmk |= 0x01;
-		pmdm->conditon &= ~(CPINR_MDMCND);
+		case 1:		//+SIMCARD: NOT AVAILABLE
+			pmdm->urcbmk |= RECHK_MDMURC;
+			pmdm->conditon &= ~(CPINR_MDMCND);
+			break;
+		case 2:		//+CGEV: ME DETACH
+		case 3:		//+CGEV: NW DETACH
+			pmdm->urcbmk |= RECHK_MDMURC;
+			pmdm->conditon &= ~(PSREG_MDMCND);
+			pmdm->regsta[GPRS_MDMREG] = NONE_MDMREG;	//registered again on the next +CGREG/+CEREG only
+			pmdm->regsta[EPS_MDMREG] = NONE_MDMREG;
+			SamMdmPdnReset(pmdm);
+			break;
+		case 4:
+		case 5:
+			SamMdmPdnDeact(pmdm, urcstr);
+			break;
+		case 6:		//+CPIN: READY
+			pmdm->conditon |= CPINR_MDMCND;
+			pmdm->conditon &= ~(WFPIN_MDMCND);
+			break;
+		case 7:		//+CPIN: NOT READY, SIM PIN ...
+			if((pmdm->conditon & CPINR_MDMCND) != 0) pmdm->urcbmk |= RECHK_MDMURC;
+			pmdm->conditon &= ~(CPINR_MDMCND);
+			if(Strsearch(urcstr, "SIM P") != 0) pmdm->conditon |= WFPIN_MDMCND;
+			break;
+		case 8:
+			SamMdmRegLine(pmdm, CS_MDMREG, urcstr);
+			break;
+		case 9:
+			SamMdmRegLine(pmdm, GPRS_MDMREG, urcstr);
+			break;
+		case 10:
+			SamMdmRegLine(pmdm, EPS_MDMREG, urcstr);
+			break;
+		default:
+			break;
 	}
-	else if(temp == 2)
+	return(RETCHAR_NONE);
+}
+
+//Lines and result of the periodic status poll, up to 3 tries before recovery
+static void SamMdmPollCb(void * pd, AtcReqTag * preq, uint8 ret, char * line)
+{
+	TMdmTag * pmdm = (TMdmTag *)pd;
+	if(pmdm->sta != FFUN_MDMSTA) return;
+	if(ret == NOSTRRET_ATCRET)
 	{
-		pmdm->urcbmk |= 0x01;
-		pmdm->conditon &= ~(PSREG_MDMCND);
+		if(Strsearch(line, "+CPIN: READY") != 0)
+		{
+			pmdm->conditon |= CPINR_MDMCND;
+		}
+		else if(strncmp(line, "+CGATT: ", 8) == 0)
+		{//a re-attach the modem did not report by +CGREG/+CEREG
+			if(line[8] == '1') pmdm->conditon |= PSREG_MDMCND;
+			else pmdm->conditon &= ~(PSREG_MDMCND);
+		}
+		else if(SamMdmRadioLine(pmdm, line) == CPSI_MDMRAD && pmdm->radio.rat == NONE_MDMRAT)
+		{
+			pmdm->sta = FAIL_MDMSTA;
+			pmdm->step = 0;
+		}
+	}
+	else if(ret != 1)
+	{
+		pmdm->dcnt++;
+		if(pmdm->dcnt > 3)
+		{
+			pmdm->sta = FAIL_MDMSTA;
+			pmdm->step = 0;
+		}
+		else
+		{
+			SamAtcReqSubmit(pmdm->patc, preq);
+		}
+	}
+}
+
+static uint16 SamMdmSum(const void * dp, uint16 len)
+{
+	const uint8 * p = (const uint8 *)dp;
+	uint16 sum = 0;
+	while(len--) sum = (uint16)(sum * 31 + *p++);
+	return(sum);
+}
+
+static uint16 SamMdmPdnSum(TMdmTag * pmdm)
+{
+	char sbuf[256];
+	if(ReadCfgTab(pmdm->cfg, CFGMDM_HEADSTR, CFGMDM_PDNCFG, sbuf) == 0) sbuf[0] = 0;
+	return(SamMdmSum(sbuf, strlen(sbuf)));
+}
+
+//Read the record back, a valid one lets the bring-up only compare identities
+static void SamMdmWarmLoad(TMdmTag * pmdm, TMdmWarmTag * pwarm)
+{
+	pmdm->warm = COLD_MDMWARM;
+	if(pmdm->pstore == NULL) return;
+	if(pmdm->pstore(0, pwarm, sizeof(TMdmWarmTag)) != sizeof(TMdmWarmTag)) return;
+	if(pwarm->ver != MDMWARM_VER || pwarm->chk != SamMdmSum(pwarm, offsetof(TMdmWarmTag, chk))) return;
+	pmdm->warm = CHK_MDMWARM;
+}
+
+//After the identities are read: compare them with the record, or save it after a full bring-up
+static void SamMdmWarmStep(TMdmTag * pmdm)
+{
+	TMdmWarmTag warm;
+	if(pmdm->warm == CHK_MDMWARM)
+	{
+		SamMdmWarmLoad(pmdm, &warm);
+		if(pmdm->warm == CHK_MDMWARM && warm.pdnsum == SamMdmPdnSum(pmdm)
+			&& strcmp(warm.fwver, pmdm->fwver) == 0 && strcmp(warm.imei, pmdm->imei) == 0
+			&& strcmp(warm.ccid, pmdm->ccid) == 0 && strcmp(warm.imsi, pmdm->imsi) == 0)
+		{
+			pmdm->warm = HIT_MDMWARM;
+			DebugTrace("Warm start, modem and SIM unchanged\r\n");
+			return;
+		}
+		pmdm->warm = COLD_MDMWARM;
+		DebugTrace("Modem, SIM or PDN changed, full bring-up\r\n");
+		return;
+	}
+	pmdm->warm = HIT_MDMWARM;
+	if(pmdm->pstore == NULL) return;
+	if(pmdm->warmerr != 0)
+	{//a PDN setting may not be applied, the next boot goes the full way again
+		DebugTrace("Bring-up had errors, warm record not saved\r\n");
+		return;
+	}
+
+	memset(&warm, 0, sizeof(warm));
+	warm.ver = MDMWARM_VER;
+	warm.pdnsum = SamMdmPdnSum(pmdm);
+	strcpy(warm.fwver, pmdm->fwver);
+	strcpy(warm.imei, pmdm->imei);
+	strcpy(warm.ccid, pmdm->ccid);
+	strcpy(warm.imsi, pmdm->imsi);
+	warm.chk = SamMdmSum(&warm, offsetof(TMdmWarmTag, chk));
+	pmdm->pstore(1, &warm, sizeof(warm));
+}
+
+//Activation (act 1) or deactivation (act 0) commands of the contexts in msk (bit cid - 1),
+//one +CGACT for all of them, +CNACT takes one context per command
+static void SamMdmPdnActCmd(TMdmTag * pmdm, char * buf, uint8 act, uint8 msk)
+{
+	char tbuf[16];
+	uint8 i;
+	buf[0] = 0;
+	for(i = 0; i < MDMPDN_MAX; i++)
+	{
+		if((msk & (1 << i)) == 0) continue;
+		if(pmdm->atcset == ATCSET_M)
+		{
+			snprintf(tbuf, sizeof(tbuf), "AT+CNACT=%u,%u\r", i + 1, act);
+			strcat(buf, tbuf);
+		}
+		else
+		{
+			if(buf[0] == 0) strcpy(buf, (act != 0) ? "AT+CGACT=1" : "AT+CGACT=0");
+			snprintf(tbuf, sizeof(tbuf), ",%u", i + 1);
+			strcat(buf, tbuf);
+		}
+	}
+	if(buf[0] != 0 && pmdm->atcset != ATCSET_M) strcat(buf, "\r");
+}
+
+//Result of a re-activation, the +CGPADDR and +CGCONTRDP lines update the contexts
+static void SamMdmPdnCb(void * pd, AtcReqTag * preq, uint8 ret, char * line)
+{
+	TMdmTag * pmdm = (TMdmTag *)pd;
+	uint8 i;
+	(void)preq;
+	if(ret == NOSTRRET_ATCRET)
+	{
+		if(pmdm->sta == FFUN_MDMSTA) SamMdmRadioLine(pmdm, line);
+		return;
+	}
+	for(i = 0; i < MDMPDN_MAX; i++)
+	{
+		if(pmdm->pdn[i].state == ACTG_MDMPDN) pmdm->pdn[i].state = DOWN_MDMPDN;
+	}
+	pmdm->pdntmr = SamTmrStart(pmdm->pdntmr, SAM_MDM_PDN_RETRY_MS, 0);
+}
+
+//Queue the re-activation of the configured contexts gone down, only them, once PS
+//is registered again: after a detach the tries are kept for the re-attach.
+//Returns RETCHAR_FALSE once one of them has used its tries
+static uint8 SamMdmPdnRea(TMdmTag * pmdm)
+{
+	uint8 i, msk;
+	msk = 0;
+	for(i = 0; i < MDMPDN_MAX; i++)
+	{
+		if((pmdm->pdncfg & (1 << i)) == 0 || pmdm->pdn[i].state != DOWN_MDMPDN) continue;
+		if(pmdm->pdn[i].tries >= SAM_MDM_PDN_TRIES) return(RETCHAR_FALSE);
+		msk |= (uint8)(1 << i);
+	}
+	if(msk == 0 || SamTmrLeft(pmdm->pdntmr) != 0 || (pmdm->conditon & PSREG_MDMCND) == 0) return(RETCHAR_TRUE);
+	SamMdmPdnActCmd(pmdm, pmdm->pdncmd, 1, msk);
+	strcat(pmdm->pdncmd, "AT+CGPADDR\rAT+CGCONTRDP\r");
+	for(i = 0; i < MDMPDN_MAX; i++)
+	{
+		if((msk & (1 << i)) == 0) continue;
+		pmdm->pdn[i].state = ACTG_MDMPDN;
+		pmdm->pdn[i].tries++;
+	}
+	DebugTrace("PDN re-activation %02X\r\n", msk);
+	SamAtcReqSubmit(pmdm->patc, &(pmdm->pdnreq));
+	return(RETCHAR_TRUE);
+}
+
+//Wait before the next recovery try: the base doubled per try, upper half random.
+//The generator is seeded from the identities and the clock, so modems differ
+static uint32 SamMdmRcvWait(TMdmTag * pmdm)
+{
+	uint32 d;
+	uint8 i;
+	if(pmdm->rcvrnd == 0)
+	{
+		pmdm->rcvrnd = ((uint32)SamMdmSum(pmdm->imei, strlen(pmdm->imei)) << 16) ^ SamMdmSum(pmdm->ccid, strlen(pmdm->ccid)) ^ GetSysTickCnt();
+		if(pmdm->rcvrnd == 0) pmdm->rcvrnd = 1;
+	}
+	pmdm->rcvrnd ^= pmdm->rcvrnd << 13;	//xorshift32
+	pmdm->rcvrnd ^= pmdm->rcvrnd >> 17;
+	pmdm->rcvrnd ^= pmdm->rcvrnd << 5;
+	d = SAM_MDM_RCV_BASE_MS;
+	for(i = 0; i < pmdm->rcvn && d < SAM_MDM_RCV_MAX_MS; i++) d <<= 1;
+	if(d > SAM_MDM_RCV_MAX_MS) d = SAM_MDM_RCV_MAX_MS;
+	return(d / 2 + pmdm->rcvrnd % (d / 2 + 1));
+}
+
+//Service is back: account the recovery to the stage which ended it
+static void SamMdmRcvDone(TMdmTag * pmdm)
+{
+	uint32 ms;
+	if(pmdm->rcvstage >= MDMRCV_NUM) return;
+	ms = SamTmrNow() - pmdm->rcvclk;
+	pmdm->rcvstat.okcnt[pmdm->rcvstage]++;
+	pmdm->rcvstat.lastms = ms;
+	pmdm->rcvstat.summs += ms;
+	if(ms > pmdm->rcvstat.maxms) pmdm->rcvstat.maxms = ms;
+	DebugTrace("MDM recovered by stage %u after %u tries, %ums\r\n", pmdm->rcvstage, pmdm->rcvn, ms);
+	pmdm->rcvstage = NONE_MDMRCV;
+	pmdm->rcvtry = 0;
+	pmdm->rcvn = 0;
+	SamTmrStop(pmdm->rcvtmr);
+	pmdm->rcvtmr = 0;
+}
+
+//Highest rate of a +IPR: (0,300,...,921600,3000000) list above the rate in use, up to
+//linkmax and taken by the host port
+static void SamMdmLinkPick(TMdmTag * pmdm, char * sp)
+{
+	char * ep;
+	uint32 r;
+	for(sp += 5; *sp != 0; )
+	{
+		if(*sp < '0' || *sp > '9')
+		{
+			sp++;
+			continue;
+		}
+		r = strtoul(sp, &ep, 10);
+		sp = ep;
+		if(r > pmdm->linkrate && r <= pmdm->linkmax && r > pmdm->linknew && pmdm->plink(r, pmdm->linkfc, 0) != 0) pmdm->linknew = r;
+	}
+}
+
+//The module reset, host back to the default rate without flow control and negotiate again
+static void SamMdmLinkBase(TMdmTag * pmdm)
+{
+	if(pmdm->link == OFF_MDMLINK) return;
+	pmdm->linkrate = pmdm->linkbase;
+	pmdm->linkfc = 0;
+	pmdm->plink(pmdm->linkbase, 0, 1);
+	pmdm->link = PEND_MDMLINK;
+}
+
+//Negotiation over, on to the bring-up step, 0 to check AT again after a fallback
+static void SamMdmLinkEnd(TMdmTag * pmdm, uint8 step)
+{
+	pmdm->link = DONE_MDMLINK;
+	pmdm->sta = INIT_MDMSTA;
+	pmdm->step = step;
+	pmdm->stim = 2;
+	pmdm->dcnt = 0;
+	DebugTrace("UART %u baud, flow control %u\r\n", pmdm->linkrate, pmdm->linkfc);
+}
+
+//Result of the negotiation command sent by step
+static void SamMdmLinkRet(TMdmTag * pmdm, uint8 ok)
+{
+	switch(pmdm->step)
+	{
+		case 0:		//AT+IFC
+			if(ok == 0)
+			{//keep what the module has
+				pmdm->linkflow = pmdm->linkfc;
+			}
+			else
+			{
+				pmdm->linkfc = pmdm->linkflow;
+				if(pmdm->plink(pmdm->linkrate, pmdm->linkfc, 1) == 0 && pmdm->linkfc != 0)
+				{//the host cannot, module flow control off again
+					pmdm->linkflow = 0;
+					return;
+				}
+			}
+			pmdm->step = 1;
+			break;
+		case 1:		//AT+IPR=?, its +IPR: line set linknew
+			if(ok == 0)
+			{//no rate list, or no answer after a fallback
+				SamMdmLinkEnd(pmdm, 0);
+				break;
+			}
+			pmdm->step = 2;
+			break;
+		case 2:		//AT+IPR=<linknew>
+			if(ok == 0)
+			{//refused, the next rate below
+				pmdm->linkmax = pmdm->linknew - 1;
+				pmdm->linknew = 0;
+				pmdm->step = 1;
+			}
+			else if(pmdm->plink(pmdm->linknew, pmdm->linkfc, 1) == 0)
+			{//the module switched alone, the recovery resets it
+				pmdm->linkmax = pmdm->linknew - 1;
+				SamMdmLinkEnd(pmdm, 0);
+			}
+			else
+			{
+				pmdm->step = 3;
+				pmdm->stim = 0;
+				pmdm->dcnt = 0;
+			}
+			break;
+		case 3:		//AT at the new rate, tried again until SAM_MDM_LINK_TRIES
+			if(ok == 0) break;
+			pmdm->linkrate = pmdm->linknew;
+			SamMdmLinkEnd(pmdm, 1);
+			break;
+		default:	//AT+IPR=<linkrate> sent at the new rate, answered or not
+			pmdm->plink(pmdm->linkrate, pmdm->linkfc, 1);
+			pmdm->linkmax = pmdm->linknew - 1;
+			pmdm->linknew = 0;
+			pmdm->step = 1;	//rates below, AT+IPR=? checks the module is back
+			break;
 	}
-	return(RETCHAR_NONE);
+}
+
+//Power saving of CFGMDM_PWRCFG, read at each bring-up so a changed configuration applies
+//Result of the PSM/eDRX setup, a modem not taking it does not sleep on the cycle batches wait for
+static void SamMdmPwrCb(void * pd, AtcReqTag * preq, uint8 ret, char * line)
+{
+	(void)pd;
+	(void)preq;
+	(void)line;
+	if(ret == NOSTRRET_ATCRET || ret == 1) return;
+	DebugTrace("PSM/eDRX setup failed (%u), batches wait for the window only\r\n", ret);
+	SamPwrCycleOff();
+}
+
+static void SamMdmPwrLoad(TMdmTag * pmdm)
+{
+	char sbuf[64];
+	char dbuf[16];
+	uint32 v[4];
+	uint8 i;
+
+	memset(v, 0, sizeof(v));
+	if(ReadCfgTab(pmdm->cfg, CFGMDM_HEADSTR, CFGMDM_PWRCFG, sbuf) != 0)
+	{
+		for(i = 0; i < 4; i++)
+		{
+			if(GetPmrStr(sbuf, ',', i, dbuf, sizeof(dbuf)) != 0) v[i] = strtoul(dbuf, NULL, 10);
+		}
+	}
+	SamPwrCfg(v[0], v[1], v[2], v[3]);
+	if(SamPwrAtCmd(pmdm->pwrcmd, pmdm->radio.rat) == RETCHAR_TRUE)
+	{
+		DebugTrace("PSM %us, active %us, eDRX %ums, batch window %ums\r\n", v[0], v[1], v[2], v[3]);
+		SamAtcReqSubmit(pmdm->patc, &(pmdm->pwrreq));
+	}
+}
+
+void SamMdmSetStore(TMdmTag * pmdm, SamMdmStoreFunTag pfun)
+{
+	if(pmdm == NULL) return;
+	pmdm->pstore = pfun;
+}
+
+void SamMdmSetReset(TMdmTag * pmdm, SamMdmResetFunTag pfun)
+{
+	if(pmdm == NULL) return;
+	pmdm->preset = pfun;
+}
+
+void SamMdmSetLink(TMdmTag * pmdm, SamMdmLinkFunTag pfun, uint32 base, uint32 max, uint8 flow)
+{
+	if(pmdm == NULL) return;
+	pmdm->plink = pfun;
+	pmdm->link = (pfun != NULL) ? PEND_MDMLINK : OFF_MDMLINK;
+	pmdm->linkflow = (flow != 0) ? 1 : 0;
+	pmdm->linkfc = 0;
+	pmdm->linkbase = base;
+	pmdm->linkmax = max;
+	pmdm->linkrate = base;
+}
+
+uint8 SamMdmUserAtc(TMdmTag * pmdm, AtcReqTag * preq)
+{
+	char * cp;
+	if(pmdm == NULL || pmdm->patc == NULL || preq == NULL || preq->cmd == NULL) return(RETCHAR_FALSE);
+	cp = preq->cmd;
+	if((cp[0] != 'A' && cp[0] != 'a') || (cp[1] != 'T' && cp[1] != 't')) return(RETCHAR_FALSE);
+	if(preq->pset == NULL)
+	{//final results of any command
+		preq->pset = &MdmUserAtcSet;
+		preq->nfin = 4;
+	}
+	return(SamAtcReqSubmit(pmdm->patc, preq));
 }
 
 TMdmTag * SamMdmInit(TMdmTag * pmdm, char * cfgstr)
 {
 	uint8 i, n;
 	char str[256];
+	char sbuf[8];
+	uint32 cid;
 	
 	if(cfgstr == NULL || pmdm == NULL || strlen(cfgstr) < 9) return(NULL);
 
@@ -64,8 +833,15 @@ TMdmTag * SamMdmInit(TMdmTag * pmdm, char * cfgstr)
 		}
 		i = ReadCfgTab(cfgstr, CFGMDM_HEADSTR, CFGMDM_PDNCFG, str);
 		if(i > 1 && str[0] >= '0' && str[0] <= '9')
-		{
-			pmdm->pdncnt = str[0] - '0';
+		{//pdncnt,pdncid1,...,pdncid2,..., 6 fields per context
+			pmdm->pdncnt = (uint8)strtoul(str, NULL, 10);
+			if(pmdm->pdncnt > MDMPDN_MAX) pmdm->pdncnt = MDMPDN_MAX;
+			for(i = 0; i < pmdm->pdncnt; i++)
+			{
+				if(GetPmrStr(str, ',', (i*6)+1, sbuf, 5) == 0) continue;
+				cid = strtoul(sbuf, NULL, 10);
+				if(cid >= 1 && cid <= MDMPDN_MAX) pmdm->pdncfg |= (uint8)(1 << (cid - 1));
+			}
 		}
 		else
 		{
@@ -80,19 +856,48 @@ TMdmTag * SamMdmInit(TMdmTag * pmdm, char * cfgstr)
 
 	
 	pmdm->patc = pAtcBusArray[n];
+	SamCtxCur()->pmdm = (void *)pmdm;
 	
-	pmdm->patc->pMdmhost = (void *)pmdm;
-	pmdm->patc->MdmUrcBcFun = SamMdmUrcCbfun;
+	for(i = 0; i < ATCBUS_CHMAX; i++)
+	{//modem URCs may come on any channel
+		if(pAtcBusArray[i] == NULL) continue;
+		pAtcBusArray[i]->pMdmhost = (void *)pmdm;
+		pAtcBusArray[i]->MdmUrcBcFun = SamMdmUrcCbfun;
+	}
 	pmdm->urcbmk = 0;
 	
 	pmdm->cfg = cfgstr;
 	pmdm->step = 0;
-	pmdm->msclk = SamGetMsCnt(0);
+	pmdm->stmr = SamTmrStart(0, 1000, 1000);
 	pmdm->stim = 0;
 	pmdm->dcnt = 0;
 	pmdm->conditon = 0;
-	pmdm->uatcwot = 0;
-	pmdm->uatcbuf[0] = 0;
+
+	pmdm->pollreq.cmd = "AT+CPIN?;+CSQ;+CPSI?;+CGATT?\r";
+	pmdm->pollreq.pset = &MdmPollRetSet;
+	pmdm->pollreq.timwm = 6;
+	pmdm->pollreq.pcb = SamMdmPollCb;
+	pmdm->pollreq.pd = (void *)pmdm;
+	pmdm->pwrreq.cmd = pmdm->pwrcmd;
+	pmdm->pwrreq.pset = &MdmPdnRetSet;
+	pmdm->pwrreq.nfin = 3;
+	pmdm->pwrreq.timwm = 6;
+	pmdm->pwrreq.pcb = SamMdmPwrCb;
+	pmdm->pwrreq.pd = (void *)pmdm;
+	pmdm->pdnreq.cmd = pmdm->pdncmd;
+	pmdm->pdnreq.pset = &MdmPdnRetSet;
+	pmdm->pdnreq.nfin = 3;
+	pmdm->pdnreq.timwm = 60;
+	pmdm->pdnreq.pcb = SamMdmPdnCb;
+	pmdm->pdnreq.pd = (void *)pmdm;
+	memset(pmdm->regsta, NONE_MDMREG, sizeof(pmdm->regsta));
+	pmdm->rcvstage = NONE_MDMRCV;
+	pmdm->radio.rsrp = UNKN_MDMRAD;
+	pmdm->radio.rsrq = UNKN_MDMRAD;
+	pmdm->radio.rssi = UNKN_MDMRAD;
+	pmdm->radio.sinr = UNKN_MDMRAD;
+	pmdm->radio.csq = 99;
+	pmdm->radio.ber = 99;
 	return(pmdm);
 }
 
@@ -106,14 +911,112 @@ unsigned char SamMdmStop(void * pvmdm)
 }
 
 #define WMDMRET_BIT 0x80
+//status poll period, long once URCs report registration or sends are batched for power saving,
+//short while PS is not registered: its +CGATT? also sees a re-attach no URC reported
+#define MDMPOLL_MS(pmdm)	((((pmdm)->regurc != 0 || SamCtxCur()->pwr.win != 0) && ((pmdm)->conditon & PSREG_MDMCND) != 0) ? SAM_MDM_SAFEPOLL_MS : SAM_MDM_POLL_MS)
+//a step runs after its pause, on a warm start its first try goes at once
+#define MDMSTEP_DUE(pmdm, s)	((pmdm)->stim >= (s) || ((pmdm)->warm != COLD_MDMWARM && (pmdm)->dcnt == 0))
+
+#if SAM_CFG_PROCBUD_ENABLED
+#define MDMBUD_OUT(pmdm)	((pmdm)->budus != 0 && (uint32)(GetSysUsCnt() - (pmdm)->budclk) >= (pmdm)->budus)
+#endif
+
+//Next slot to run among those not in done: the highest class first, with waiting time
+//counting up, and slots past their latency budget before all others
+static uint8 SamMdmFunPick(HdsAtcTag * patc, uint16 done)
+{
+	uint8 i, best;
+	uint32 now, age;
+	int32 score, top;
+
+	now = SamTmrNow();
+	best = MDMFUNARRAY_MAX;
+	top = 0;
+	for(i = 0; i < MDMFUNARRAY_MAX; i++)
+	{
+		if((done & (1 << i)) != 0 || patc->fun[i].pfunData == NULL || patc->fun[i].pfunProc == NULL) continue;
+		age = now - patc->fun[i].runclk;
+		if(age > FUNPRIO_AGEMAX) age = FUNPRIO_AGEMAX;
+		score = (int32)age - (int32)patc->fun[i].prio * FUNPRIO_AGEMS;
+		if(patc->fun[i].budms != 0 && age >= patc->fun[i].budms) score += FUNPRIO_AGEMAX * 2;
+		if(best == MDMFUNARRAY_MAX || score > top)
+		{
+			best = i;
+			top = score;
+		}
+	}
+	return(best);
+}
+
+//Run the request queue and the functional blocks linked on one AT channel
+static uint8 SamMdmFunSched(HdsAtcTag * patc)
+{
+	uint8 funret, i;
+	uint16 done;
+#if SAM_CFG_FUNACCT_ENABLED
+	uint32 t;
+#endif
+	if(SamAtcReqProc(patc) == RETCHAR_KEEP) return(RETCHAR_FREE);
+	done = 0;
+	if(patc->fkeep != 0 && patc->fpt < MDMFUNARRAY_MAX && patc->fun[patc->fpt].pfunProc != NULL)
+	{//in the middle of a transaction, the holder goes on until it lets go
+		i = patc->fpt;
+	}
+	else
+	{
+		patc->fkeep = 0;
+		i = SamMdmFunPick(patc, done);
+	}
+	while(i < MDMFUNARRAY_MAX)
+	{
+		patc->fpt = i;
+#if SAM_CFG_FUNACCT_ENABLED
+		t = GetSysUsCnt();
+#endif
+		funret = patc->fun[i].pfunProc(patc->fun[i].pfunData);
+#if SAM_CFG_FUNACCT_ENABLED
+		t = GetSysUsCnt() - t;
+		patc->fun[i].runcnt++;
+		patc->fun[i].sumus += t;
+		if(t > patc->fun[i].maxus) patc->fun[i].maxus = t;
+#endif
+		patc->fun[i].runclk = SamTmrNow();
+		if(funret == RETCHAR_KEEP)
+		{
+			patc->fkeep = 1;
+			return(RETCHAR_KEEP);
+		}
+		patc->fkeep = 0;
+		done |= (uint16)(1 << i);
+		SamChkAtcSet(patc, &AtcOkErrSet); // Try to Find URC in time
+		if(patc->reqhd != NULL) break;	// queued requests go in between
+#if SAM_CFG_PROCBUD_ENABLED
+		if(patc->pMdmhost != NULL && MDMBUD_OUT((TMdmTag *)patc->pMdmhost))
+		{//budget used, the others are older on the next pass which runs at once
+			SamDeadlineNote(0);
+			break;
+		}
+#endif
+		i = SamMdmFunPick(patc, done);
+	}
+	SamAtcReqProc(patc);
+	return(RETCHAR_FREE);
+}
+
 unsigned char SamMdmProc(void * pvmdm)
 {
-	uint8 i, j, ratcret, funret;
-	uint32 clk, n;
+	return(SamMdmProcBud(pvmdm, SAM_MDM_PROC_BUDUS));
+}
+
+unsigned char SamMdmProcBud(void * pvmdm, uint32 budus)
+{
+	uint8 i, j, ratcret;
+	uint32 n;
 	char buf[256];
 	char tbuf[256];
 	char dbuf[256];
 	char sbuf[256];
+	TMdmWarmTag warm;
 	
 	HdsAtcTag * patc = NULL;
 	TMdmTag * pmdm = NULL;
@@ -124,83 +1027,30 @@ unsigned char SamMdmProc(void * pvmdm)
 	patc = pmdm->patc;
 	if(patc == NULL) return('E'+2);
 	
-	clk = SamGetMsCnt(pmdm->msclk);
-	while(clk >= 1000)
-	{
-		pmdm->msclk +=1000;
-		pmdm->stim += 1;
-		clk -= 1000;
-	}
+#if SAM_CFG_PROCBUD_ENABLED
+	pmdm->budclk = GetSysUsCnt();
+	pmdm->budus = budus;
+#else
+	(void)budus;
+#endif
+	SamTmrPoll();	//one clock read per pass for all unit timers
+	pmdm->stim += SamTmrPeriod(&(pmdm->stmr), 1000);
 
-	if(pmdm->uatcwot >= 6 && patc->waitret == STOP_HATCTMW)
-	{//Execute special ATC from App 
-		if(pmdm->uatcwot != 0xFF && (pmdm->uatcbuf[0] == 'A' ||pmdm->uatcbuf[0] == 'a'))
-		{
-			while(SamChkAtcRet(patc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET);
-			SamSendAtCmd(patc, pmdm->uatcbuf, CRLF_HATCTYP, pmdm->uatcwot);
-			pmdm->uatcwot = 0xFF;
-			pmdm->uatcbuf[0] = 0;
-		}
-		else if(pmdm->uatcwot == 0xFF)
+	if(pmdm->sta == FFUN_MDMSTA)
+	{//Queued requests and task scheduling for each functional block
+		if(pmdm->step == 0 && SamMdmFunSched(patc) == RETCHAR_KEEP)
 		{
-			ratcret = SamChkAtcRet(patc, "OK\r\n\tERROR\r\n");
-			if(ratcret == 1 || ratcret == 2)
-			{
-				strcat(pmdm->uatcbuf, pmdm->patc->retbuf);
-				pmdm->uatcwot = 1;
-				DebugTrace("User ATC End!\r\n");
-				pmdm->patc->retbuf[0] = 0;
-				pmdm->patc->retbufp = 0;
-				patc->waitret = STOP_HATCTMW;
-			}
-			else if(ratcret == OVERTIME_ATCRET)
-			{
-				pmdm->uatcbuf[0] = 0;
-				pmdm->uatcwot = 0;
-				DebugTrace("User ATC OV!\r\n");
-			}
-			else if(ratcret != NOSTRRET_ATCRET)
-			{
-				if(strlen(pmdm->uatcbuf) < 248)
-				{
-					strcat(pmdm->uatcbuf, pmdm->patc->retbuf);
-				}
-				pmdm->patc->retbuf[0] = 0;
-				pmdm->patc->retbufp = 0;
-			}
+			pmdm->stim = 0;
 		}
-		else
-		{
-			pmdm->uatcwot = 0;
-			DebugTrace("User Send ATC finish!\r\n");
+		for(i = 0; i < ATCBUS_CHMAX; i++)
+		{//other AT channels, e.g. CMUX DLCs
+			if(pAtcBusArray[i] != NULL && pAtcBusArray[i] != patc) SamMdmFunSched(pAtcBusArray[i]);
 		}
-		return(RETCHAR_NONE);
 	}
-
-	if(pmdm->sta == FFUN_MDMSTA && pmdm->step == 0)
-	{//Task scheduling for each functional block
-		for(; patc->fpt<MDMFUNARRAY_MAX; )
-		{
-			if(patc->fun[patc->fpt].pfunData != NULL && patc->fun[patc->fpt].pfunProc != NULL)
-			{
-				funret = patc->fun[patc->fpt].pfunProc(patc->fun[patc->fpt].pfunData);
-				if(funret != RETCHAR_KEEP)
-				{
-					patc->fpt++;
-					SamChkAtcRet(patc, "OK\r\n\tERROR\r\n"); // Try to Find URC in time
-				}
-				else 
-				{
-					pmdm->stim = 0;
-					break;
-				}
-			}
-			else
-			{
-				patc->fpt++;
-			}
-		}
-		if(patc->fpt == MDMFUNARRAY_MAX) patc->fpt = 0;
+	else if((pmdm->sta == INIT_MDMSTA || pmdm->sta == FAIL_MDMSTA) && pmdm->step < WMDMRET_BIT)
+	{//no bring-up or recovery command outstanding, queued requests go in between
+		patc->fkeep = 0;	//units do not run outside FFUN_MDMSTA, a holder of the lost service lets go
+		if(SamAtcReqProc(patc) == RETCHAR_KEEP) return(RETCHAR_NONE);	//the next step waits for its end
 	}
 	
 	switch(pmdm->sta)
@@ -208,7 +1058,7 @@ unsigned char SamMdmProc(void * pvmdm)
 		case FUN0_MDMSTA :
 			if(pmdm->step == 0)
 			{
-				while(SamChkAtcRet(patc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET);
+				while(SamChkAtcSet(patc, &AtcOkErrSet) != NOSTRRET_ATCRET);
 				SamSendAtCmd(patc, "AT+CFUN=0\r", CRLF_HATCTYP, 9);
 				pmdm->step += WMDMRET_BIT;
 				pmdm->stim = 0;
@@ -216,7 +1066,7 @@ unsigned char SamMdmProc(void * pvmdm)
 			}
 			else if(pmdm->step >= WMDMRET_BIT)
 			{
-				ratcret = SamChkAtcRet(patc, "OK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(patc, &AtcOkErrSet);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
 				    break;
@@ -244,7 +1094,7 @@ unsigned char SamMdmProc(void * pvmdm)
 				}
 				else if((pmdm->stim & 0x01) == 0)
 				{
-					SamChkAtcRet(patc, "OK\r\n\tERROR\r\n");
+					SamChkAtcSet(patc, &AtcOkErrSet);
 				}
 			}
 			break;
@@ -264,11 +1114,29 @@ unsigned char SamMdmProc(void * pvmdm)
 				pmdm->imei[0] = 0;
 				pmdm->imsi[0] = 0;
 				pmdm->ccid[0] = 0;
+				pmdm->fwver[0] = 0;
 				pmdm->conditon = 0;
+				pmdm->regurc = 0;
+				memset(pmdm->regsta, NONE_MDMREG, sizeof(pmdm->regsta));
 				
-				strcpy(pmdm->ipstrtab, "\v");
+				SamMdmPdnReset(pmdm);
+				SamMdmWarmLoad(pmdm, &warm);
+			}
+			else if(pmdm->step == 1 && pmdm->link == PEND_MDMLINK)
+			{//the modem answers at the default rate, host and module switch before the bring-up
+#if SAM_CFG_CMUX_ENABLED
+				if(SamCtxCur()->pcmux != NULL)
+				{//the multiplexer owns the port
+					pmdm->link = OFF_MDMLINK;
+					break;
+				}
+#endif
+				pmdm->sta = LINK_MDMSTA;
+				pmdm->step = 0;
+				pmdm->dcnt = 0;
+				pmdm->linknew = 0;
 			}
-			else if(pmdm->step == 1 && pmdm->stim >= 2)
+			else if(pmdm->step == 1 && MDMSTEP_DUE(pmdm, 2))
 			{
 				pmdm->dcnt++;
 				if(pmdm->dcnt > 6)
@@ -277,11 +1145,19 @@ unsigned char SamMdmProc(void * pvmdm)
 					pmdm->step = 0;
 					break;
 				}
-				SamSendAtCmd(patc, "AT\rATE0\rAT+CMEE=0\rAT+CGMR\rAT+CFUN=1\r\t1000\rAT+CPIN?\r\t1000\r", CRLF_HATCTYP, 9);
+				//registration, PDN and SIM changes are reported by URCs, the status poll is only a safety net
+				if(pmdm->warm == CHK_MDMWARM)
+				{//a SIM not ready yet is asked again by the step retry
+					SamSendAtCmd(patc, "AT\rATE0\rAT+CMEE=0\rAT+CREG=2\rAT+CGREG=2\rAT+CEREG=2\rAT+CGEREP=2,1\rAT+CGMR\rAT+CFUN=1\rAT+CPIN?\r", CRLF_HATCTYP|COAL_HATCTYP, 9);
+				}
+				else
+				{
+					SamSendAtCmd(patc, "AT\rATE0\rAT+CMEE=0\rAT+CREG=2\rAT+CGREG=2\rAT+CEREG=2\rAT+CGEREP=2,1\rAT+CGMR\rAT+CFUN=1\r\t1000\rAT+CPIN?\r\t1000\r", CRLF_HATCTYP|COAL_HATCTYP, 9);
+				}
 				pmdm->step += WMDMRET_BIT;
 				pmdm->stim = 0;
 			}
-			else if(pmdm->step == 2 && pmdm->stim >= 2)
+			else if(pmdm->step == 2 && MDMSTEP_DUE(pmdm, 2))
 			{
 				pmdm->dcnt++;
 				if(pmdm->dcnt > 3)
@@ -290,7 +1166,7 @@ unsigned char SamMdmProc(void * pvmdm)
 					pmdm->step = 0;
 					break;
 				}
-				strcpy(buf, "AT+SIMEI?\rAT+CICCID\rAT+CCID\rAT+CIMI\r");
+				strcpy(buf, (pmdm->atcset == ATCSET_M) ? "AT+SIMEI?\rAT+CCID\rAT+CIMI\r" : "AT+SIMEI?\rAT+CICCID\rAT+CIMI\r");
 				tbuf[0] = 0;
 				
 				strcpy(tbuf, "AT+CFUN=4\r\t1000\r");
@@ -335,26 +1211,37 @@ unsigned char SamMdmProc(void * pvmdm)
 				}
 				strcat(tbuf, "AT+CFUN=1\r\t1000\r");
 				
-				if(Strsearch(tbuf, "AT+CGDCONT=") != 0)
+				if(Strsearch(tbuf, "AT+CGDCONT=") != 0 && pmdm->warm != CHK_MDMWARM)
 				{
 					strcat(buf, tbuf);
 				}
-				SamSendAtCmd(patc, buf, CRLF_HATCTYP, 15);
+				//the identities go as one AT+SIMEI?;+CICCID;+CIMI (+CCID with the M set)
+				SamSendAtCmd(patc, buf, CRLF_HATCTYP|COAL_HATCTYP, 15);
+				pmdm->warmerr = 0;
 				pmdm->step += WMDMRET_BIT;
 				pmdm->stim = 0;
 				
 			}
-			else if(pmdm->step == 3 && pmdm->stim >= 2)
+			else if(pmdm->step == 3 && pmdm->warm != HIT_MDMWARM)
+			{
+				SamMdmWarmStep(pmdm);
+				if(pmdm->warm == COLD_MDMWARM)
+				{//changed since the record was saved, identities and PDN configuration again
+					pmdm->step = 2;
+					pmdm->stim = 2;
+				}
+			}
+			else if(pmdm->step == 3 && MDMSTEP_DUE(pmdm, 2))
 			{
 				pmdm->dcnt++;
-				if(pmdm->dcnt > 90)
-				{
+				if(pmdm->dcnt > ((pmdm->rcvstage == PDN_MDMRCV) ? 10 : 90))
+				{//a PDN recovery expects the modem still attached
 					pmdm->sta = FAIL_MDMSTA;
 					pmdm->step = 0;
 					break;
 					
 				}
-				SamSendAtCmd(patc, "AT+CSQ;+CGATT?\r", CRLF_HATCTYP, 3);
+				SamSendAtCmd(patc, "AT+CSQ;+CGATT?\r", CRLF_HATCTYP|ARTO_HATCTYP, 3);
 				pmdm->step += WMDMRET_BIT;
 				pmdm->stim = 0;
 			}
@@ -368,12 +1255,12 @@ unsigned char SamMdmProc(void * pvmdm)
 					break;
 				}
 				//SamSendAtCmd(patc, "AT+SIMEI?\rAT+CICCID\rAT+CCID\rAT+CIMI\r", CRLF_HATCTYP, 3);
-				SamSendAtCmd(patc, "AT+CPSI?\r", CRLF_HATCTYP, 3);
+				SamSendAtCmd(patc, "AT+CPSI?\r", CRLF_HATCTYP|ARTO_HATCTYP, 3);
 				pmdm->step += WMDMRET_BIT;
 				pmdm->stim = 0;
 				
 			}
-			else if(pmdm->step == 5 && pmdm->stim >= 2)
+			else if(pmdm->step == 5 && MDMSTEP_DUE(pmdm, 2))
 			{
 				pmdm->dcnt++;
 				if(pmdm->dcnt > 3)
@@ -384,28 +1271,7 @@ unsigned char SamMdmProc(void * pvmdm)
 				}
 				else
 				{
-					buf[0] = 0;
-					ReadCfgTab(pmdm->cfg, CFGMDM_HEADSTR, CFGMDM_PDNCFG, sbuf);
-					for(i=0; i < pmdm->pdncnt; i++)
-					{
-						if(GetPmrStr(sbuf, ',', (i*6)+1, dbuf, 5) == 0)
-						{
-							continue;
-						}
-						else
-						{
-							
-							if(pmdm->atcset == ATCSET_M)
-	                        {
-	                            snprintf(tbuf, 128, "AT+CNACT=%s,1\r", dbuf);
-	                        }
-	                        else
-	                        {
-	                            snprintf(tbuf, 128,"AT+CGACT=1,%s\r", dbuf);
-	                        }	
-						}
-						strcat(buf, tbuf);
-					}
+					SamMdmPdnActCmd(pmdm, buf, 1, pmdm->pdncfg);
 					if(strlen(buf) < 5)
 					{	
 						pmdm->step++;
@@ -422,7 +1288,7 @@ unsigned char SamMdmProc(void * pvmdm)
 				}
 				
 			}
-			else if(pmdm->step == 6 && pmdm->stim >= 3)
+			else if(pmdm->step == 6 && MDMSTEP_DUE(pmdm, 3))
 			{
 				pmdm->dcnt++;
 				if(pmdm->dcnt > 3)
@@ -431,7 +1297,7 @@ unsigned char SamMdmProc(void * pvmdm)
 					pmdm->step = 0;
 					break;
 				}
-				SamSendAtCmd(patc, "AT+CGPADDR\rAT+CGCONTRDP\rAT+CSQ\rAT+CPSI?\r", CRLF_HATCTYP, 9);
+				SamSendAtCmd(patc, "AT+CGPADDR\rAT+CGCONTRDP\rAT+CSQ\rAT+CPSI?\r", CRLF_HATCTYP|ARTO_HATCTYP|COAL_HATCTYP, 9);
 				pmdm->step += WMDMRET_BIT;
 				pmdm->stim = 0;
 			}
@@ -441,16 +1307,22 @@ unsigned char SamMdmProc(void * pvmdm)
 				pmdm->step = 0;
 				pmdm->stim = 0;
 				pmdm->dcnt = 0;
+				pmdm->conditon |= INSRV_MDMCND;
+				pmdm->urcbmk &= ~(RECHK_MDMURC | PWAIT_MDMURC);
+				SamMdmRcvDone(pmdm);
+				SamMdmPwrLoad(pmdm);
+				pmdm->polltmr = SamTmrStart(pmdm->polltmr, MDMPOLL_MS(pmdm), 0);
 			}
 			else if(pmdm->step >= WMDMRET_BIT)
 			{
-				ratcret = SamChkAtcRet(patc, "OK\r\n\tERROR\r\n\t+CPIN:\t+CGATT:\t+CPSI:\t+CGPADDR:\t+SIMEI:\t+ICCID:\t");
+				ratcret = SamChkAtcSet(patc, &MdmInitRetSet);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
 				    break;
 				}
 				else if(ratcret == 2 || ratcret == OVERTIME_ATCRET)
 				{
+					if(pmdm->step == WMDMRET_BIT + 2) pmdm->warmerr = 1;
 					if(patc->state != SCED_HATCSTA)
 					{
 						SamSendAtSeg(patc);
@@ -510,47 +1382,9 @@ unsigned char SamMdmProc(void * pvmdm)
                     	DebugTrace("PS network is Ready!\r\n");
 					}
 				}
-				else if(ratcret == 5)
-				{
-					if(Strsearch(pmdm->patc->retbuf, "+CPSI:") != 0)
-					{
-
-                    	//DebugTrace("Get IP1:%s\r\n", pmdm->ipsstr);
-					}
-				}
-				else if(ratcret == 6)
-				{//+CGPADDR: 1, "10.88.44.193"
-					n = 8;
-					buf[0] = 0;
-					for(i=9, j=0; j<48; j++)
-					{
-                        if(j == 0)
-                        {
-                        	while((pmdm->patc->retbuf[i] < '1' || pmdm->patc->retbuf[i] > '9'))
-                        	{
-								i++;
-                        	}
-							n = pmdm->patc->retbuf[i++] - '1';
-                            while(pmdm->patc->retbuf[i] < '1' || pmdm->patc->retbuf[i] > '9')
-                            {
-                                i++;
-                            }
-							j = 0;
-                        }
-						buf[j] = pmdm->patc->retbuf[i++];
-						if((buf[j] < '0' || buf[j] > '9') && buf[j] != '.')
-						{
-							buf[j] = 0;
-							break;
-						}
-					}
-					if(n < 6 && buf[0] != 0)
-					{
-						WriteCfgTab(pmdm->ipstrtab, NULL, n, buf);
-						pmdm->conditon |= ((IPABIT_MDMCND<<n) & IPBMSK_MDMCND);
-                    	pmdm->conditon |= IPACT_MDMCND;
-						DebugTrace("IPAddr:%s\r\n", buf);
-					}
+				else if(ratcret == 5 || ratcret == 6 || ratcret == 10 || ratcret == 11)
+				{//+CPSI, +CGPADDR: 1,"10.88.44.193", +CSQ, +CGCONTRDP
+					SamMdmRadioLine(pmdm, pmdm->patc->retbuf);
 				}
 				else if(ratcret == 7)
 				{//+SIMEI: 868110062384530
@@ -565,6 +1399,11 @@ unsigned char SamMdmProc(void * pvmdm)
 					}
 					DebugTrace("IMEI:%s\r\n", pmdm->imei);
 				}
+				else if(ratcret == 9)
+				{//+CGMR: LE20B04SIM7600M22
+					GetPmrStr(pmdm->patc->retbuf + 6, '\n', 0, pmdm->fwver, sizeof(pmdm->fwver));
+					DebugTrace("FW:%s\r\n", pmdm->fwver);
+				}
 				else if(ratcret == 8)
 				{//+ICCID: 89860121801636109288
 					for(i=8, j=0; j<23; j++)
@@ -615,81 +1454,152 @@ unsigned char SamMdmProc(void * pvmdm)
 			}
 			break;
 		case FFUN_MDMSTA :
-			if(pmdm->step == 1)
+			SamPwrProc();
+			if(pmdm->pollreq.state == WAIT_ATCREQ || pmdm->pollreq.state == BUSY_ATCREQ
+				|| pmdm->pdnreq.state == WAIT_ATCREQ || pmdm->pdnreq.state == BUSY_ATCREQ)
 			{
-				pmdm->dcnt++;
-				if(pmdm->dcnt > 3)
-				{
-					pmdm->sta = FAIL_MDMSTA;
-					pmdm->step = 0;
+				break;
+			}
+			if(SamMdmPdnRea(pmdm) != RETCHAR_TRUE)
+			{//a context does not come back by itself
+				pmdm->sta = FAIL_MDMSTA;
+				pmdm->step = 0;
+				break;
+			}
+			if((pmdm->urcbmk & (RECHK_MDMURC | PWAIT_MDMURC)) == 0 && SamTmrLeft(pmdm->polltmr) == 0)
+			{//the safety poll is one more send of the batch window, not a wake of its own
+				pmdm->urcbmk |= PWAIT_MDMURC;
+				SamPwrTxAdd(0);
+			}
+			if((pmdm->urcbmk & RECHK_MDMURC) != 0 || (SamTmrLeft(pmdm->polltmr) == 0 && SamPwrTxGate() == RETCHAR_TRUE))
+			{//an URC reported a loss, or the safety poll is due
+				pmdm->urcbmk &= ~(RECHK_MDMURC | PWAIT_MDMURC);
+				pmdm->dcnt = 1;
+				SamAtcReqSubmit(patc, &(pmdm->pollreq));
+				pmdm->polltmr = SamTmrStart(pmdm->polltmr, MDMPOLL_MS(pmdm), 0);
+			}
+			break;
+		case LINK_MDMSTA :
+			if(pmdm->step == 0 && pmdm->linkfc == pmdm->linkflow)
+			{
+				pmdm->step = 1;
+			}
+			else if(pmdm->step == 0)
+			{
+				while(SamChkAtcSet(patc, &MdmLinkRetSet) != NOSTRRET_ATCRET);
+				SamSendAtCmd(patc, (pmdm->linkflow != 0) ? "AT+IFC=2,2\r" : "AT+IFC=0,0\r", CRLF_HATCTYP, 3);
+				pmdm->step += WMDMRET_BIT;
+			}
+			else if(pmdm->step == 1)
+			{
+				while(SamChkAtcSet(patc, &MdmLinkRetSet) != NOSTRRET_ATCRET);
+				SamSendAtCmd(patc, "AT+IPR=?\r", CRLF_HATCTYP, 3);
+				pmdm->step += WMDMRET_BIT;
+			}
+			else if(pmdm->step == 2 && pmdm->linknew == 0)
+			{//no rate above the one in use
+				SamMdmLinkEnd(pmdm, 1);
+			}
+			else if(pmdm->step == 2)
+			{
+				while(SamChkAtcSet(patc, &MdmLinkRetSet) != NOSTRRET_ATCRET);
+				snprintf(buf, sizeof(buf), "AT+IPR=%u\r", pmdm->linknew);
+				SamSendAtCmd(patc, buf, CRLF_HATCTYP, 3);
+				pmdm->step += WMDMRET_BIT;
+			}
+			else if(pmdm->step == 3 && pmdm->stim >= 1)
+			{
+				while(SamChkAtcSet(patc, &MdmLinkRetSet) != NOSTRRET_ATCRET);
+				if(pmdm->dcnt >= SAM_MDM_LINK_TRIES)
+				{//no answer at the new rate, ask the module back at it
+					DebugTrace("No answer at %u baud, back to %u\r\n", pmdm->linknew, pmdm->linkrate);
+					snprintf(buf, sizeof(buf), "AT+IPR=%u\r", pmdm->linkrate);
+					SamSendAtCmd(patc, buf, CRLF_HATCTYP, 3);
+					pmdm->step = 4 + WMDMRET_BIT;
 					break;
 				}
-				SamSendAtCmd(patc, "AT+CPIN?;+CSQ;+CPSI?\r", CRLF_HATCTYP, 6);
+				pmdm->dcnt++;
+				SamSendAtCmd(patc, "AT\r", CRLF_HATCTYP, 3);
 				pmdm->step += WMDMRET_BIT;
-				pmdm->stim = 0;
 			}
 			else if(pmdm->step >= WMDMRET_BIT)
 			{
-				ratcret = SamChkAtcRet(patc, "OK\r\n\tERROR\r\n\t+CSQ:\t+CPIN:\t+CPSI:");
+				ratcret = SamChkAtcSet(patc, &MdmLinkRetSet);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
 				    break;
 				}
-				else if(ratcret == 2 || ratcret == OVERTIME_ATCRET)
-				{
-					pmdm->step -= WMDMRET_BIT;
-					patc->state = IDLE_HATCSTA;
-					patc->waitret =	STOP_HATCTMW;
-				}
-				else if(ratcret == 1)
-				{
-					pmdm->stim = 0;
-					pmdm->step = 0;
-					patc->waitret =	STOP_HATCTMW;
-				}
 				else if(ratcret == 3)
-				{
-					if(Strsearch(pmdm->patc->retbuf, "+CPIN: READY") != 0)
-					{
-						pmdm->conditon |= CPINR_MDMCND;
-					}
-				}
-				else if(ratcret == 4)
-				{
-					if(Strsearch(pmdm->patc->retbuf, "+CPIN: READY") != 0)
-					{
-						pmdm->conditon |= CPINR_MDMCND;
-					}
+				{//+IPR: (list of rates)
+					SamMdmLinkPick(pmdm, patc->retbuf);
 				}
-				else if(ratcret == 5)
+				else
 				{
-					if(Strsearch(pmdm->patc->retbuf, "NO SERVICE") != 0)
-					{
-						pmdm->sta = FAIL_MDMSTA;
-						pmdm->step = 0;
-					}
+					patc->state = IDLE_HATCSTA;
+					patc->waitret =	STOP_HATCTMW;
+					pmdm->step -= WMDMRET_BIT;
+					SamMdmLinkRet(pmdm, (ratcret == 1) ? 1 : 0);
 				}
 				patc->retbufp = 0;
                 patc->retbuf[0] = 0;
 			}
-			else if(pmdm->stim >= 30)
-			{
-				pmdm->stim = 0;
-				pmdm->step = 1;
-				pmdm->dcnt = 0;
-			}
-			
 			break;
 		case FAIL_MDMSTA :
 			if(pmdm->step == 0)
 			{
+				if(pmdm->rcvstage == NONE_MDMRCV)
+				{//a modem in service starts with its PDN, one not answering AT with a reset
+					pmdm->rcvstage = ((pmdm->conditon & ATCOK_MDMCND) == 0) ? RESET_MDMRCV
+						: (((pmdm->conditon & INSRV_MDMCND) != 0) ? PDN_MDMRCV : CFUN_MDMRCV);
+					pmdm->rcvtry = 0;
+					pmdm->rcvn = 0;
+					pmdm->rcvclk = SamTmrNow();
+					pmdm->rcvstat.episode++;
+				}
+				else if(pmdm->rcvtry >= SAM_MDM_RCV_TRIES && pmdm->rcvstage < RESET_MDMRCV)
+				{
+					pmdm->rcvstage++;
+					pmdm->rcvtry = 0;
+				}
+				SamAtcReqFlush(patc, OVERTIME_ATCRET);
 				SamAtcFunUrcBroadCast(patc, "+RESET NETWORK\r\n");
-				SamSendAtCmd(patc, "AT+CFUN=0\r\t3000\rAT+CFUN=1\r", CRLF_HATCTYP, 30);
-				pmdm->step += WMDMRET_BIT;
+				n = SamMdmRcvWait(pmdm);
+				pmdm->rcvtmr = SamTmrStart(pmdm->rcvtmr, n, 0);
+				if(pmdm->rcvn < 0xFF) pmdm->rcvn++;
+				pmdm->rcvtry++;
+				pmdm->conditon &= ~(INSRV_MDMCND);
+				pmdm->step = 1;
+				DebugTrace("MDM recovery stage %u try %u in %ums\r\n", pmdm->rcvstage, pmdm->rcvtry, n);
+			}
+			else if(pmdm->step == 1 && SamTmrLeft(pmdm->rcvtmr) == 0)
+			{
+				while(SamChkAtcSet(patc, &AtcOkErrSet) != NOSTRRET_ATCRET);
+				if(pmdm->rcvstage == PDN_MDMRCV)
+				{
+					SamMdmPdnActCmd(pmdm, buf, 0, pmdm->pdncfg);
+					if(buf[0] == 0) strcpy(buf, "AT\r");
+					SamSendAtCmd(patc, buf, CRLF_HATCTYP, 60);
+				}
+				else if(pmdm->rcvstage == CFUN_MDMRCV)
+				{
+					SamSendAtCmd(patc, "AT+CFUN=0\r\t3000\rAT+CFUN=1\r", CRLF_HATCTYP, 30);
+				}
+				else if(pmdm->preset != NULL)
+				{//let the module boot before talking to it
+					pmdm->preset();
+					pmdm->rcvtmr = SamTmrStart(pmdm->rcvtmr, SAM_MDM_BOOT_MS, 0);
+					pmdm->step = 2;
+					break;
+				}
+				else
+				{
+					SamSendAtCmd(patc, "AT+CRESET\r", CRLF_HATCTYP, 9);
+				}
+				pmdm->step = 2 + WMDMRET_BIT;
 			}
 			else if(pmdm->step >= WMDMRET_BIT)
 			{
-				ratcret = SamChkAtcRet(patc, "OK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(patc, &AtcOkErrSet);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
 				    break;
@@ -704,22 +1614,33 @@ unsigned char SamMdmProc(void * pvmdm)
 					{
 						patc->state = IDLE_HATCSTA;
 						patc->waitret =	STOP_HATCTMW;
-						
 						pmdm->step -= WMDMRET_BIT;
-						pmdm->stim = 90;
-						pmdm->step++;
+						if(pmdm->rcvstage == RESET_MDMRCV)
+						{//let the module boot before talking to it
+							pmdm->rcvtmr = SamTmrStart(pmdm->rcvtmr, SAM_MDM_BOOT_MS, 0);
+						}
 					}
 				}
 				patc->retbufp = 0;
                 patc->retbuf[0] = 0;
 			}
-			if(pmdm->stim >= 120)
+			else if(pmdm->step == 2 && SamTmrLeft(pmdm->rcvtmr) == 0)
 			{
-				pmdm->stim = 0;
 				DebugTrace("MDM Wrong, Init Again!\r\n");
 				pmdm->sta = INIT_MDMSTA;
-                pmdm->step = 0;
+				pmdm->stim = 0;
 				pmdm->dcnt = 0;
+				if(pmdm->rcvstage == PDN_MDMRCV)
+				{//attach and PDN activation only
+					pmdm->conditon &= ~(PSREG_MDMCND);
+					SamMdmPdnReset(pmdm);
+					pmdm->step = 3;
+				}
+				else
+				{
+					if(pmdm->rcvstage == RESET_MDMRCV) SamMdmLinkBase(pmdm);	//AT+IPR and AT+IFC are gone with the module reset
+					pmdm->step = 0;
+				}
 			}
 			break;
 		default :
@@ -33,18 +33,134 @@ enum{
 	CFGMDM_ATCCHL = 1, //.
 	CFGMDM_ATCSET,		//A: ASR,  M: QCOMM
 	CFGMDM_PDNCFG,  //pdncnt,pdncid1,pdnip1,pdnapn1,pdnauth1,pdnusr1,pdnpwd1,pdncid2,pdnip2,pdnapn2,pdnauth2,pdnusr2,pdnpwd2,....
+	CFGMDM_PWRCFG,	//tau_s,active_s,edrx_ms,window_ms, see SamPwrCfg, missing or 0: off
 };
 //.atcset //AT command  
 #define ATCSET_A	'A'
 #define ATCSET_M 	'M'
 
 
+//.regsta index, +CREG, +CGREG and +CEREG
+enum{
+	CS_MDMREG = 0,
+	GPRS_MDMREG,
+	EPS_MDMREG,
+	MDMREG_NUM
+};
+#define NONE_MDMREG		0xFF
+
+//.rat of TMdmRadioTag
+enum{
+	NONE_MDMRAT = 0,	//+CPSI: NO SERVICE, or nothing seen yet
+	GSM_MDMRAT,
+	WCDMA_MDMRAT,
+	LTE_MDMRAT,
+	CATM_MDMRAT,
+	NBIOT_MDMRAT,
+	NR5G_MDMRAT,
+	OTHER_MDMRAT,		//in service on a mode not listed, e.g. CDMA
+};
+#define UNKN_MDMRAD		(-32767-1)	//signal value not reported by the RAT
+
+//SamMdmRadioLine results
+#define CPSI_MDMRAD		1
+#define CSQ_MDMRAD		2
+#define CGPADDR_MDMRAD	3
+#define CGCONTRDP_MDMRAD	4
+
+//Radio status sample: +CPSI with the last +CSQ, fields sized and ordered without padding
+typedef struct{
+	uint32	tick;		//wheel time of the sample, SamTmrNow
+	uint32	cellid;		//serving cell ID
+	uint16	mcc;
+	uint16	mnc;
+	uint16	lac;		//LAC or TAC
+	uint16	band;		//band number, e.g. 3 of EUTRAN-BAND3, 0: not reported
+	int16	rsrp;		//0.1 dBm, UNKN_MDMRAD if not LTE
+	int16	rsrq;		//0.1 dB
+	int16	rssi;		//0.1 dBm, LTE RSSI or GSM RxLev
+	int16	sinr;		//dB
+	uint8	rat;		//.rat
+	uint8	csq;		//+CSQ <rssi>, 99: not known
+	uint8	ber;		//+CSQ <ber>
+	uint8	rsv;
+}TMdmRadioTag;
+
+#define MDMPDN_MAX		6	//contexts kept, cid 1..6
+
+//.state of TMdmPdnTag
+enum{
+	DOWN_MDMPDN = 0,	//no address
+	ACTG_MDMPDN,		//activation sent
+	UP_MDMPDN,			//active with an address
+};
+
+//PDN context, binary addresses, all zero: none
+typedef struct{
+	uint8	state;		//.state
+	uint8	tries;		//activations sent since it went down
+	uint16	mtu;		//+CGCONTRDP <IPv4 MTU>, 0: not reported
+	uint8	ip4[4];		//+CGPADDR
+	uint8	dns4[2][4];	//+CGCONTRDP primary, secondary
+	uint8	ip6[16];
+	uint8	dns6[2][16];
+}TMdmPdnTag;
+
+//.rcvstage, recovery stages in escalation order
+enum{
+	PDN_MDMRCV = 0,		//re-activate the PDN contexts
+	CFUN_MDMRCV,		//CFUN=0/1 cycle and bring-up
+	RESET_MDMRCV,		//module reset by the reset hook or AT+CRESET and bring-up
+	MDMRCV_NUM
+};
+#define NONE_MDMRCV		0xFF
+
+//Recovery statistics
+typedef struct{
+	uint16	episode;			//recoveries started
+	uint16	okcnt[MDMRCV_NUM];	//recoveries ended by each stage
+	uint32	lastms;				//time to recover of the last one
+	uint32	maxms;
+	uint32	summs;				//sum over okcnt, for the mean time to recover
+}TMdmRcvStatTag;
+
+/**
+ * Module reset hook, e.g. a PWRKEY or RESET pin pulse. Without it AT+CRESET is sent.
+ */
+typedef void (*SamMdmResetFunTag)(void);
+
+/**
+ * Host port hook of the link negotiation: with apply 1 switch the host UART to baud, with
+ * RTS/CTS flow control if flow is 1, with apply 0 only check it could. Returns 1 if it
+ * can or did, 0 if the host cannot.
+ */
+typedef unsigned char (*SamMdmLinkFunTag)(unsigned long baud, unsigned char flow, unsigned char apply);
+
+/**
+ * Warm start storage hook: wr 0 reads up to dlen bytes of the saved record into dp and
+ * returns the bytes read, wr 1 saves dlen bytes from dp and returns the bytes saved.
+ */
+typedef unsigned short (*SamMdmStoreFunTag)(unsigned char wr, void * dp, unsigned short dlen);
+
+//Record kept through SamMdmStoreFunTag, compared with the modem at each bring-up
+#define MDMWARM_VER		0x01
+typedef struct{
+	uint8	ver;
+	uint8	rsv;
+	uint16	pdnsum;		//sum of the applied PDN configuration
+	char	fwver[32];
+	char	imei[16];
+	char	ccid[24];
+	char	imsi[16];
+	uint16	chk;		//sum of the fields above
+}TMdmWarmTag;
+
 typedef struct{
     uint8	sta;
 	uint8	step;
 	uint8	dcnt;
 	uint8	stim;
-	uint32  msclk;
+	SamTmrId stmr;		//second tick timer
 
 	char 	* cfg;
 	HdsAtcTag * patc;
@@ -59,18 +175,53 @@ typedef struct{
 	char	imei[16];
 	char	ccid[24];
 	char	imsi[16];
+	char	fwver[32];	//+CGMR
 
-	char	ipstrtab[256]; //for IP address string
-	
-	char 	netmode;	//G:GSM, W:WCDMA, L:LTE, 0x00
-	char 	optmode;	//N:on line,  F: off line, flight 
-	char 	mcc[4];		//e.g. 460
-	char 	mnc[4];		//e.g. 000
-	uint16	lachex;		//0x0001 ~ 0xFFFE
-	
-	uint8	csq;	
-	volatile uint8	uatcwot;			//wait over time
-	char 	uatcbuf[256];	//for user to send atc and waitr;
+	TMdmPdnTag pdn[MDMPDN_MAX];	//contexts by cid - 1
+	uint8	pdncfg;			//contexts of CFGMDM_PDNCFG, bit cid - 1
+	AtcReqTag pdnreq;		//re-activation of the configured contexts gone down, queued on patc
+	SamTmrId pdntmr;		//time to the next re-activation
+	char	pdncmd[112];	//pdnreq command
+
+	TMdmRadioTag radio;		//latest radio status
+	TMdmRadioTag radhis[SAM_MDM_RADIO_HIS];	//ring of the last +CPSI samples
+	uint8	radhead;		//next ring entry to write
+	uint8	radcnt;			//valid ring entries
+
+	AtcReqTag pwrreq;		//PSM and eDRX setup of CFGMDM_PWRCFG, queued on patc
+	char	pwrcmd[64];		//pwrreq command
+
+	AtcReqTag pollreq;		//periodic status poll, queued on patc
+	SamTmrId polltmr;		//time to the next status poll
+	uint8	regsta[MDMREG_NUM];	//registration stat per domain, NONE_MDMREG: not reported
+	uint8	regurc;			//domains reporting registration by URC, bit per MDMREG index
+
+	SamMdmStoreFunTag pstore;	//warm start record storage, NULL: full bring-up every time
+	uint8	warm;			//.warm
+	uint8	warmerr;		//a segment of the identity and PDN step failed, no record is saved
+
+	SamMdmResetFunTag preset;	//module reset, NULL: AT+CRESET
+	uint8	rcvstage;		//.rcvstage of the recovery going on, NONE_MDMRCV: none
+	uint8	rcvtry;			//tries of the stage
+	uint8	rcvn;			//tries of the recovery, exponent of the backoff
+	SamTmrId rcvtmr;		//backoff or boot wait
+	uint32	rcvclk;			//wheel time the recovery started
+	uint32	rcvrnd;			//backoff jitter generator, 0: not seeded
+	TMdmRcvStatTag rcvstat;
+
+	SamMdmLinkFunTag plink;	//host port hook of the link negotiation, NULL: none
+	uint8	link;			//.link
+	uint8	linkflow;		//RTS/CTS wanted
+	uint8	linkfc;			//RTS/CTS set on the module
+	uint32	linkbase;		//module default rate, the host port opens at it
+	uint32	linkmax;		//highest rate to try, lowered below a rate which failed
+	uint32	linkrate;		//rate in use
+	uint32	linknew;		//rate tried
+
+#if SAM_CFG_PROCBUD_ENABLED
+	uint32	budclk;			//GetSysUsCnt at the start of the pass
+	uint32	budus;			//budget of the pass, 0: unbounded
+#endif
 	
 	
 }TMdmTag;
@@ -82,19 +233,39 @@ enum{
 	INIT_MDMSTA = 0x02,
 	FFUN_MDMSTA, 
 	FAIL_MDMSTA,
+	LINK_MDMSTA,		//rate and flow control negotiation, see SamMdmSetLink
 
 };
 
+//.warm
+enum{
+	COLD_MDMWARM = 0,	//full bring-up, the record is saved after it
+	CHK_MDMWARM,		//record loaded, identities are read and compared only
+	HIT_MDMWARM,		//record matches or is saved
+};
+
+//.link
+enum{
+	OFF_MDMLINK = 0,	//no negotiation
+	PEND_MDMLINK,		//at the next bring-up
+	DONE_MDMLINK,		//negotiated, kept until the module resets
+};
+
 //.condition
 #define ATCOK_MDMCND	0x00000001	//AT commands work fine
 #define CPINR_MDMCND	0x00000002	//SIM CARD READY 
 #define PSREG_MDMCND	0x00000004	//PS IS REGESTED
 #define IPACT_MDMCND	0x00000008	//IP LAYER IS READY
+#define INSRV_MDMCND	0x00000010	//BRING-UP DONE, IN SERVICE
 //wait for pin code 
 #define WFPIN_MDMCND	0x00000020	//WAIT FOR PIN CODE
 
 #define CFUN0_MDMCND  	0x80000000
 
+//.urcbmk
+#define RECHK_MDMURC	0x00000001	//an event asks for a status poll at once
+#define PWAIT_MDMURC	0x00000002	//the status poll waits for the batch window
+
 //IP MASK BITS
 #define	IPABIT_MDMCND	0x00000100
 #define IPBMSK_MDMCND	0x0000FF00
@@ -124,6 +295,22 @@ extern TMdmTag * SamMdmInit(TMdmTag * pmdm, char * cfgstr);
  */
 extern unsigned char SamMdmProc(void * pvmdm);
 
+/**
+ * @brief Process the modem operations within a time budget.
+ *
+ * As SamMdmProc, which runs it with SAM_MDM_PROC_BUDUS. Once the pass has used budus,
+ * no further functional block is started on that AT channel and SamNextDeadlineMs
+ * returns 0, the blocks left out run first on the next pass. At least one block runs
+ * per channel and pass, and a block holding the channel (RETCHAR_KEEP) runs alone, so
+ * a pass may exceed the budget by one block run. The budget applies with
+ * SAM_CFG_PROCBUD_ENABLED only.
+ *
+ * @param pvmdm Pointer to the modem structure.
+ * @param budus Time budget in us by GetSysUsCnt, 0 for unbounded.
+ * @return A return code indicating the result of the processing.
+ */
+extern unsigned char SamMdmProcBud(void * pvmdm, uint32 budus);
+
 /**
  * @brief Stop the modem operation.
  *
@@ -137,8 +324,8 @@ extern unsigned char SamMdmStop(void * pvmdm);
 /**
  * @brief Callback function for handling URC (Unsolicited Result Code) messages from the modem.
  *
- * This function checks if the received URC string matches a predefined pattern.
- * If a match is found, it sets a bit in the URC callback mask of the modem structure.
+ * Updates the conditon bits from +CREG/+CGREG/+CEREG, +CGEV, +CPIN and +SIMCARD
+ * URCs, and sets RECHK_MDMURC in urcbmk when a loss asks for a status poll at once.
  *
  * @param pvmdm Pointer to the modem structure.
  * @param urcstr Pointer to the received URC string.
@@ -146,6 +333,113 @@ extern unsigned char SamMdmStop(void * pvmdm);
  */
 extern unsigned char SamMdmUrcCbfun(void * pvmdm, char * urcstr);
 
+/**
+ * @brief Set the storage of the warm start record.
+ *
+ * With a storage hook, the bring-up saves the firmware version, IMEI, ICCID, IMSI and
+ * the applied PDN configuration, only when every command of that step succeeded.
+ * The next bring-up reads them back with one query and
+ * skips the CFUN cycle and the PDN rewrite when none of them changed.
+ * Call it after SamMdmInit and before the first SamMdmProc.
+ *
+ * @param pmdm Pointer to the modem structure.
+ * @param pfun Storage hook, NULL for a full bring-up every time.
+ */
+extern void SamMdmSetStore(TMdmTag * pmdm, SamMdmStoreFunTag pfun);
+
+/**
+ * @brief Queue a user AT command on the modem channel.
+ *
+ * The application fills cmd ("AT...\r", segments as for SamSendAtCmd), timwm, pcb and
+ * pd of a request it owns and keeps it valid until pcb reports the final result.
+ * Requests go out one at a time in submit order, between the transactions of the
+ * functional blocks, once the modem is up. Every response line is passed to pcb with
+ * NOSTRRET_ATCRET as it arrives, a line longer than the channel buffer in parts with
+ * PARTLINE_ATCRET, and appended to rspbuf if set. Without pset, OK, ERROR, +CME ERROR
+ * and +CMS ERROR end the command, and the final result is their index 1..4 or
+ * OVERTIME_ATCRET. Several requests may be queued at once.
+ *
+ * @param pmdm Pointer to the modem structure.
+ * @param preq Pointer to the caller owned request.
+ * @return RETCHAR_TRUE if queued, RETCHAR_FALSE if invalid, not an AT command or already pending.
+ */
+extern uint8 SamMdmUserAtc(TMdmTag * pmdm, AtcReqTag * preq);
+
+/**
+ * @brief Read a radio status sample without an AT round trip.
+ *
+ * +CPSI, +CSQ and +CGPADDR lines of the bring-up, the status poll and SamMdmRadioLine
+ * callers are parsed once into typed fields. Each +CPSI line, with the last +CSQ,
+ * is stored with its time in a ring of SAM_MDM_RADIO_HIS samples.
+ *
+ * @param pmdm Pointer to the modem structure.
+ * @param back 0 for the latest sample, 1 for the one before, ...
+ * @param prad Receives the sample.
+ * @return RETCHAR_TRUE if the sample exists, RETCHAR_FALSE otherwise.
+ */
+extern uint8 SamMdmRadioGet(TMdmTag * pmdm, uint8 back, TMdmRadioTag * prad);
+
+/**
+ * @brief Parse a +CPSI, +CSQ, +CGPADDR or +CGCONTRDP line into the radio and PDN status.
+ *
+ * For lines the application read itself, e.g. by SamMdmUserAtc.
+ *
+ * @param pmdm Pointer to the modem structure.
+ * @param line Response line.
+ * @return CPSI_MDMRAD, CSQ_MDMRAD, CGPADDR_MDMRAD or CGCONTRDP_MDMRAD for the line taken, 0 for other lines.
+ */
+extern uint8 SamMdmRadioLine(TMdmTag * pmdm, char * line);
+
+/**
+ * @brief Look up a PDN context by cid.
+ *
+ * The contexts of CFGMDM_PDNCFG are activated by one command at bring-up. A context
+ * going down, by +CGEV or an empty +CGPADDR, is re-activated alone while the others
+ * stay in use, up to SAM_MDM_PDN_TRIES times SAM_MDM_PDN_RETRY_MS apart before the
+ * modem recovery starts. Addresses, DNS servers and MTU come from +CGPADDR and
+ * +CGCONTRDP, IPv4 and IPv6 in binary.
+ *
+ * @param pmdm Pointer to the modem structure.
+ * @param cid Context id 1..MDMPDN_MAX.
+ * @return The context if it is up, NULL otherwise.
+ */
+extern TMdmPdnTag * SamMdmPdnGet(TMdmTag * pmdm, uint8 cid);
+
+/**
+ * @brief Set the module reset hook of the recovery.
+ *
+ * When the modem fails, recovery goes through PDN re-activation, a CFUN cycle and a
+ * module reset, each tried SAM_MDM_RCV_TRIES times before the next. Every try waits
+ * SAM_MDM_RCV_BASE_MS doubled per try of the recovery up to SAM_MDM_RCV_MAX_MS, the
+ * upper half of it random, so modems losing the same cell do not return in step.
+ * A modem not answering AT goes to the reset stage at once.
+ *
+ * @param pmdm Pointer to the modem structure.
+ * @param pfun Reset hook, NULL to send AT+CRESET.
+ */
+extern void SamMdmSetReset(TMdmTag * pmdm, SamMdmResetFunTag pfun);
+
+/**
+ * @brief Set up the UART rate and flow control negotiation of the bring-up.
+ *
+ * Once the modem answers AT at base, the bring-up sets AT+IFC=2,2 if flow is 1, reads
+ * the rates of AT+IPR=? and switches to the highest one up to max the host port takes
+ * by AT+IPR, calling pfun after each module change so the host port follows. If the modem does not answer
+ * SAM_MDM_LINK_TRIES AT commands at the new rate, AT+IPR=<previous rate> is sent, the
+ * host goes back to it and the rates below are tried. Without an answer at the previous
+ * rate the bring-up checks AT again and the recovery resets the module. AT+IPR does
+ * not survive a module reset, so the reset stage of the recovery returns the host to
+ * base and negotiates again. Not used while the AT channels run over CMUX.
+ * Call it after SamMdmInit and before the first SamMdmProc.
+ *
+ * @param pmdm Pointer to the modem structure.
+ * @param pfun Host port hook, NULL to keep the rate the port was opened at.
+ * @param base Rate the host port is opened at, the module default.
+ * @param max Highest rate the host port supports.
+ * @param flow 1 to use RTS/CTS flow control.
+ */
+extern void SamMdmSetLink(TMdmTag * pmdm, SamMdmLinkFunTag pfun, uint32 base, uint32 max, uint8 flow);
+
 
 
 
@@ -26,6 +26,23 @@
 
 // init mqttinfo example
 unsigned char sam_mqtt_urc_cb(void * pvscm, char * urcstr);
+static void sam_mqtt_urc_link(TMqttTag * pmqtt);
+static void sam_mqtt_topic_sink(void * pvmqtt, char * dp, uint16 len, uint16 rest);
+static void sam_mqtt_payload_sink(void * pvmqtt, char * dp, uint16 len, uint16 rest);
+
+static StrsSetTag mqtt_start_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CMQTTSTART:");
+static StrsSetTag mqtt_accq_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CMQTTACCQ:");
+static StrsSetTag mqtt_willtopic_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CMQTTWILLTOPIC:\t>");
+static StrsSetTag mqtt_willmsg_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CMQTTWILLMSG:\t>");
+static StrsSetTag mqtt_connect_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CMQTTCONNECT:");
+static StrsSetTag mqtt_sub_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t>\t+CMQTTSUB:");
+static StrsSetTag mqtt_topic_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CMQTTTOPIC:\t>");
+static StrsSetTag mqtt_payload_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CMQTTPAYLOAD:\t>");
+static StrsSetTag mqtt_pub_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CMQTTPUB:");
+static StrsSetTag mqtt_disc_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CMQTTDISC:");
+static StrsSetTag mqtt_rel_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CMQTTREL:");
+static StrsSetTag mqtt_stop_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CMQTTSTOP:");
+static StrsSetTag mqtt_urc_set = STRSSET_DEF("+CMQTTRXSTART:\t+CMQTTRXTOPIC:\t+CMQTTRXPAYLOAD:\t+CMQTTRXEND:\t+CMQTTCONNLOST:\t+CMQTTNONET");
 
 /**
  * @brief Initialize MQTT context structure
@@ -363,8 +380,10 @@ void * sam_mqtt_init(TMqttTag * pmqtt, char * cfgstr)
 	//pmqtt->dncnt = 0;
 	pmqtt->urcbmk = 0;
 	
-	pmqtt->msclk = SamGetMsCnt(0);
+	pmqtt->stmr = SamTmrStart(0, 1000, 1000);
 	pmqtt->runlink =	SamAtcFunLink(pmqtt->phatc, pmqtt, sam_mqtt_proc, sam_mqtt_urc_cb);
+	SamAtcFunPrio(pmqtt->phatc, pmqtt->runlink, HIGH_FUNPRIO, 0);
+	sam_mqtt_urc_link(pmqtt);
 	pmqtt->receive_data_cb = NULL;
 
   //	DebugTrace("@%s: Runlink=%u, DataPoint=%p\r\n", __FUNCTION__, pscm->runlink, pscm);
@@ -372,6 +391,87 @@ void * sam_mqtt_init(TMqttTag * pmqtt, char * cfgstr)
 	return(pmqtt);
 }
                       
+/**
+ * @brief Declare the URC prefixes owned by an MQTT client on its AT channel
+ *
+ * Receive and connection-lost URCs carry the client index, so each client only
+ * gets its own lines; +CMQTTNONET concerns all clients.
+ *
+ * @param pmqtt Pointer to the linked MQTT client structure
+ */
+static void sam_mqtt_urc_link(TMqttTag * pmqtt)
+{
+	char prefix[32];
+	static const char * const fmts[] = {"+CMQTTRXSTART: %u,", "+CMQTTRXTOPIC: %u,", "+CMQTTRXPAYLOAD: %u,", "+CMQTTRXEND: %u", "+CMQTTCONNLOST: %u,"};
+	uint8 i;
+
+	for(i = 0; i < sizeof(fmts)/sizeof(fmts[0]); i++)
+	{
+		sprintf(prefix, fmts[i], pmqtt->client_index);
+		SamAtcUrcLink(pmqtt->phatc, pmqtt->runlink, prefix);
+	}
+	SamAtcUrcLink(pmqtt->phatc, pmqtt->runlink, "+CMQTTNONET");
+
+	sprintf(prefix, "+CMQTTRXTOPIC: %u,", pmqtt->client_index);
+	SamAtcBinLink(pmqtt->phatc, pmqtt->runlink, &(pmqtt->t_rule), prefix, 0, sam_mqtt_topic_sink, pmqtt);
+	sprintf(prefix, "+CMQTTRXPAYLOAD: %u,", pmqtt->client_index);
+	SamAtcBinLink(pmqtt->phatc, pmqtt->runlink, &(pmqtt->m_rule), prefix, 0, sam_mqtt_payload_sink, pmqtt);
+}
+
+/**
+ * @brief Collect the topic of a received message behind +CMQTTRXTOPIC
+ *
+ * Called by the AT framer with the topic bytes as they arrive; bytes beyond
+ * MQTT_SUB_TOPIC_MAX_LEN are dropped. A topic cut short is discarded.
+ *
+ * @param pvmqtt Pointer to the MQTT client structure
+ * @param dp Pointer to the received span, NULL if the topic was cut short
+ * @param len Number of bytes in the span
+ * @param rest Number of topic bytes still to come
+ */
+static void sam_mqtt_topic_sink(void * pvmqtt, char * dp, uint16 len, uint16 rest)
+{
+	TMqttTag * pmqtt = (TMqttTag *)pvmqtt;
+	(void)rest;
+	if(dp == NULL)
+	{
+		memset(pmqtt->t_buf, 0, sizeof(pmqtt->t_buf));
+		pmqtt->t_cnt = 0;
+		return;
+	}
+	if(len > MQTT_SUB_TOPIC_MAX_LEN - pmqtt->t_cnt) len = MQTT_SUB_TOPIC_MAX_LEN - pmqtt->t_cnt;
+	memcpy(&(pmqtt->t_buf[pmqtt->t_cnt]), dp, len);
+	pmqtt->t_cnt += len;
+	pmqtt->t_buf[pmqtt->t_cnt] = 0;
+}
+
+/**
+ * @brief Collect the payload of a received message behind +CMQTTRXPAYLOAD
+ *
+ * Called by the AT framer with the payload bytes as they arrive; bytes beyond
+ * MQTT_SUB_PAYLOAD_MAX_LEN are dropped. A payload cut short is discarded.
+ *
+ * @param pvmqtt Pointer to the MQTT client structure
+ * @param dp Pointer to the received span, NULL if the payload was cut short
+ * @param len Number of bytes in the span
+ * @param rest Number of payload bytes still to come
+ */
+static void sam_mqtt_payload_sink(void * pvmqtt, char * dp, uint16 len, uint16 rest)
+{
+	TMqttTag * pmqtt = (TMqttTag *)pvmqtt;
+	(void)rest;
+	if(dp == NULL)
+	{
+		memset(pmqtt->m_buf, 0, sizeof(pmqtt->m_buf));
+		pmqtt->m_cnt = 0;
+		return;
+	}
+	if(len > MQTT_SUB_PAYLOAD_MAX_LEN - pmqtt->m_cnt) len = MQTT_SUB_PAYLOAD_MAX_LEN - pmqtt->m_cnt;
+	memcpy(&(pmqtt->m_buf[pmqtt->m_cnt]), dp, len);
+	pmqtt->m_cnt += len;
+	pmqtt->m_buf[pmqtt->m_cnt] = 0;
+}
+
 /**
  * @brief Stop MQTT client and release associated resources
  *
@@ -394,6 +494,8 @@ unsigned char sam_mqtt_stop(void * pmqtt)
 	tpMqtt = (TMqttTag *)pmqtt;
 	//i =	SamAtcFunUnlink(tpMqtt->phatc, tpMqtt->runlink);
 	SamAtcFunUnlink(tpMqtt->phatc, tpMqtt->runlink);
+	SamTmrStop(tpMqtt->stmr);
+	tpMqtt->stmr = 0;
     sam_mqtt_context_release(&tpMqtt->mqtt_context);
 	return('1');
 }
@@ -426,7 +528,7 @@ unsigned char sam_mqtt_urc_cb(void * pvscm, char * urcstr)
     if(NULL == phatc)
         return RETCHAR_NONE;
     
-    temp = StrsCmp(urcstr, "+CMQTTRXSTART:\t+CMQTTRXTOPIC:\t+CMQTTRXPAYLOAD:\t+CMQTTRXEND:\t+CMQTTCONNLOST:\t+CMQTTNONET");
+    temp = StrsSetCmp(urcstr, &mqtt_urc_set);
 	if(temp >= 1 && temp <= 6)
 	{
 		SAM_DBG_MODULE(SAM_MOD_MQTT, SAM_DBG_LEVEL_DEBUG, "sam_mqtt_urc_cb:urc position temp == %u \r\n", temp);
@@ -470,37 +572,9 @@ unsigned char sam_mqtt_urc_cb(void * pvscm, char * urcstr)
 					return(RETCHAR_NONE);
 				}
 				
-				pmqtt->t_cnt = topic_len;
-				if(pmqtt->t_cnt > MQTT_SUB_TOPIC_MAX_LEN)
-					pmqtt->t_cnt = MQTT_SUB_TOPIC_MAX_LEN;
-
-				uint16 remain_len = pmqtt->t_cnt + 2;
-				uint16 read_len = 0;
-				char dp_buf[MQTT_SUB_TOPIC_MAX_LEN + 3] = {0};
-				int p = 0;
-
-                memset(pmqtt->t_buf, 0, sizeof(pmqtt->t_buf) );
-				//memcpy(pmqtt->t_buf, urcstr, pmqtt->t_cnt);
-				
-                while(remain_len > 0)
-            	{
-                    SAM_DBG_MODULE(SAM_MOD_MQTT, SAM_DBG_LEVEL_DEBUG, "sam_mqtt_urc_cb:case2 read topic remain_len == %u\r\n", remain_len);
-					 read_len = SamAtcDubRead(phatc, remain_len, dp_buf);
-                    SAM_DBG_MODULE(SAM_MOD_MQTT, SAM_DBG_LEVEL_DEBUG, "sam_mqtt_urc_cb:case2 read topic read_len == %u\r\n", read_len);
-					 if(read_len > 0)
-				 	 {
-						 memcpy(&(pmqtt->t_buf[p]), dp_buf, read_len);
-						 memset(dp_buf, 0, sizeof(dp_buf));
-
-						 p = p + read_len;
-
-						 remain_len = remain_len - read_len;
-				 	}
-            	}
-
-				pmqtt->t_buf[pmqtt->t_cnt] = 0;
-				pmqtt->t_buf[pmqtt->t_cnt + 1] = 0;
-                SAM_DBG_MODULE(SAM_MOD_MQTT, SAM_DBG_LEVEL_DEBUG, "sam_mqtt_urc_cb:case2 pmqtt->t_buf == %s\r\n", pmqtt->t_buf);
+				//the topic bytes follow, collected by sam_mqtt_topic_sink
+                memset(pmqtt->t_buf, 0, sizeof(pmqtt->t_buf));
+				pmqtt->t_cnt = 0;
             }
             break;
         case 3://+CMQTTRXPAYLOAD: 0,60
@@ -517,37 +591,9 @@ unsigned char sam_mqtt_urc_cb(void * pvscm, char * urcstr)
 					return(RETCHAR_NONE);
 				}
 				
-				pmqtt->m_cnt = payload_len;
-				if(pmqtt->m_cnt > MQTT_SUB_PAYLOAD_MAX_LEN)
-					pmqtt->m_cnt = MQTT_SUB_PAYLOAD_MAX_LEN;
-
-				uint16 remain_len = pmqtt->m_cnt + 2;
-				uint16 read_len = 0;
-				char dp_buf[MQTT_SUB_PAYLOAD_MAX_LEN + 3] = {0};
-				int p = 0;
-
-                memset(pmqtt->m_buf, 0, sizeof(pmqtt->m_buf) );
-				//memcpy(pmqtt->t_buf, urcstr, pmqtt->t_cnt);
-				
-                while(remain_len > 0)
-            	{
-                    SAM_DBG_MODULE(SAM_MOD_MQTT, SAM_DBG_LEVEL_DEBUG, "sam_mqtt_urc_cb:case3 read payload remain_len == %u\r\n", remain_len);
-					 read_len = SamAtcDubRead(phatc, remain_len, dp_buf);
-                    SAM_DBG_MODULE(SAM_MOD_MQTT, SAM_DBG_LEVEL_DEBUG, "sam_mqtt_urc_cb:case3 read payload read_len == %u\r\n", read_len);
-					 if(read_len > 0)
-				 	 {
-						 memcpy(&(pmqtt->m_buf[p]), dp_buf, read_len);
-						 memset(dp_buf, 0, sizeof(dp_buf));
-
-						 p = p + read_len;
-
-						 remain_len = remain_len - read_len;
-				 	}
-            	}
-
-				pmqtt->m_buf[pmqtt->m_cnt] = 0;
-				pmqtt->m_buf[pmqtt->m_cnt + 1] = 0;
-                SAM_DBG_MODULE(SAM_MOD_MQTT, SAM_DBG_LEVEL_DEBUG, "sam_mqtt_urc_cb:case3 pmqtt->m_buf == %s\r\n", pmqtt->m_buf);
+				//the payload bytes follow, collected by sam_mqtt_payload_sink
+                memset(pmqtt->m_buf, 0, sizeof(pmqtt->m_buf));
+				pmqtt->m_cnt = 0;
             }
             break;
         case 4://+CMQTTRXEND: 0
@@ -849,7 +895,6 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 	//uint8 i, j, ratcret;
 	uint8 ratcret;
 	//uint32 clk, n, m;
-	uint32 clk;
 	char buf[256] = {0};
 	//char str[256] = {0};
 	//char tempchar;
@@ -866,20 +911,14 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 
     pMqttCtxt = &pmqtt->mqtt_context;
 
-	clk = SamGetMsCnt(pmqtt->msclk);
-	while(clk >= 1000)
-	{
-		pmqtt->msclk +=1000;
-		pmqtt->stim += 1;
-		clk -= 1000;
-	}
+	pmqtt->stim += SamTmrPeriod(&(pmqtt->stmr), 1000);
 	
 	switch(pmqtt->sta)
 	{
 		case MQTT_STATUS_INIT :
             if(pmqtt->step == MQTT_INIT_STEP_CMQTTSTART && pmqtt->stim >= 1)
 			{
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) phatc->retbufp = 0;
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) phatc->retbufp = 0;
 
                 memset(buf, 0, sizeof(buf));
                 sprintf(buf, "AT+CMQTTSTART\r");
@@ -891,7 +930,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 			}
 			else if(pmqtt->step == MQTT_INIT_STEP_CMQTTSTART_RES_CHECK && pmqtt->stim >= 1)
 			{
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMQTTSTART:");
+				ratcret = SamChkAtcSet(phatc, &mqtt_start_rsp);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -967,7 +1006,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
             }
             else if(pmqtt->step == MQTT_INIT_STEP_CMQTTACCQ_RES_CHECK)
             {
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMQTTACCQ:");
+				ratcret = SamChkAtcSet(phatc, &mqtt_accq_rsp);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -1050,7 +1089,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
             }
 			else if(pmqtt->step == MQTT_INIT_STEP_CMQTTWILLTOPIC_RES_CHECK)
 			{
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMQTTWILLTOPIC:\t>");
+				ratcret = SamChkAtcSet(phatc, &mqtt_willtopic_rsp);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -1131,7 +1170,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
             }
 			else if(pmqtt->step == MQTT_INIT_STEP_CMQTTWILLMSG_RES_CHECK)
 			{
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMQTTWILLMSG:\t>");
+				ratcret = SamChkAtcSet(phatc, &mqtt_willmsg_rsp);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -1200,7 +1239,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
             }
 			else if(pmqtt->step == MQTT_INIT_STEP_CMQTTCONNECT_RES_CHECK && pmqtt->stim >= 1)
 			{
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMQTTCONNECT:");
+				ratcret = SamChkAtcSet(phatc, &mqtt_connect_rsp);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -1289,7 +1328,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 		case MQTT_STATUS_DATA_PROCESS :
 			if(pmqtt->step == MQTT_DATAPROC_STEP_CMQTTSUB && pmqtt->stim > 1)
 			{
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) phatc->retbufp = 0;
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) phatc->retbufp = 0;
                 
                 if(NULL != pmqtt->mqtt_context.p_sub_topic && pmqtt->mqtt_context.sub_topic_req_lenth > 0)
                 {
@@ -1301,7 +1340,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 					phatc->databuf = pmqtt->mqtt_context.p_sub_topic;
 					phatc->databufp = pmqtt->mqtt_context.sub_topic_req_lenth;
                 }
-                else if(pMqttCtxt->pub_msg_list.pub_head != NULL && pMqttCtxt->pub_msg_list.length > 0)
+                else if(pMqttCtxt->pub_msg_list.pub_head != NULL && pMqttCtxt->pub_msg_list.length > 0 && SamPwrTxGate() == RETCHAR_TRUE)
                 {
                     //pmqtt->step = 2;
                     pmqtt->step = MQTT_DATAPROC_STEP_CMQTTTOPIC;
@@ -1314,9 +1353,13 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
                     pmqtt->stim = 0;
                 }
 			}
+			else if(pmqtt->step == MQTT_DATAPROC_STEP_CMQTTSUB && SamAtcFunYield(phatc) == RETCHAR_TRUE)
+			{//pause before the next subscribe or publish, nothing in flight
+				return(RETCHAR_FREE);
+			}
 			else if(pmqtt->step == MQTT_DATAPROC_STEP_CMQTTSUB_RES_CHECK)
 			{
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t>\t+CMQTTSUB:");
+				ratcret = SamChkAtcSet(phatc, &mqtt_sub_rsp);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -1399,7 +1442,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
             }
             else if(pmqtt->step == MQTT_DATAPROC_STEP_CMQTTTOPIC_RES_CHECK)
             {
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMQTTTOPIC:\t>");
+				ratcret = SamChkAtcSet(phatc, &mqtt_topic_rsp);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -1463,7 +1506,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
             }
             else if(pmqtt->step == MQTT_DATAPROC_STEP_CMQTTPAYLOAD_RES_CHECK)
             {
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMQTTPAYLOAD:\t>");
+				ratcret = SamChkAtcSet(phatc, &mqtt_payload_rsp);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -1526,7 +1569,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
             }
             else if(pmqtt->step == MQTT_DATAPROC_STEP_CMQTTPUB_RES_CHECK)
             {
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMQTTPUB:");
+				ratcret = SamChkAtcSet(phatc, &mqtt_pub_rsp);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -1597,7 +1640,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 				//if(0 == pmqtt->step)//MQTT_STATUS_SWITCH_STEP_CMQTTDISC
 				if(MQTT_STATUS_SWITCH_STEP_CMQTTDISC == pmqtt->step)
 				{
-					while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) phatc->retbufp = 0;
+					while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) phatc->retbufp = 0;
 					if(1 == pmqtt->close_req)
 					{
 					   // if(MQTT_CONNECTED == pmqtt->connect_status)
@@ -1620,7 +1663,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 				}
 				else if(MQTT_STATUS_SWITCH_STEP_CMQTTDISC_RES_CHECK == pmqtt->step)
 				{
-					ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMQTTDISC:");
+					ratcret = SamChkAtcSet(phatc, &mqtt_disc_rsp);
 					if(ratcret == NOSTRRET_ATCRET)
 					{
 	                	return(RETCHAR_KEEP);
@@ -1695,7 +1738,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 				}
 				else if(MQTT_STATUS_SWITCH_STEP_CMQTTREL_RES_CHECK == pmqtt->step)
 				{
-					ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMQTTREL:");
+					ratcret = SamChkAtcSet(phatc, &mqtt_rel_rsp);
 					if(ratcret == NOSTRRET_ATCRET)
 					{
 	                	return(RETCHAR_KEEP);
@@ -1752,7 +1795,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 				}
 				else if(MQTT_STATUS_SWITCH_STEP_CMQTTSTOP_RES_CHECK == pmqtt->step)
 				{
-					ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMQTTSTOP:");
+					ratcret = SamChkAtcSet(phatc, &mqtt_stop_rsp);
 					if(ratcret == NOSTRRET_ATCRET)
 					{
 	                	return(RETCHAR_KEEP);
@@ -1812,7 +1855,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 			break;
 		case MQTT_STATUS_IDLE :
             {
-			while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) phatc->retbufp = 0;
+			while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) phatc->retbufp = 0;
             
 			//if(pscm->stim >= 60 || (pscm->urcbmk & phatc->urcbitmask) != 0 || pscm->upcnt != 0)
 			if(MQTT_DISCONNECTED == pmqtt->connect_status && 1 != pmqtt->close_req)
@@ -1821,7 +1864,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 				pmqtt->step = MQTT_INIT_STEP_CMQTTCONNECT;
 				pmqtt->stim = 0;
 			}
-            else if((NULL != pmqtt->mqtt_context.p_sub_topic && pmqtt->mqtt_context.sub_topic_req_lenth > 0) || (pMqttCtxt->pub_msg_list.pub_head != NULL && pMqttCtxt->pub_msg_list.length > 0))  
+            else if((NULL != pmqtt->mqtt_context.p_sub_topic && pmqtt->mqtt_context.sub_topic_req_lenth > 0) || (pMqttCtxt->pub_msg_list.pub_head != NULL && pMqttCtxt->pub_msg_list.length > 0 && SamPwrTxGate() == RETCHAR_TRUE))  
 			{
 				pmqtt->sta = MQTT_STATUS_DATA_PROCESS;
 				//pmqtt->step=0;
@@ -1849,7 +1892,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 			break;
 		case MQTT_STATUS_FAIL:
             {
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) phatc->retbufp = 0;
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) phatc->retbufp = 0;
 				switch(pmqtt->fail_type)
 				{
 					case MQTT_FAIL_TYPE_CONNECT_FAIL:
@@ -2020,7 +2063,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 				//if(0 == pmqtt->step)//MQTT_STATUS_SWITCH_STEP_CMQTTDISC
 				if(MQTT_CONNECT_RESET_STEP_CMQTTDISC == pmqtt->step)
 				{
-					while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) phatc->retbufp = 0;
+					while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) phatc->retbufp = 0;
 					memset(buf, 0, sizeof(buf));
 	                sprintf(buf, "AT+CMQTTDISC=%u\r", pmqtt->client_index);
 					SamSendAtCmd(phatc, buf, CRLF_HATCTYP, 90);
@@ -2031,7 +2074,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 				}
 				else if(MQTT_CONNECT_RESET_STEP_CMQTTDISC_RES_CHECK == pmqtt->step)
 				{
-					ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMQTTDISC:");
+					ratcret = SamChkAtcSet(phatc, &mqtt_disc_rsp);
 					if(ratcret == NOSTRRET_ATCRET)
 					{
 	                	return(RETCHAR_KEEP);
@@ -2106,7 +2149,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 				}
 				else if(MQTT_CONNECT_RESET_STEP_CMQTTREL_RES_CHECK == pmqtt->step)
 				{
-					ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMQTTREL:");
+					ratcret = SamChkAtcSet(phatc, &mqtt_rel_rsp);
 					if(ratcret == NOSTRRET_ATCRET)
 					{
 	                	return(RETCHAR_KEEP);
@@ -2167,7 +2210,7 @@ unsigned char sam_mqtt_proc(void * pvmqtt)
 				}
 				else if(MQTT_CONNECT_RESET_STEP_CMQTTSTOP_RES_CHECK == pmqtt->step)
 				{
-					ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMQTTSTOP:");
+					ratcret = SamChkAtcSet(phatc, &mqtt_stop_rsp);
 					if(ratcret == NOSTRRET_ATCRET)
 					{
 	                	return(RETCHAR_KEEP);
@@ -2253,6 +2296,7 @@ uint8 sam_mqtt_subscribe_topic(TMqttTag * pmqtt, char *pTopic)
     if(NULL == pmqtt->mqtt_context.p_sub_topic && 0 == pmqtt->mqtt_context.sub_topic_req_lenth)
     {
         add_sub_topic(&pmqtt->mqtt_context, pTopic);
+        SamDeadlineNote(0);
         return 1;
     }
     else
@@ -2289,6 +2333,8 @@ uint8 sam_mqtt_publish_message(TMqttTag * pmqtt, char *pTopic, char *pMsg)
     if(NULL != pNode)
     {
         SAM_DBG_MODULE(SAM_MOD_MQTT, SAM_DBG_LEVEL_INFO, ">>>sam_mqtt_publish_message success!!  list lenth == %u\r\n",pmqtt->mqtt_context.pub_msg_list.length);
+        SamPwrTxAdd(strlen(pMsg));
+        SamDeadlineNote(0);
         res = 1;
     }
     else
@@ -2369,6 +2415,7 @@ uint8  sam_mqtt_close(TMqttTag * pvmqtt)
 	if(status)
 	{
 		pvmqtt->close_req = 1;
+		SamDeadlineNote(0);
 		return 1;
 	}
 	else
@@ -279,7 +279,7 @@ typedef struct TMqttTag {
 	mqtt_option_step_type	step;
 	uint8	dcnt;
     uint8	runlink;	// For run link in atclink  
-    uint32	msclk;	// For recording system clock
+    SamTmrId	stmr;	// Second tick timer
     uint8	stim;	// Second timer for user  
 
 	uint8  client_index;
@@ -304,6 +304,9 @@ typedef struct TMqttTag {
     char	m_buf[MQTT_SUB_PAYLOAD_MAX_LEN + 3];
 	uint16	m_cnt;
 
+	AtcBinRuleTag t_rule;	// +CMQTTRXTOPIC topic bytes to t_buf
+	AtcBinRuleTag m_rule;	// +CMQTTRXPAYLOAD payload bytes to m_buf
+
     sam_mqtt_receive_data_cb receive_data_cb;
 }TMqttTag;
 
@@ -25,4 +25,161 @@
 /* Enable/disable the debug logging system */
 #define SAM_CFG_DEBUG_ENABLED  1
 
+/**
+ * @brief Scheduling configuration.
+ */
+
+/* Longest sleep returned by SamNextDeadlineMs, bounds timers the driver does not know of */
+#ifndef SAM_CFG_IDLE_MAX_MS
+#define SAM_CFG_IDLE_MAX_MS    1000
+#endif
+
+/* Latency budget of socket units, waiting longer puts them before all other units */
+#define SAM_SOCKET_BUDMS       100
+
+/* Stop running units once a SamMdmProc pass used its time budget, see SamMdmProcBud.
+ * Needs the port to provide GetSysUsCnt */
+#ifndef SAM_CFG_PROCBUD_ENABLED
+#define SAM_CFG_PROCBUD_ENABLED 0
+#endif
+
+/* Time budget of a SamMdmProc pass in us, 0: unbounded */
+#define SAM_MDM_PROC_BUDUS     5000
+
+/* Per unit run count, total and worst execution time, see SamAtcFunAcctDump.
+ * Needs the port to provide GetSysUsCnt */
+#ifndef SAM_CFG_FUNACCT_ENABLED
+#define SAM_CFG_FUNACCT_ENABLED 0
+#endif
+
+/* Keep the current SamCtx per thread, for stacks run on separate threads */
+#ifndef SAM_CFG_CTXTLS_ENABLED
+#if defined(__linux__)
+#define SAM_CFG_CTXTLS_ENABLED 1
+#else
+#define SAM_CFG_CTXTLS_ENABLED 0
+#endif
+#endif
+
+/**
+ * @brief Timer service.
+ */
+
+/* Number of timers shared by the units of a SamCtx, see SamTmr.h */
+#define SAM_TMR_NUM            24
+
+/**
+ * @brief AT command statistics.
+ */
+
+/* Per verb latency histograms, ERROR/timeout counts and bytes, see SamAtcStatDump */
+#ifndef SAM_CFG_ATCSTAT_ENABLED
+#define SAM_CFG_ATCSTAT_ENABLED 1
+#endif
+
+/* Number of statistics entries, the last one ("*") is kept for the verbs beyond the others */
+#define SAM_ATCSTAT_VERB_NUM   32
+
+/**
+ * @brief Adaptive AT command timeouts.
+ */
+
+/* Learn the wait time of commands sent with ARTO_HATCTYP from their response times */
+#ifndef SAM_CFG_ATCRTO_ENABLED
+#define SAM_CFG_ATCRTO_ENABLED 1
+#endif
+
+/* Number of verbs learned, commands beyond keep the caller's wait time */
+#define SAM_ATCRTO_VERB_NUM    32
+
+/* Samples taken before the learned timeout applies */
+#define SAM_ATCRTO_LEARN       4
+
+/* Lower bound of the learned timeout in ms */
+#define SAM_ATCRTO_MIN_MS      500
+
+/**
+ * @brief AT command coalescing.
+ */
+
+/* Merge consecutive segments of commands sent with COAL_HATCTYP into one ';' line */
+#ifndef SAM_CFG_ATCCOAL_ENABLED
+#define SAM_CFG_ATCCOAL_ENABLED 1
+#endif
+
+/**
+ * @brief Port configuration.
+ */
+
+/* The port provides SendtoComV(com, iov, cnt); else fragments go out by SendtoCom one by one */
+#ifndef SAM_CFG_COMV_ENABLED
+#define SAM_CFG_COMV_ENABLED   0
+#endif
+
+/**
+ * @brief Modem unit.
+ */
+
+/* Status poll period while no registration URCs have been seen */
+#define SAM_MDM_POLL_MS        30000
+
+/* Status poll period once registration is reported by +CREG/+CGREG/+CEREG URCs */
+#define SAM_MDM_SAFEPOLL_MS    300000
+
+/* Recovery tries per stage before escalating to the next one, see SamMdmSetReset */
+#define SAM_MDM_RCV_TRIES      3
+
+/* Recovery backoff: first wait, doubled per try up to the max, upper half random */
+#define SAM_MDM_RCV_BASE_MS    2000
+#define SAM_MDM_RCV_MAX_MS     600000
+
+/* Boot time of the module after a reset */
+#define SAM_MDM_BOOT_MS        20000
+
+/* AT commands sent at a new UART rate before going back to the previous one, see SamMdmSetLink */
+#define SAM_MDM_LINK_TRIES     3
+
+/* Radio status samples kept, see SamMdmRadioGet */
+#define SAM_MDM_RADIO_HIS      16
+
+/* Re-activations of a PDN context gone down before the modem recovery, and the wait
+ * between them, see SamMdmPdnGet */
+#define SAM_MDM_PDN_TRIES      3
+#define SAM_MDM_PDN_RETRY_MS   5000
+
+/**
+ * @brief Power saving and uplink batching, see SamPwr.h.
+ */
+
+/* Radio time one send is modelled to keep the radio connected, the RRC inactivity timer */
+#define SAM_PWR_TAIL_MS        10000
+
+/* Sends and bytes held in one batch before it goes out at once */
+#define SAM_PWR_BATCH_MAX      8
+#define SAM_PWR_BATCH_BYTES    4096
+
+/* Time without a send after which an open batch window closes */
+#define SAM_PWR_IDLE_MS        1000
+
+/**
+ * @brief 3GPP 27.010 multiplexer configuration.
+ */
+
+/* Run the AT channels as CMUX DLCs over the ATCCH_A port */
+#ifndef SAM_CFG_CMUX_ENABLED
+#define SAM_CFG_CMUX_ENABLED   0
+#endif
+
+/* Number of DLCs opened, each one is an AT channel of pAtcBusArray */
+#define SAM_CMUX_DLC_NUM       3
+
+/* Max information field per frame, AT+CMUX=0 default */
+#define SAM_CMUX_N1            31
+
+/* Receive buffer per DLC */
+#define SAM_CMUX_RXBUF_SIZE    1024
+
+/* Frames the port has not taken yet, at least SAM_CMUX_N1 + 7 */
+#define SAM_CMUX_TXBUF_SIZE    256
+
 #endif /* SAM_OPTS_H */
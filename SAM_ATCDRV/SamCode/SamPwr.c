@@ -0,0 +1,243 @@
+/**
+ * @file 	SamPwr.c
+ * @brief   PSM/eDRX power saving and uplink batching
+ * @details The batch window of each context is closed while sends collect and open
+ *			while they go out. It opens at the first scheduled wake after the first
+ *			held send, at the end of the window or when the batch fills, and closes
+ *			once the units stop sending.
+ *
+ * @version 1.0.0
+ * @date 	2025-08-01
+ * @author 	Alex <fanbing.kong@sunseaaiot.com>
+ * @copyright Copyright (c) 2025, SIMCom Wireless Solutions Limited. All rights reserved.
+ *
+ * @note
+ *
+ *
+ */
+//---------------------------------------------------------------------------
+
+#define __SAMPWR_C
+
+#include "SamInc.h"
+
+//eDRX cycles in ms by 3GPP TS 24.008 code, E-UTRAN
+static const uint32 PwrEdrxMs[16] = {5120, 10240, 20480, 40960, 61440, 81920, 102400, 122880,
+	143360, 163840, 327680, 655360, 1310720, 2621440, 5242880, 10485760};
+//Codes NB-S1 takes by bit, 2, 3, 5 and 9 to 15; WB-S1 takes all 16
+#define PWR_EDRX_NBS1	0xFE2C
+//GPRS timer 3 (T3412 extended) and GPRS timer 2 (T3324) units in s by code
+static const uint32 PwrT3412s[7] = {600, 3600, 36000, 2, 30, 60, 1152000};
+static const uint32 PwrT3324s[3] = {2, 60, 360};
+
+//Bit string of a GPRS timer: the unit giving the shortest time not below s
+static void SamPwrTimer(char * sp, uint32 s, const uint32 * punit, uint8 n)
+{
+	uint32 v, best;
+	uint8 i, bu, bv;
+
+	best = 0xFFFFFFFF;
+	bu = 0;
+	bv = 31;
+	for(i = 0; i < n; i++)
+	{
+		v = (s + punit[i] - 1) / punit[i];
+		if(v > 31 || v * punit[i] >= best) continue;
+		best = v * punit[i];
+		bu = i;
+		bv = (uint8)v;
+	}
+	if(best == 0xFFFFFFFF)
+	{//longer than the timer, its longest value
+		for(i = 1; i < n; i++) if(punit[i] > punit[bu]) bu = i;
+	}
+	v = ((uint32)bu << 5) | bv;
+	for(i = 0; i < 8; i++) sp[i] = (v & (0x80 >> i)) ? '1' : '0';
+	sp[8] = 0;
+}
+
+//Code of the longest cycle the access technology takes not above ms, else its shortest
+static uint8 SamPwrEdrxCode(uint32 ms, uint8 rat)
+{
+	uint16 ok = (rat == NBIOT_MDMRAT) ? PWR_EDRX_NBS1 : 0xFFFF;
+	uint8 i;
+	for(i = 15; i > 0 && (PwrEdrxMs[i] > ms || (ok & (1 << i)) == 0); i--);
+	if((ok & (1 << i)) == 0)
+	{
+		for(i = 0; (ok & (1 << i)) == 0; i++);
+	}
+	return(i);
+}
+
+//One more send keeps the radio connected SAM_PWR_TAIL_MS from now, overlapping periods merge
+static void SamPwrBusy(uint32 * pend, uint32 * pms, uint32 * pwake, uint32 now)
+{
+	if((int32)(now - *pend) >= 0)
+	{
+		*pms += SAM_PWR_TAIL_MS;
+		(*pwake)++;
+	}
+	else
+	{
+		*pms += now + SAM_PWR_TAIL_MS - *pend;
+	}
+	*pend = now + SAM_PWR_TAIL_MS;
+}
+
+//Next scheduled wake from now: the radio sleeps at aend and wakes every cycle, none without a cycle
+static uint32 SamPwrWake(SamPwrTag * p, uint32 now)
+{
+	uint32 k;
+	if((int32)(now - p->aend) < 0) return(now);	//still connected
+	if(p->cycle == 0) return(now + p->win);
+	k = (now - p->aend + p->cycle - 1) / p->cycle;
+	return(p->aend + k * p->cycle);
+}
+
+static void SamPwrOpen(SamPwrTag * p, uint32 now)
+{
+	if(p->open != 0) return;
+	p->open = 1;
+	p->tuse = now;
+	p->stat.batches++;
+	if(p->items != 0)
+	{
+		if(now - p->t0 > p->stat.holdms) p->stat.holdms = now - p->t0;
+		DebugTrace("PWR batch of %u sends after %ums\r\n", p->items, now - p->t0);
+	}
+	p->items = 0;
+	p->bytes = 0;
+	SamDeadlineNote(0);
+}
+
+static void SamPwrHold(SamPwrTag * p, uint32 len)
+{
+	uint32 now = SamTmrNow();
+	if(p->items == 0)
+	{
+		p->t0 = now;
+		p->twake = SamPwrWake(p, now);
+	}
+	if(p->items < 0xFF) p->items++;
+	p->bytes += len;
+	if(p->items >= SAM_PWR_BATCH_MAX || p->bytes >= SAM_PWR_BATCH_BYTES) SamPwrOpen(p, now);
+}
+
+static void SamPwrCheck(SamPwrTag * p)
+{
+	uint32 now, due;
+
+	now = SamTmrNow();
+	if(p->open != 0)
+	{
+		if(now - p->tuse < SAM_PWR_IDLE_MS)
+		{
+			SamDeadlineNote(SAM_PWR_IDLE_MS - (now - p->tuse));
+			return;
+		}
+		p->open = 0;
+		DebugTrace("PWR radio %ums, %ums one by one\r\n", p->stat.radioms, p->stat.vradioms);
+	}
+	if(p->items == 0) return;
+	due = p->t0 + p->win;
+	if((int32)(p->twake - due) < 0) due = p->twake;
+	if((int32)(now - due) >= 0)
+	{
+		SamPwrOpen(p, now);
+	}
+	else
+	{
+		SamDeadlineNote(due - now);
+	}
+}
+
+void SamPwrCfg(uint32 tau, uint32 act, uint32 edrx, uint32 win)
+{
+	SamPwrTag * p = &(SamCtxCur()->pwr);
+
+	p->tau = tau;
+	p->act = act;
+	p->edrx = (edrx != 0) ? PwrEdrxMs[SamPwrEdrxCode(edrx, NONE_MDMRAT)] : 0;
+	p->win = win;
+	p->cycle = (p->edrx != 0) ? p->edrx : tau * 1000;
+	p->open = (win == 0) ? 1 : 0;
+	p->items = 0;
+	p->bytes = 0;
+	if(p->stat.sends == 0) p->aend = p->vend = SamTmrNow();
+}
+
+uint8 SamPwrAtCmd(char * buf, uint8 rat)
+{
+	SamPwrTag * p = &(SamCtxCur()->pwr);
+	char t3412[9], t3324[9];
+	uint8 c;
+
+	buf[0] = 0;
+	if(p->tau != 0)
+	{
+		SamPwrTimer(t3412, p->tau, PwrT3412s, 7);
+		SamPwrTimer(t3324, p->act, PwrT3324s, 3);
+		sprintf(buf, "AT+CPSMS=1,,,\"%s\",\"%s\"\r", t3412, t3324);
+	}
+	if(p->edrx != 0)
+	{//AcT 5: NB-S1, 4: WB-S1; the cycle as NB-S1 rounds it also times the wakes
+		c = SamPwrEdrxCode(p->edrx, rat);
+		p->edrx = PwrEdrxMs[c];
+		if(p->cycle != 0) p->cycle = p->edrx;
+		sprintf(buf + strlen(buf), "AT+CEDRXS=1,%u,\"%u%u%u%u\"\r", (rat == NBIOT_MDMRAT) ? 5 : 4,
+			(c >> 3) & 1, (c >> 2) & 1, (c >> 1) & 1, c & 1);
+	}
+	return((buf[0] != 0) ? RETCHAR_TRUE : RETCHAR_FALSE);
+}
+
+void SamPwrCycleOff(void)
+{
+	SamPwrTag * p = &(SamCtxCur()->pwr);
+	p->cycle = 0;
+	if(p->items != 0) p->twake = p->t0 + p->win;
+}
+
+void SamPwrTxAdd(uint32 len)
+{
+	SamPwrTag * p = &(SamCtxCur()->pwr);
+	uint32 now;
+
+	if(p->win == 0) return;
+	now = SamTmrNow();
+	p->stat.sends++;
+	SamPwrBusy(&(p->vend), &(p->stat.vradioms), &(p->stat.vwakes), now);
+	if(p->open == 0) SamPwrHold(p, len);
+}
+
+uint8 SamPwrTxGate(void)
+{
+	SamPwrTag * p = &(SamCtxCur()->pwr);
+
+	if(p->win == 0) return(RETCHAR_TRUE);
+	if(p->open == 0 && p->items == 0) SamPwrHold(p, 0);	//queued while the window was open or before the configuration
+	SamPwrCheck(p);
+	if(p->open == 0) return(RETCHAR_FALSE);
+	p->tuse = SamTmrNow();
+	SamPwrBusy(&(p->aend), &(p->stat.radioms), &(p->stat.wakes), p->tuse);
+	return(RETCHAR_TRUE);
+}
+
+void SamPwrTxFlush(void)
+{
+	SamPwrTag * p = &(SamCtxCur()->pwr);
+	if(p->win != 0) SamPwrOpen(p, SamTmrNow());
+}
+
+void SamPwrProc(void)
+{
+	SamPwrTag * p = &(SamCtxCur()->pwr);
+	if(p->win != 0) SamPwrCheck(p);
+}
+
+uint8 SamPwrStatGet(SamPwrStatTag * pstat)
+{
+	SamPwrTag * p = &(SamCtxCur()->pwr);
+	if(pstat == NULL) return(RETCHAR_FALSE);
+	memcpy(pstat, &(p->stat), sizeof(SamPwrStatTag));
+	return((p->win != 0) ? RETCHAR_TRUE : RETCHAR_FALSE);
+}
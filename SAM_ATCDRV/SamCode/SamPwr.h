@@ -0,0 +1,143 @@
+/**
+ * @file 	SamPwr.h
+ * @brief   PSM/eDRX power saving and uplink batching
+ * @details Builds the AT+CPSMS and AT+CEDRXS commands of the modem configuration and
+ *			holds the sends of the functional blocks in a bounded batch window, so a
+ *			device sending small data often wakes the radio once per batch. The batch
+ *			goes out at the next scheduled wake of the module, when it fills or when
+ *			its oldest send waited the window. Radio time is modelled on the wheel
+ *			time for the batched sends and for the same sends one by one.
+ *
+ * @version 1.0.0
+ * @date 	2025-08-01
+ * @author 	Alex <fanbing.kong@sunseaaiot.com>
+ * @copyright Copyright (c) 2025, SIMCom Wireless Solutions Limited. All rights reserved.
+ *
+ * @note
+ *		Units call SamPwrTxAdd when the application queues a send and SamPwrTxGate
+ *		before they start sending. Without a window every send goes out at once.
+ *		All times come from SamTmrNow, so a host with a virtual GetSysTickCnt gets
+ *		the same batches and statistics on every run.
+ *
+ */
+
+//---------------------------------------------------------------------------
+#ifndef __SAMPWR_H
+#define __SAMPWR_H
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//Radio time statistics, see SamPwrStatGet
+typedef struct{
+	uint32	sends;		//sends queued
+	uint32	batches;	//batches let out
+	uint32	wakes;		//radio activity periods with batching
+	uint32	vwakes;		//the same sends one by one
+	uint32	radioms;	//radio connected time with batching
+	uint32	vradioms;	//the same sends one by one
+	uint32	holdms;		//longest time a send was held
+}SamPwrStatTag;
+
+typedef struct{
+	uint32	tau;		//periodic TAU in s, 0: no PSM
+	uint32	act;		//PSM active time in s
+	uint32	edrx;		//eDRX cycle in ms, 0: no eDRX
+	uint32	win;		//longest hold of a send in ms, 0: no batching
+	uint32	cycle;		//period of the scheduled wakes in ms, 0: none
+
+	uint8	open;		//sends go out
+	uint8	items;		//sends held in the batch
+	uint32	bytes;
+	uint32	t0;			//wheel time of the first held send
+	uint32	twake;		//scheduled wake the batch waits for
+	uint32	tuse;		//last send let out
+	uint32	aend;		//end of the radio activity with batching
+	uint32	vend;		//the same sends one by one
+	SamPwrStatTag stat;
+}SamPwrTag;
+
+
+/**
+ * @brief Set up power saving and batching of the current context.
+ *
+ * The values come from the CFGMDM_PWRCFG field of the modem configuration. The eDRX
+ * cycle is rounded down to a 3GPP value, TAU and active time up to a GPRS timer value.
+ *
+ * @param tau Periodic TAU in s, 0: no PSM.
+ * @param act PSM active time in s.
+ * @param edrx eDRX cycle in ms, 0: no eDRX.
+ * @param win Longest hold of a send in ms, 0: sends go out at once.
+ */
+extern void SamPwrCfg(uint32 tau, uint32 act, uint32 edrx, uint32 win);
+
+/**
+ * @brief Build the PSM and eDRX commands of the configuration.
+ *
+ * NB-S1 takes fewer eDRX cycles than WB-S1: on NB-IoT the cycle is rounded down to one
+ * it takes, 20.48 s at least, and the scheduled wakes follow it.
+ *
+ * @param buf Receives the commands, 64 bytes at least.
+ * @param rat .rat of TMdmRadioTag, selects the eDRX access technology.
+ * @return RETCHAR_TRUE if there is a command, RETCHAR_FALSE otherwise.
+ */
+extern uint8 SamPwrAtCmd(char * buf, uint8 rat);
+
+/**
+ * @brief Drop the scheduled wakes, e.g. when the modem refused the PSM or eDRX setup.
+ *
+ * Held sends then wait for the batch window only.
+ */
+extern void SamPwrCycleOff(void);
+
+/**
+ * @brief Note a send queued by the application.
+ *
+ * @param len Bytes of the send, 0 for a unit request, e.g. the modem status poll.
+ */
+extern void SamPwrTxAdd(uint32 len);
+
+/**
+ * @brief Check whether a unit may start sending now.
+ *
+ * Opens the batch when it is due and keeps it open while units keep sending, until
+ * SAM_PWR_IDLE_MS pass without a send.
+ *
+ * @return RETCHAR_TRUE to send, RETCHAR_FALSE to keep holding.
+ */
+extern uint8 SamPwrTxGate(void);
+
+/**
+ * @brief Let the batch out at once, e.g. when a unit buffer runs full.
+ */
+extern void SamPwrTxFlush(void);
+
+/**
+ * @brief Run the batch window, called once per modem pass.
+ */
+extern void SamPwrProc(void);
+
+/**
+ * @brief Read the radio time statistics.
+ *
+ * Every send let out keeps the radio connected SAM_PWR_TAIL_MS, overlapping periods
+ * merge. vradioms - radioms is the radio time saved by batching.
+ *
+ * @param pstat Receives the statistics.
+ * @return RETCHAR_TRUE if batching is on, RETCHAR_FALSE otherwise.
+ */
+extern uint8 SamPwrStatGet(SamPwrStatTag * pstat);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
+/*****************************************************************************
+**                            End Of File
+******************************************************************************/
@@ -31,6 +31,12 @@
 /** Forward declaration of URC callback */
 unsigned char sam_sms_urc_cb(void *pvsms, char *urcstr);
 
+static StrsSetTag sms_cpms_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CPMS:\t+CMS ERROR:");
+static StrsSetTag sms_cms_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CMS ERROR:");
+static StrsSetTag sms_cmgs_rsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CMGS:\t+CMS ERROR:\t> ");
+static StrsSetTag sms_cmgr_rsp = STRSSET_DEF("OK\r\n\t+CMGR:\t+CMS ERROR:");
+static StrsSetTag sms_urc_set = STRSSET_DEF("+CMTI:");
+
 /**
  * @brief Initialize SMS context with configuration parameters
  * 
@@ -153,8 +159,10 @@ void * sam_sms_init(TSmsTag * psms, char * cfgstr)
 	psms->init_fail_cont = 0;
 	psms->send_fail_cont = 0;
 	
-	psms->msclk = SamGetMsCnt(0);
+	psms->stmr = SamTmrStart(0, 1000, 1000);
 	psms->runlink =	SamAtcFunLink(psms->phatc, psms, sam_sms_proc, sam_sms_urc_cb);
+	SamAtcFunPrio(psms->phatc, psms->runlink, LOW_FUNPRIO, 0);
+	SamAtcUrcLink(psms->phatc, psms->runlink, "+CMTI:");
 	psms->receive_data_cb = NULL;
 
   //	DebugTrace("@%s: Runlink=%u, DataPoint=%p\r\n", __FUNCTION__, pscm->runlink, pscm);
@@ -177,6 +185,8 @@ unsigned char sam_sms_stop(void * psms)
 	if(psms == NULL) return(0);
 	tpSms = (TSmsTag *)psms;
 	SamAtcFunUnlink(tpSms->phatc, tpSms->runlink);
+	SamTmrStop(tpSms->stmr);
+	tpSms->stmr = 0;
     sam_sms_context_release(&tpSms->sms_context);
 	return('1');
 }
@@ -224,7 +234,7 @@ unsigned char sam_sms_urc_cb(void * pvscm, char * urcstr)
         return RETCHAR_NONE;
     
     // Check for "+CMTI" URC (new message notification)
-    temp = StrsCmp(urcstr, "+CMTI:");
+    temp = StrsSetCmp(urcstr, &sms_urc_set);
 	//SAM_DBG_MODULE(SAM_MOD_SMS, SAM_DBG_LEVEL_DEBUG, "sam_sms_urc_cb:### temp == %u \r\n", temp);
 	//SAM_DBG_MODULE(SAM_MOD_SMS, SAM_DBG_LEVEL_DEBUG, "sam_sms_urc_cb:### urcstr == %s \r\n", urcstr);
 	if(temp == 1)
@@ -334,8 +344,8 @@ send_msg_node_t *sam_insert_new_send_data_into_list(send_msg_list_t *plist, char
     
     newNode->send_sms_data.language = (language == LANG_NONE) ? LANG_DEFAULT : language;
 
-    // Copy content (add 0x1A as SMS termination)
-    size_t content_len = 1 + strlen(p_content);
+    // Copy content, the 0x1A terminator is sent as a separate fragment at the prompt
+    size_t content_len = strlen(p_content);
     newNode->send_sms_data.content = (char *)malloc(content_len + 1);
     if (newNode->send_sms_data.content == NULL) {
         free(newNode);
@@ -346,7 +356,6 @@ send_msg_node_t *sam_insert_new_send_data_into_list(send_msg_list_t *plist, char
 	
 	memset(newNode->send_sms_data.content, 0, content_len + 1);
     strcpy(newNode->send_sms_data.content, p_content);
-    newNode->send_sms_data.content[content_len - 1] = 0x1A;  // SMS end marker
     newNode->send_sms_data.length = content_len;
 
     // Copy recipient number
@@ -393,8 +402,8 @@ unsigned char sam_sms_proc(void * pvsms)
 	//uint8 i, j, ratcret;
 	uint8 ratcret;
 	//uint32 clk, n, m;
-	uint32 clk;
 	char buf[256] = {0};
+	SamIovTag sms_iov[2];
 	//char str[256] = {0};
 	//char tempchar;
 
@@ -411,13 +420,7 @@ unsigned char sam_sms_proc(void * pvsms)
     pSmsCtxt = &psms->sms_context;
 
     // Update second-level timer
-	clk = SamGetMsCnt(psms->msclk);
-	while(clk >= 1000)
-	{
-		psms->msclk +=1000;
-		psms->stim += 1;
-		clk -= 1000;
-	}
+	psms->stim += SamTmrPeriod(&(psms->stmr), 1000);
 	
     // State machine processing
 	switch(psms->sta)
@@ -426,7 +429,7 @@ unsigned char sam_sms_proc(void * pvsms)
             // Initialize SMS service center address (CSCA)
             if(psms->step == SMS_INIT_STEP_CSCA && psms->stim >= 1)
 			{
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) phatc->retbufp = 0;
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) phatc->retbufp = 0;
 
                 memset(buf, 0, sizeof(buf));
                 sprintf(buf, "AT+CSCA=\"%s\"\r", pSmsCtxt->sms_cfg.sms_center);
@@ -439,7 +442,7 @@ unsigned char sam_sms_proc(void * pvsms)
             // Check CSCA configuration result
 			else if(psms->step == SMS_INIT_STEP_CSCA_RES_CHECK && psms->stim >= 1)
 			{
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(phatc, &AtcOkErrSet);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -500,7 +503,7 @@ unsigned char sam_sms_proc(void * pvsms)
             }
             else if(psms->step == SMS_INIT_STEP_CPMS_RES_CHECK)
             {
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CPMS:\t+CMS ERROR:");
+				ratcret = SamChkAtcSet(phatc, &sms_cpms_rsp);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -559,7 +562,7 @@ unsigned char sam_sms_proc(void * pvsms)
             }
 			else if(psms->step == SMS_INIT_STEP_CMGF_RES_CHECK)
 			{
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(phatc, &AtcOkErrSet);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -612,7 +615,7 @@ unsigned char sam_sms_proc(void * pvsms)
 			}
 			else if(psms->step == SMS_INIT_STEP_CNMI_RES_CHECK)
 			{
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMS ERROR:");
+				ratcret = SamChkAtcSet(phatc, &sms_cms_rsp);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -663,7 +666,7 @@ unsigned char sam_sms_proc(void * pvsms)
 		case SMS_STATUS_DATA_PROCESS :
 			if(psms->step == SMS_DATAPROC_STEP_CSCS && psms->stim > 1)
 			{
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) phatc->retbufp = 0;
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) phatc->retbufp = 0;
                 
                 if(pSmsCtxt->send_msg_list.send_sms_head != NULL && pSmsCtxt->send_msg_list.length > 0)
                 {
@@ -693,9 +696,13 @@ unsigned char sam_sms_proc(void * pvsms)
                     psms->sta = SMS_STATUS_IDLE;
                 }
 			}
+			else if(psms->step == SMS_DATAPROC_STEP_CSCS && SamAtcFunYield(phatc) == RETCHAR_TRUE)
+			{//pause between two messages, nothing in flight
+				return(RETCHAR_FREE);
+			}
 			else if(psms->step == SMS_DATAPROC_STEP_CSCS_RES_CHECK)
 			{
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(phatc, &AtcOkErrSet);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -746,7 +753,7 @@ unsigned char sam_sms_proc(void * pvsms)
             }
             else if(psms->step == SMS_DATAPROC_STEP_CSMP_RES_CHECK)
             {
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMS ERROR:");
+				ratcret = SamChkAtcSet(phatc, &sms_cms_rsp);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -780,13 +787,16 @@ unsigned char sam_sms_proc(void * pvsms)
                 {
                     send_msg_node_t *pCurMsgNode = sam_get_current_send_sms_node(&pSmsCtxt->send_msg_list);
 					
+					sms_iov[0].dp = pCurMsgNode->send_sms_data.content;
+					sms_iov[0].len = pCurMsgNode->send_sms_data.length;
+					sms_iov[1].dp = "\x1A";	// SMS end marker
+					sms_iov[1].len = 1;
+					SamAtcSetDataV(phatc, sms_iov, 2);
 					sprintf(buf, "AT+CMGS=\"%s\"\r", pCurMsgNode->send_sms_data.num);
 					SamSendAtCmd(phatc, buf, (CRLF_HATCTYP|RISP_HATCTYP), 9);
 					psms->step = SMS_DATAPROC_STEP_CMGS_RES_CHECK;
-					phatc->databuf = pCurMsgNode->send_sms_data.content;
-				    phatc->databufp = pCurMsgNode->send_sms_data.length;
-					SAM_DBG_MODULE(SAM_MOD_SMS, SAM_DBG_LEVEL_INFO, ">>>CMGS send ctx==%s\r\n", phatc->databuf);
-					SAM_DBG_MODULE(SAM_MOD_SMS, SAM_DBG_LEVEL_INFO, ">>>CMGS send length==%u\r\n", phatc->databufp);
+					SAM_DBG_MODULE(SAM_MOD_SMS, SAM_DBG_LEVEL_INFO, ">>>CMGS send ctx==%s\r\n", sms_iov[0].dp);
+					SAM_DBG_MODULE(SAM_MOD_SMS, SAM_DBG_LEVEL_INFO, ">>>CMGS send length==%u\r\n", sms_iov[0].len + 1);
 
 #if 0
 					if(pCurMsgNode->send_sms_data.language == LANG_EN)
@@ -827,7 +837,7 @@ unsigned char sam_sms_proc(void * pvsms)
             }
             else if(psms->step == SMS_DATAPROC_STEP_CMGS_RES_CHECK)
             {
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n\t+CMGS:\t+CMS ERROR:\t> ");
+				ratcret = SamChkAtcSet(phatc, &sms_cmgs_rsp);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -897,7 +907,7 @@ unsigned char sam_sms_proc(void * pvsms)
 			else if(psms->step == SMS_DATAPROC_STEP_CMGR_RES_CHECK)
 			{
 				pSmsCtxt->readIndex = -1;
-				ratcret = SamChkAtcRet(phatc, "OK\r\n\t+CMGR:\t+CMS ERROR:");
+				ratcret = SamChkAtcSet(phatc, &sms_cmgr_rsp);
 				if(ratcret == NOSTRRET_ATCRET)
 				{
                 	return(RETCHAR_KEEP);
@@ -958,7 +968,7 @@ unsigned char sam_sms_proc(void * pvsms)
 			break;
 		case SMS_STATUS_IDLE:
             {
-			while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) phatc->retbufp = 0;
+			while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) phatc->retbufp = 0;
             
             if( (pSmsCtxt->send_msg_list.send_sms_head != NULL && pSmsCtxt->send_msg_list.length > 0) || (pSmsCtxt->readIndex != -1)) 
 			{
@@ -978,7 +988,7 @@ unsigned char sam_sms_proc(void * pvsms)
 			break;
 		case SMS_STATUS_FAIL:
             {
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) phatc->retbufp = 0;
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) phatc->retbufp = 0;
 				switch(psms->fail_type)
 				{
 					case SMS_FAIL_TYPE_CSCA_FAIL:
@@ -1090,6 +1100,7 @@ uint8 sam_sms_send_message(TSmsTag * psms, char *p_content, char *p_num, Encodin
     if(NULL != pNode)
     {
         SAM_DBG_MODULE(SAM_MOD_SMS, SAM_DBG_LEVEL_INFO, ">>>sam_sms_send_message success!!  list lenth == %u\r\n",psms->sms_context.send_msg_list.length);
+        SamDeadlineNote(0);
         res = 1;
     }
     else
@@ -204,7 +204,7 @@ typedef struct TSmsTag {
     sms_option_step_type step;           /**< Current step in the state machine */
     uint8 dcnt;                       /**< Retry counter for failed operations */
     uint8 runlink;                    /**< Link identifier for AT command processing */
-    uint32 msclk;                      /**< Timestamp for timing operations */
+    SamTmrId stmr;                     /**< Second tick timer */
     uint8 stim;                       /**< Second-level timer for state transitions */
     HdsAtcTag *phatc;                   /**< Pointer to AT command channel */
     sms_context_t sms_context;           /**< SMS context (configuration and queues) */
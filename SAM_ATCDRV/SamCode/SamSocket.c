@@ -26,6 +26,16 @@
 #define Sam_Mdm_Atc_checkAtRsp SamChkAtcRet
 #define Sam_Mdm_Atc_sendAtCmd SamSendAtCmd
 #define Sam_Mdm_Atc_sendAtSeg SamSendAtSeg
+#define Sam_Mdm_Atc_checkAtSet SamChkAtcSet
+#define Sam_Mdm_Atc_setDataV SamAtcSetDataV
+
+static StrsSetTag netOpenRsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+NETOPEN:");
+static StrsSetTag netCloseRsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+NETOPEN:\t+NETCLOSE\t+IPCLOSE\t+CIPCLOSE");
+static StrsSetTag cipOpenRsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CIPOPEN:");
+static StrsSetTag cipSendRsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CIPSEND:\t>");
+static StrsSetTag rxLenRsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CIPRXGET: 4");
+static StrsSetTag rxGetRsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CIPRXGET:");
+static StrsSetTag cipCloseRsp = STRSSET_DEF("OK\r\n\tERROR\r\n\t+CIPCLOSE:\t+SERVERSTOP:");
 
 /**
  * @brief Transfer the state of the socket module.
@@ -34,6 +44,21 @@
  */
 static void stateTransfer(struct Sam_Mdm_Socket_t *self, uint8_t stat);
 
+/**
+ * @brief Declare the URC prefixes owned by the socket on its AT channel.
+ * @param self Pointer to the socket module instance.
+ */
+static void regAtUrc(struct Sam_Mdm_Socket_t *self);
+
+/**
+ * @brief Collect the data read by AT+CIPRXGET=2/3 and pass it to the data callback.
+ * @param context Pointer to the socket module instance.
+ * @param dp Pointer to the received span, NULL if the data was cut short.
+ * @param len Number of bytes in the span.
+ * @param rest Number of bytes still to come.
+ */
+static void handleRxData(void* context, char* dp, uint16 len, uint16 rest);
+
 /**
  * @brief Handle the unsolicited result code (URC) from the AT command.
  * @param context Pointer to the context, usually the socket module instance.
@@ -51,19 +76,6 @@ static char *Sam_Mdm_Atc_getRevBuff(Sam_Mdm_Atc_t *phatc) {
     return phatc->retbuf;
 }
 
-static uint16_t Sam_Mdm_Atc_getRevBuffLen(Sam_Mdm_Atc_t *phatc) {
-    return phatc->retbufp;
-}
-
-static void Sam_Mdm_Atc_SetData(Sam_Mdm_Atc_t *phatc, char * databuf, uint16_t databufp) {
-    phatc->databuf = databuf;
-    phatc->databufp = databufp;
-}
-
-static void Sam_Mdm_Atc_SetType(Sam_Mdm_Atc_t *phatc, uint8_t  type) {
-    phatc->type = type;
-}
-
 
 static void Sam_Mdm_Atc_clearAtRevBuff(Sam_Mdm_Atc_t* self) {
     if (self == NULL)
@@ -139,11 +151,13 @@ bool Sam_Mdm_Socket_init(struct Sam_Mdm_Socket_t* self, const char * cfgstr) {
     self->base.state = 0;  
     self->base.step = 0;   
     self->base.dcnt = 0;
-    self->base.msclk = SamGetMsCnt(0);
+    self->base.stmr = SamTmrStart(self->base.stmr, 1000, 1000);  // rearm the timer of Create, 0 takes one
     self->base.sclk = 0;
     self->phatc = pAtcBusArray[self->config.atChannelId];
 	    
     self->runlink =	SamAtcFunLink(self->phatc, self, (SamMdmFunTag)Sam_Mdm_Socket_process, (SamUrcBcFunTag)handleAtUrc);
+    SamAtcFunPrio(self->phatc, self->runlink, RT_FUNPRIO, SAM_SOCKET_BUDMS);
+    regAtUrc(self);
     SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_TRACE, "Socket module initialized. runlink = %d\r\n", self->runlink);
 
 //    if (self->config.socketId >= MAX_SOCKET_NUM) 
@@ -188,7 +202,6 @@ static uint8_t handleAtUrc(void* context, char* urcBuff){
     }
     
     Sam_Mdm_Socket_t *self = (Sam_Mdm_Socket_t *)context;
-    char buf[256] = {0};
     uint8_t temp = 0;
 
     // Log the URC handling information
@@ -197,9 +210,8 @@ static uint8_t handleAtUrc(void* context, char* urcBuff){
     else
         SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_DEBUG, "\r\n===========>Socket[%d] handleAtUrc %s\r\n", self->config.socketId, urcBuff);
     
-    // Construct the comparison string
-    sprintf(buf, "+CIPRXGET: 1,%u\r\t+IPCLOSE: %u\t+CLIENT: ", self->config.socketId, self->config.socketId);
-    temp = StrsCmp(urcBuff, buf);
+    // Compiled once by regAtUrc when the socket is linked to its channel
+    temp = StrsSetCmp(urcBuff, &self->urcSet);
 
     if (temp != 0)
     {
@@ -273,6 +285,56 @@ static uint8_t handleAtUrc(void* context, char* urcBuff){
     return temp;
 }
 
+/**
+ * @brief Declare the URC prefixes owned by the socket and build its URC pattern set.
+ * @param self Pointer to the socket module instance, already linked to its AT channel.
+ */
+static void regAtUrc(struct Sam_Mdm_Socket_t *self){
+    char prefix[24];
+
+    sprintf(self->urcPat, "+CIPRXGET: 1,%u\r\t+IPCLOSE: %u\t+CLIENT: ", self->config.socketId, self->config.socketId);
+    StrsSetInit(&self->urcSet, self->urcPat);
+
+    sprintf(prefix, "+CIPRXGET: 1,%u\r", self->config.socketId);
+    SamAtcUrcLink(self->phatc, self->runlink, prefix);
+    sprintf(prefix, "+IPCLOSE: %u", self->config.socketId);
+    SamAtcUrcLink(self->phatc, self->runlink, prefix);
+    SamAtcUrcLink(self->phatc, self->runlink, "+CLIENT: ");
+
+    sprintf(prefix, "+CIPRXGET: %u,%u,", (self->config.rxform == SAM_MDM_SOCKET_RXFORM_ASCII) ? 2 : 3, self->config.socketId);
+    SamAtcBinLink(self->phatc, self->runlink, &self->rxRule, prefix, 0, handleRxData, self);
+}
+
+static void handleRxData(void* context, char* dp, uint16 len, uint16 rest){
+    struct Sam_Mdm_Socket_t *self = (struct Sam_Mdm_Socket_t *)context;
+
+    if (len == 0 && rest == 0)
+    {
+        // a zero length read, nothing arrived and no payload in progress is touched
+        return;
+    }
+    if (dp == NULL)
+    {
+        SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_WARN, "socket[%d] received data cut short, %d lost\r\n", self->config.socketId, rest);
+        self->dncnt = 0;
+        return;
+    }
+    if (len > TSCM_DNBUFLEN - 1 - self->dncnt)
+        len = TSCM_DNBUFLEN - 1 - self->dncnt;
+    memcpy(&self->dnbuf[self->dncnt], dp, len);
+    self->dncnt += len;
+    if (rest != 0 || self->dncnt == 0)
+        return;
+
+    self->dnbuf[self->dncnt] = 0;
+    SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_INFO, "==========:%s\r\n", self->dnbuf);
+    if (self->dataCallback != NULL)
+    {
+        SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_TRACE, "Call user callback\r\n", self->dnbuf);
+        self->dataCallback(self->config.socketId, (const uint8_t*)self->dnbuf, self->dncnt, self->context);
+    }
+}
+
 /**
  * @brief Transfer the state of the socket module.
  * @param self Pointer to the socket module instance.
@@ -303,6 +365,8 @@ static void stateTransfer(struct Sam_Mdm_Socket_t *self, uint8_t stat){
     {        
         // Unlink the AT command functions and clear the socket module
         SamAtcFunUnlink(self->phatc, self->runlink);
+        SamTmrStop(self->base.stmr);
+        self->base.stmr = 0;
 //        memset(self, 0x00, sizeof(Sam_Mdm_Socket_t));
     }
     
@@ -332,7 +396,7 @@ static uint8_t handleInitState(struct Sam_Mdm_Socket_t *self) {
         case 0: {
                 if (self->base.sclk < self->openReTryCnt * 10) return RETCHAR_FREE; // open retry timer, 10s, 20s, 30s ... 
                 
-                while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
+                while(Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
 
                 Sam_Mdm_Atc_sendAtCmd(phatc, "AT+NETOPEN?\r", CRLF_HATCTYP, 10);
                 self->base.step++;
@@ -341,7 +405,7 @@ static uint8_t handleInitState(struct Sam_Mdm_Socket_t *self) {
             break;
             
         case 1: {
-                ratcret = Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n\t+NETOPEN:");
+                ratcret = Sam_Mdm_Atc_checkAtSet(phatc, &netOpenRsp);
                 if (ratcret == NOSTRRET_ATCRET)
                 {
                     // continue wait
@@ -378,14 +442,14 @@ static uint8_t handleInitState(struct Sam_Mdm_Socket_t *self) {
                         self->base.dcnt = 0;
                     }
                     Sam_Mdm_Atc_clearAtRevBuff(phatc);
-                    while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
+                    while(Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
                 }
             }
             break;
 
             
         case 2: {                
-                while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
+                while(Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
 
                 sprintf(buf, "AT+CIPMODE=%u\rAT+NETOPEN\r", self->config.cipmode);
                 Sam_Mdm_Atc_sendAtCmd(phatc, buf, CRLF_HATCTYP, 120);
@@ -395,7 +459,7 @@ static uint8_t handleInitState(struct Sam_Mdm_Socket_t *self) {
             break;
             
         case 3: {
-                ratcret = Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n\t+NETOPEN:\t+NETCLOSE\t+IPCLOSE\t+CIPCLOSE");
+                ratcret = Sam_Mdm_Atc_checkAtSet(phatc, &netCloseRsp);
                 if (ratcret == NOSTRRET_ATCRET)
                 {
                     // continue wait
@@ -475,7 +539,7 @@ static uint8_t handleOpeningState(struct Sam_Mdm_Socket_t *self) {
 
     switch (self->base.step) {
         case 0:{
-                while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
+                while(Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
 
                 if (self->config.type == SAM_MDM_SOCKET_TYPE_TCP_SERVER)
                     sprintf(buf, "AT+CIPRXGET=1\r");
@@ -488,7 +552,7 @@ static uint8_t handleOpeningState(struct Sam_Mdm_Socket_t *self) {
             break;
             
         case 1:{
-                ratcret = Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n");
+                ratcret = Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet);
                 if (ratcret == NOSTRRET_ATCRET)
                 {
                     // continue wait
@@ -528,7 +592,7 @@ static uint8_t handleOpeningState(struct Sam_Mdm_Socket_t *self) {
             break;
 
         case 2: {
-                while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
+                while(Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
 
                 if (self->config.type == SAM_MDM_SOCKET_TYPE_TCP)
                 {
@@ -550,7 +614,7 @@ static uint8_t handleOpeningState(struct Sam_Mdm_Socket_t *self) {
             break;
             
         case 3: {
-                ratcret = Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n\t+CIPOPEN:");
+                ratcret = Sam_Mdm_Atc_checkAtSet(phatc, &cipOpenRsp);
                 if (ratcret == NOSTRRET_ATCRET)
                 {
                     // continue wait
@@ -605,7 +669,7 @@ static uint8_t handleOpeningState(struct Sam_Mdm_Socket_t *self) {
                             stateTransfer(self, SAM_MDM_SOCKET_STATE_ERROR);
                         }
 
-//                        while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
+//                        while(Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
                         Sam_Mdm_Atc_freeUse(phatc);
                     }
                 }
@@ -627,11 +691,18 @@ static uint8_t handleConnectedState(struct Sam_Mdm_Socket_t *self) {
         return RETCHAR_FREE;
     }
 
-    if (self->upcnt != 0)
+    if (self->upcnt != 0 || self->uprefcnt != 0)
     {
-        SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_TRACE, "socket have %u data to send.\r\n", self->upcnt );
-        stateTransfer(self, SAM_MDM_SOCKET_STATE_SENDING);
-        return RETCHAR_KEEP;
+        if (self->closeType != 0)
+        {
+            SamPwrTxFlush();    // the held data goes out before the close
+        }
+        if (SamPwrTxGate() == RETCHAR_TRUE)
+        {
+            SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_TRACE, "socket have %u data to send.\r\n", self->upcnt + self->uprefcnt );
+            stateTransfer(self, SAM_MDM_SOCKET_STATE_SENDING);
+            return RETCHAR_KEEP;
+        }
     }
 
     if (self->dnflag)
@@ -658,6 +729,8 @@ static uint8_t handleSendingState(struct Sam_Mdm_Socket_t *self) {
     
     uint8_t ratcret = 0;
     char buf[256] = {0};
+    SamIovTag iov[2];
+    uint16_t sendlen = 0;
     Sam_Mdm_Atc_t *phatc = self->phatc;
     if (phatc == NULL)
     {
@@ -667,7 +740,7 @@ static uint8_t handleSendingState(struct Sam_Mdm_Socket_t *self) {
 
     switch (self->base.step) {
         case 0: {
-                if (self->upcnt == 0)
+                if (self->upcnt == 0 && self->uprefcnt == 0)
                 {
                     SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_TRACE, "handleSendingState nothing to send\r\n");
                     Sam_Mdm_Atc_freeUse(phatc);
@@ -675,17 +748,26 @@ static uint8_t handleSendingState(struct Sam_Mdm_Socket_t *self) {
                     return RETCHAR_FREE;
                 }
                 
-                while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
-
+                while(Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
+
+                // queued bytes first, then as much of the caller buffer as one CIPSEND takes
+                sendlen = TSCM_UPBUFLEN - self->upcnt;
+                if (sendlen > self->uprefcnt) sendlen = (uint16_t)self->uprefcnt;
+                iov[0].dp = self->upbuf;
+                iov[0].len = self->upcnt;
+                iov[1].dp = (char *)self->upref;
+                iov[1].len = sendlen;
+                sendlen += self->upcnt;
                 if (self->config.type == SAM_MDM_SOCKET_TYPE_TCP)
                 {
-                    sprintf(buf, "AT+CIPSEND=%u,%u\r", self->config.socketId, self->upcnt);
+                    sprintf(buf, "AT+CIPSEND=%u,%u\r", self->config.socketId, sendlen);
                 }
                 else if (self->config.type == SAM_MDM_SOCKET_TYPE_UDP)
                 {
-                    sprintf(buf, "AT+CIPSEND=%u,%u,\"%s\",%u\r", self->config.socketId, self->upcnt, self->config.host, self->config.port);
+                    sprintf(buf, "AT+CIPSEND=%u,%u,\"%s\",%u\r", self->config.socketId, sendlen, self->config.host, self->config.port);
                 }
-                Sam_Mdm_Atc_SetData(phatc, self->upbuf, self->upcnt);
+                Sam_Mdm_Atc_setDataV(phatc, iov, 2);
+                // fixed wait, no learned timeout: a timeout sends the same data again
                 Sam_Mdm_Atc_sendAtCmd(phatc, buf, CRLF_HATCTYP|RIGR_HATCTYP, 120);
                 self->base.step++;
                 self->base.sclk = 0;
@@ -693,7 +775,7 @@ static uint8_t handleSendingState(struct Sam_Mdm_Socket_t *self) {
             break;
             
         case 1: {
-                ratcret = Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n\t+CIPSEND:\t>");
+                ratcret = Sam_Mdm_Atc_checkAtSet(phatc, &cipSendRsp);
                 if (ratcret == NOSTRRET_ATCRET)
                 {
                     // continue wait
@@ -722,13 +804,29 @@ static uint8_t handleSendingState(struct Sam_Mdm_Socket_t *self) {
                     
                     if (cnf_len != 0)
                     {
-                        memcpy(self->upbuf, &self->upbuf[cnf_len], self->upcnt-cnf_len);
-                        self->upcnt -= cnf_len;
+                        uint32_t n = (cnf_len < self->upcnt) ? cnf_len : self->upcnt;
+                        memmove(self->upbuf, &self->upbuf[n], self->upcnt - n);
+                        self->upcnt -= n;
+                        cnf_len -= n;
+                        if (cnf_len != 0 && self->uprefcnt != 0)
+                        {
+                            if (cnf_len > self->uprefcnt) cnf_len = self->uprefcnt;
+                            self->upref += cnf_len;
+                            self->uprefcnt -= cnf_len;
+                            if (self->uprefcnt == 0)
+                            {
+                                self->upref = NULL;
+                                if (self->eventCallback != NULL)
+                                {
+                                    self->eventCallback(self->config.socketId, SAM_MDM_SOCKET_EVENT_SENT, NULL, self->context);
+                                }
+                            }
+                        }
                         self->base.step = 0;
                         self->base.sclk = 0;
                         self->base.dcnt = 0;
                         Sam_Mdm_Atc_clearAtRevBuff(phatc);
-                        while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
+                        while(Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
                     }
                 }
                 else if ((ratcret == 1) || (ratcret == 2)) // received OK or ERROR:
@@ -746,6 +844,9 @@ static uint8_t handleSendingState(struct Sam_Mdm_Socket_t *self) {
 }
 
 //  socket receiving ״̬
+// +CIPRXGET=4 and the reads end with OK, each step holds the channel until it has come:
+// the OK can arrive in a later read than the response line, and a command sent before
+// it would take it as its own result
 static uint8_t handleReceivingState(struct Sam_Mdm_Socket_t *self) {
     uint8_t ratcret = 0;
     char buf[256] = {0};
@@ -758,17 +859,18 @@ static uint8_t handleReceivingState(struct Sam_Mdm_Socket_t *self) {
 
     switch (self->base.step) {
         case 0:{
-                while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
+                while(Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
                 
+                // the length query reads nothing out, asking again after a timeout is harmless
                 sprintf(buf, "AT+CIPRXGET=4,%u\r", self->config.socketId);
-                Sam_Mdm_Atc_sendAtCmd(phatc, buf, CRLF_HATCTYP, 9);
+                Sam_Mdm_Atc_sendAtCmd(phatc, buf, CRLF_HATCTYP|ARTO_HATCTYP, 9);
                 self->base.step++;
                 self->base.sclk = 0;
             }
             break;
             
         case 1:{
-                ratcret = Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n\t+CIPRXGET: 4");
+                ratcret = Sam_Mdm_Atc_checkAtSet(phatc, &rxLenRsp);
                 if (ratcret == NOSTRRET_ATCRET)
                 {
                     // continue wait
@@ -795,11 +897,17 @@ static uint8_t handleReceivingState(struct Sam_Mdm_Socket_t *self) {
                     uint32_t link_num = 0;
                     uint32_t rest_len = 0;
                     sscanf((const char *)Sam_Mdm_Atc_getRevBuff(phatc),"+CIPRXGET: 4,%u,%u", &link_num, &rest_len);
-                    SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_INFO, "\r\nsocket[%d] received date rest %d\r\n", link_num, rest_len);
-                    if (rest_len == 0)
+                    SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_INFO, "\r\nsocket[%d] received data rest %d\r\n", link_num, rest_len);
+                    if (rest_len == 0) self->dnflag = false;
+                    Sam_Mdm_Atc_clearAtRevBuff(phatc);
+                    // hold the channel for the trailing OK, the next command must not take it
+                    return RETCHAR_KEEP;
+                }
+                else if (ratcret == 1) // received OK: act on the length reported above
+                {
+                    if (self->dnflag == false)
                     {
                         Sam_Mdm_Atc_freeUse(phatc);
-                        self->dnflag = false;
                         stateTransfer(self, SAM_MDM_SOCKET_STATE_CONNECTED);
                     }
                     else 
@@ -808,10 +916,8 @@ static uint8_t handleReceivingState(struct Sam_Mdm_Socket_t *self) {
                         self->base.sclk = 0;
                         self->base.dcnt = 0;
                     }
-                    Sam_Mdm_Atc_clearAtRevBuff(phatc);
-                    while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
                 }
-                else if ((ratcret == 1) || (ratcret == 2)) // received OK or ERROR:
+                else if (ratcret == 2) // received ERROR:
                 { 
                     // nothing to do.
                 }
@@ -820,7 +926,7 @@ static uint8_t handleReceivingState(struct Sam_Mdm_Socket_t *self) {
             break;
             
         case 2:{
-                while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
+                while(Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
 
                 uint8_t rxform = 0;
                 if (self->config.rxform == SAM_MDM_SOCKET_RXFORM_ASCII)
@@ -835,7 +941,7 @@ static uint8_t handleReceivingState(struct Sam_Mdm_Socket_t *self) {
             break;
             
         case 3:{
-                ratcret = Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n\t+CIPRXGET:");
+                ratcret = Sam_Mdm_Atc_checkAtSet(phatc, &rxGetRsp);
                 if (ratcret == NOSTRRET_ATCRET)
                 {
                     // continue wait
@@ -861,33 +967,10 @@ static uint8_t handleReceivingState(struct Sam_Mdm_Socket_t *self) {
                 {                    
                     uint32_t link_num, rest_len, rxform, datelen;
                     sscanf((const char *)Sam_Mdm_Atc_getRevBuff(phatc),"+CIPRXGET: %u,%u,%u,%u", &rxform, &link_num, &datelen, &rest_len);
-                    SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_INFO, "\r\nsocket[%d] received date %d,  rest %d\r\n", link_num, datelen, rest_len);
-                    if (datelen == 0)
-                    {
-                        self->base.step = 0;
-                        self->base.sclk = 0;
-                        self->base.dcnt = 0;
-                        Sam_Mdm_Atc_clearAtRevBuff(phatc);
-                        while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
-                    }
-                    else 
-                    {            
-                        Sam_Mdm_Atc_SetData(phatc, self->dnbuf, datelen);
-                        Sam_Mdm_Atc_SetType(phatc, BCNT_HATCTYP);
-                    }
-                }
-                else if(ratcret == RECVBCNT_ATCRET)
-                {
-                    self->dncnt = Sam_Mdm_Atc_getRevBuffLen(phatc);
-                    self->dnbuf[self->dncnt] = 0;
-                    Sam_Mdm_Atc_SetData(phatc, NULL, ATCRDATAPT_VMAX);
-                    Sam_Mdm_Atc_SetType(phatc, CRLF_HATCTYP);
-                    SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_INFO, "==========:%s\r\n", self->dnbuf);
-                    if (self->dataCallback != NULL)
-                    {
-                    	SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_TRACE, "Call user callback\r\n", self->dnbuf);
-                        self->dataCallback(self->config.socketId, (const uint8_t*)self->dnbuf, self->dncnt, self->context);
-                    }
+                    SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_INFO, "\r\nsocket[%d] received data %d,  rest %d\r\n", link_num, datelen, rest_len);
+                    // the data, if any, follows and is collected by handleRxData;
+                    // the trailing OK restarts the length query
+                    if (datelen != 0) self->dncnt = 0;
                 }
                 else if ((ratcret == 1) || (ratcret == 2)) // received OK or ERROR:
                 { 
@@ -923,7 +1006,7 @@ static uint8_t handleClosingState(struct Sam_Mdm_Socket_t *self) {
     
     switch (self->base.step) {
         case 0: {                
-                while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
+                while(Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
 
                 if (self->config.type == SAM_MDM_SOCKET_TYPE_TCP_SERVER)
                     sprintf(buf, "AT+SERVERSTOP=%u\r", self->config.srvIndex);
@@ -936,7 +1019,7 @@ static uint8_t handleClosingState(struct Sam_Mdm_Socket_t *self) {
             break;
             
         case 1: {
-                ratcret = Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n\t+CIPCLOSE:\t+SERVERSTOP:");
+                ratcret = Sam_Mdm_Atc_checkAtSet(phatc, &cipCloseRsp);
                 if (ratcret == NOSTRRET_ATCRET)
                 {
                     // continue wait
@@ -966,9 +1049,11 @@ static uint8_t handleClosingState(struct Sam_Mdm_Socket_t *self) {
                     {
                         memset(self->upbuf, 0x00, sizeof(self->upbuf));
                         memset(self->dnbuf, 0x00, sizeof(self->dnbuf));
+                        self->upref = NULL;
+                        self->uprefcnt = 0;
                         stateTransfer(self, SAM_MDM_SOCKET_STATE_CLOSED);
                         SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_TRACE, "socket self->closeType:%d.\r\n", self->closeType );
-                        while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
+                        while(Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
                         if (self->closeType == 2)
                         {
                             Sam_Mdm_Socket_Destroy(self);
@@ -986,7 +1071,7 @@ static uint8_t handleClosingState(struct Sam_Mdm_Socket_t *self) {
                     {
                         stateTransfer(self, SAM_MDM_SOCKET_STATE_CLOSED);
                         SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_TRACE, "server self->closeType:%d.\r\n", self->closeType );
-                        while(Sam_Mdm_Atc_checkAtRsp(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
+                        while(Sam_Mdm_Atc_checkAtSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) Sam_Mdm_Atc_clearAtRevBuff(phatc);
                         if (self->closeType == 2)
                         {
                             Sam_Mdm_Socket_Destroy(self);
@@ -1060,15 +1145,49 @@ uint32_t Sam_Mdm_Socket_Send(struct Sam_Mdm_Socket_t* self, const uint8_t* data,
         return 0;
     }
 
+    if (self->uprefcnt != 0)
+    {
+        return 0;   // keep the order behind the pending Sam_Mdm_Socket_SendRef buffer
+    }
+
     uint32_t send_len =0;
     send_len = self->upcnt + length > TSCM_UPBUFLEN ? (uint32_t)(TSCM_UPBUFLEN -self->upcnt) : length;
     memcpy(&self->upbuf[self->upcnt], data, send_len);
     self->upcnt += send_len;
 
     SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_INFO, "Sam_Mdm_Socket_Send %u data\r\n", send_len);
+    SamPwrTxAdd(send_len);
+    if (self->upcnt >= TSCM_UPBUFLEN / 2)
+    {
+        SamPwrTxFlush();    // do not let the batch window fill the buffer
+    }
+    SamDeadlineNote(0);
     return send_len;
 }
 
+bool Sam_Mdm_Socket_SendRef(struct Sam_Mdm_Socket_t* self, const uint8_t* data, uint32_t length) {
+    if ((self == NULL)  || (data == NULL) || (length == 0) || (self->uprefcnt != 0)) {
+        return false;
+    }
+
+    if ((self->base.state == SAM_MDM_SOCKET_STATE_CLOSED) 
+        || (self->base.state == SAM_MDM_SOCKET_STATE_OPENING) 
+        ||(self->base.state == SAM_MDM_SOCKET_STATE_ERROR)
+        ||(self->base.state == SAM_MDM_SOCKET_STATE_INIT))
+    {
+        SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_ERROR, "Sam_Mdm_Socket_SendRef error state:%d\r\n", self->base.state);
+        return false;
+    }
+
+    self->upref = data;
+    self->uprefcnt = length;
+
+    SAM_DBG_MODULE(SAM_MOD_SOCKET, SAM_DBG_LEVEL_INFO, "Sam_Mdm_Socket_SendRef %u data\r\n", length);
+    SamPwrTxAdd(length);
+    SamDeadlineNote(0);
+    return true;
+}
+
 //  socket module Ӧ
 uint8_t Sam_Mdm_Socket_process(struct Sam_Mdm_Socket_t* self) {
     if (self == NULL) {
@@ -1076,14 +1195,7 @@ uint8_t Sam_Mdm_Socket_process(struct Sam_Mdm_Socket_t* self) {
     }
 
     uint8_t result = RETCHAR_FREE;
-    uint32_t clk = 0;
-    clk = SamGetMsCnt(self->base.msclk);
-    while(clk >= 1000)
-    {
-    	self->base.msclk +=1000;
-    	self->base.sclk += 1;
-    	clk -= 1000;
-    }
+    self->base.sclk += SamTmrPeriod(&(self->base.stmr), 1000);
 
     // ݲͬ״̬
     switch (self->base.state) {
@@ -1155,7 +1267,7 @@ Sam_Mdm_Socket_t* Sam_Mdm_Socket_Create(Sam_Mdm_t* parent, const Sam_Mdm_Socket_
         
     socket->base.state = 0;  // Set initial state
     socket->base.step = 0;   // Set initial step
-    socket->base.msclk = SamGetMsCnt(0);;
+    socket->base.stmr = SamTmrStart(0, 1000, 1000);
     socket->base.sclk = 0;
     socket->base.run = Sam_Mdm_Socket_run;  // Assign the run function
 	
@@ -1200,7 +1312,7 @@ Sam_Mdm_Socket_t* Sam_Mdm_Socket_Create(const Sam_Mdm_Socket_Config_t* config) {
     socket->base.state = 0;  // Set initial state
     socket->base.step = 0;   // Set initial step
     socket->base.dcnt = 0;
-    socket->base.msclk = SamGetMsCnt(0);
+    socket->base.stmr = SamTmrStart(0, 1000, 1000);
     socket->base.sclk = 0;
     socket->base.run = Sam_Mdm_Socket_run;  // Assign the run function
     
@@ -1228,6 +1340,8 @@ Sam_Mdm_Socket_t* Sam_Mdm_Socket_Create(const Sam_Mdm_Socket_Config_t* config) {
     
         socket->phatc = pAtcBusArray[socket->config.atChannelId];    	    
         socket->runlink =	SamAtcFunLink(socket->phatc, socket, (SamMdmFunTag)Sam_Mdm_Socket_process, (SamUrcBcFunTag)handleAtUrc);
+        SamAtcFunPrio(socket->phatc, socket->runlink, RT_FUNPRIO, SAM_SOCKET_BUDMS);
+        regAtUrc(socket);
     }
     
     return socket;
@@ -1264,6 +1378,7 @@ bool Sam_Mdm_Socket_Close(struct Sam_Mdm_Socket_t* socket) {
         break;
     }
 
+    SamDeadlineNote(0);
     return true;
 }
 
@@ -1287,6 +1402,8 @@ void Sam_Mdm_Socket_Destroy(Sam_Mdm_Socket_t* socket) {
 //        parent->socket[socket->config.socketId] = NULL;
         
         SamAtcFunUnlink(socket->phatc, socket->runlink);
+        SamTmrStop(socket->base.stmr);
+        socket->base.stmr = 0;
         socket->deinit(socket);
         free(socket);
     }
@@ -104,6 +104,7 @@ typedef enum {
     SAM_MDM_SOCKET_EVENT_NONE,
     SAM_MDM_SOCKET_EVENT_ACCEPT,    // TCP server accepted a new client socket
     SAM_MDM_SOCKET_EVENT_CLOSED_PASSIVE, // Closed by remote
+    SAM_MDM_SOCKET_EVENT_SENT,      // Buffer of Sam_Mdm_Socket_SendRef fully sent
 } Sam_Mdm_Socket_Event_t;
 
 /**
@@ -129,7 +130,7 @@ typedef struct Sam_Mdm_Base_t {
     uint8_t state;  // State variable
     uint8_t step;   // Step variable    
     uint8_t dcnt;   // at resend count
-    uint32_t  msclk; // microsecond clock
+    SamTmrId  stmr;  // second tick timer
     uint8_t sclk; // second clock
     uint8_t (*run)(struct Sam_Mdm_Base_t* self);  // Function pointer for internal processing
 } Sam_Mdm_Base_t;
@@ -169,11 +170,16 @@ typedef struct Sam_Mdm_Socket_t {
     void* context;                  /**< Callback context */
 
     uint32_t urcMask;    
+    char            urcPat[48];   /**< URC patterns of this socket */
+    StrsSetTag      urcSet;       /**< Compiled urcPat */
 	
     char            upbuf[TSCM_UPBUFLEN];
     uint16_t        upcnt;
+    const uint8_t*  upref;        /**< Caller buffer sent in place, see Sam_Mdm_Socket_SendRef */
+    uint32_t        uprefcnt;
     char            dnbuf[TSCM_DNBUFLEN];
     uint16_t        dncnt;
+    AtcBinRuleTag   rxRule;       /**< +CIPRXGET: 2/3 data to dnbuf */
     bool              dnflag;
 
     uint8_t         error;
@@ -241,6 +247,20 @@ bool Sam_Mdm_Socket_setCallback(struct Sam_Mdm_Socket_t* self, Sam_Mdm_Socket_Ev
  */
 uint32_t Sam_Mdm_Socket_Send(struct Sam_Mdm_Socket_t* self, const uint8_t* data, uint32_t length);
 
+/**
+ * @brief Send a caller buffer through the socket without copying it.
+ *
+ * The buffer goes out at the CIPSEND prompt right after the data queued by
+ * Sam_Mdm_Socket_Send, straight from the caller's memory. It must stay unchanged
+ * until SAM_MDM_SOCKET_EVENT_SENT is reported. One buffer can be pending at a time,
+ * and Sam_Mdm_Socket_Send accepts nothing until it is sent.
+ * @param self Pointer to the socket module instance.
+ * @param data Data buffer to be sent.
+ * @param length Length of the data buffer.
+ * @return true if the buffer is accepted, false otherwise.
+ */
+bool Sam_Mdm_Socket_SendRef(struct Sam_Mdm_Socket_t* self, const uint8_t* data, uint32_t length);
+
 /**
  * @brief Close the socket.
  * @param socket Pointer to the socket module instance.
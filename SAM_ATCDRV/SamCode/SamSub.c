@@ -330,6 +330,125 @@ uint8 StrsCmp(char * rets, char * exps)
 }
 
 
+//Pattern sets are static and shared by the contexts of all threads: the set is built
+//aside and the compiled flag is stored with release after its fields, a reader loads
+//it with acquire before them. Once compiled a set is only written again with the same
+//values, so a reader never sees a field change
+#if defined(__GNUC__)
+#define STRSSET_BUILT_SET(p, v)	__atomic_store_n(&((p)->built), (v), __ATOMIC_RELEASE)
+#define STRSSET_BUILT_GET(p)	__atomic_load_n(&((p)->built), __ATOMIC_ACQUIRE)
+#else
+#define STRSSET_BUILT_SET(p, v)	((p)->built = (v))
+#define STRSSET_BUILT_GET(p)	((p)->built)
+#endif
+
+/**
+ * @brief Compile a tab separated list of expected strings into a pattern set.
+ *
+ * @param pset Pointer to the pattern set.
+ * @param exps The string containing multiple substrings separated by tabs.
+ */
+void StrsSetInit(StrsSetTag * pset, const char * exps)
+{
+	StrsSetTag set;
+	uint16 i, j;
+	uint8 n, k, built;
+
+	memset(&set, 0, sizeof(set));
+	set.exps = exps;
+	built = 1;
+	n = 0;
+	j = 0;
+	for(i = 0; exps != NULL && exps[0] != 0; i++)
+	{
+		if(exps[i] != '\t' && exps[i] != 0) continue;
+		if(n >= STRSSET_MAX || (i - j) > 255)
+		{//too big for the set, StrsCmp from now on
+			built = 2;
+			break;
+		}
+		set.pofs[n] = j;
+		set.plen[n] = (uint8)(i - j);
+		if(i != j)
+		{//an empty alternative never matches
+			for(k = 0; k < set.fcnt && set.fch[k] != exps[j]; k++);
+			if(k == set.fcnt)
+			{
+				set.fch[k] = exps[j];
+				set.fmsk[k] = 0;
+				set.fcnt++;
+			}
+			set.fmsk[k] |= (uint16)(1 << n);
+		}
+		n++;
+		if(exps[i] == 0) break;
+		j = i + 1;
+	}
+	set.cnt = n;
+
+	set.built = STRSSET_BUILT_GET(pset);	//unchanged until the fields are in place
+	memcpy(pset, &set, sizeof(StrsSetTag));
+	STRSSET_BUILT_SET(pset, built);
+}
+
+
+/**
+ * @brief Compare a string against a compiled pattern set, same result as StrsCmp.
+ *
+ * @param rets The string to compare against the pattern set.
+ * @param pset Pointer to the pattern set, compiled on first use if needed.
+ * @return The 1-based index of the first matching alternative, or 0 if no match.
+ */
+//all alternatives sharing the first byte of rets run in one pass over rets
+uint8 StrsSetCmp(char * rets, StrsSetTag * pset)
+{
+	uint16 alive, done, m;
+	uint8 i, k;
+
+	k = STRSSET_BUILT_GET(pset);
+	if(k == 0)
+	{
+		StrsSetInit(pset, pset->exps);
+		k = STRSSET_BUILT_GET(pset);
+	}
+	if(k != 1) return(StrsCmp(rets, (char *)pset->exps));	//not compilable, tried once only
+	if(rets[0] == 0) return(0);
+
+	alive = 0;
+	for(k = 0; k < pset->fcnt; k++)
+	{
+		if(pset->fch[k] == rets[0])
+		{
+			alive = pset->fmsk[k];
+			break;
+		}
+	}
+
+	done = 0;
+	for(i = 1; alive != 0; i++)
+	{
+		for(k = 0, m = alive; m != 0; k++, m >>= 1)
+		{
+			if((m & 0x01) == 0) continue;
+			if(pset->plen[k] == i)
+			{
+				done |= (uint16)(1 << k);
+				alive &= ~(uint16)(1 << k);
+			}
+			else if(rets[i] != pset->exps[pset->pofs[k] + i])
+			{
+				alive &= ~(uint16)(1 << k);
+			}
+		}
+		//the lowest complete alternative wins once no lower one is still running
+		if(done != 0 && (alive == 0 || (done & (~done + 1)) < (alive & (~alive + 1)))) break;
+	}
+	if(done == 0) return(0);
+	for(k = 0; (done & 0x01) == 0; k++) done >>= 1;
+	return(k + 1);
+}
+
+
 /**
  * @brief Read a configuration value from a tab-separated string.
  *
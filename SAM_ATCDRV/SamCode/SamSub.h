@@ -75,6 +75,46 @@ extern unsigned short GetPmrStr(char *ptrs, char separator, unsigned char pcnt,
  */
 extern unsigned char StrsCmp(char * rets, char * exps);
 
+#define STRSSET_MAX		16	//max alternatives in one pattern set
+
+typedef struct{
+	const char * exps;			//source list, alternatives separated by '\t' as for StrsCmp
+	uint8	cnt;				//number of alternatives
+	uint8	built;				//0: not compiled yet, 1: compiled, 2: too big, StrsCmp on exps
+	uint8	fcnt;				//number of distinct first bytes
+	char	fch[STRSSET_MAX];	//distinct first bytes
+	uint16	fmsk[STRSSET_MAX];	//alternatives starting with fch[]
+	uint16	pofs[STRSSET_MAX];	//offset of each alternative in exps
+	uint8	plen[STRSSET_MAX];	//length of each alternative
+}StrsSetTag;
+
+//static definition of a pattern set, compiled on its first use
+#define STRSSET_DEF(s)	{(s), 0, 0, 0, {0}, {0}, {0}, {0}}
+
+/**
+ * @brief Compile a tab separated list of expected strings into a pattern set.
+ *
+ * Alternatives beyond STRSSET_MAX or longer than 255 bytes mark the set as not
+ * compilable, StrsSetCmp then goes straight to StrsCmp on the source list.
+ *
+ * @param pset Pointer to the pattern set.
+ * @param exps The string containing multiple substrings separated by tabs.
+ */
+extern void StrsSetInit(StrsSetTag * pset, const char * exps);
+
+/**
+ * @brief Compare a string against a compiled pattern set.
+ *
+ * Same result as StrsCmp(rets, pset->exps): the 1-based index of the first alternative
+ * that 'rets' starts with, or 0 if none. All alternatives are matched in a single pass
+ * over 'rets', dispatched on its first byte.
+ *
+ * @param rets The string to compare against the pattern set.
+ * @param pset Pointer to the pattern set, compiled on first use if needed.
+ * @return The 1-based index of the first matching alternative, or 0 if no match.
+ */
+extern unsigned char StrsSetCmp(char * rets, StrsSetTag * pset);
+
 /**
  * @brief Read a configuration value from a tab-separated string.
  *
@@ -14,41 +14,23 @@
 #include "SamAtc.h"
 #include "SamTTS.h"
 
-#define	TTS_WRITE_BUF_LEN 512
-#define	TTS_SAVE_WAVE_FILE_NAME_LEN 64
-
-typedef struct{
-    uint8 sta;
-    uint8 step;
-    uint8 dcnt;
-    uint8 runlink; //for run link in atclink  
-    uint32 msclk;  //for recode sysclk
-    uint8 stim;    //second timer for user  
-    uint8 localOrRomote;
-    uint8 ttsSysVolSetting;
-    TTS_PLAYING_DATA_FORMAT_E dataFormat;
-    HdsAtcTag* phatc;
-    char writeBuf[TTS_WRITE_BUF_LEN];
-    uint16 writeCount;
-    char fileName[TTS_SAVE_WAVE_FILE_NAME_LEN];
-    sam_tts_callback ttsCallback;
-    sam_tts_urc_callback ttsURCCallback;
-    TTS_param_T ttsParams;
-}TTS_Tag_T;
-
-
-TTS_Tag_T mTTSTag;
-extern HdsAtcTag * pAtcBusArray[];
 static unsigned char sam_tts_proc(void *pTTSTag);
 static unsigned char sam_tts_urc_cb(void *pTTS, char *urcStr);
 
+static StrsSetTag tts_play_rsp = STRSSET_DEF("+CTTS: 0\r\n\t+CTTS: 1\r\n\tOK\r\n\tERROR\r\n");
+static StrsSetTag tts_ctts_rsp = STRSSET_DEF("+CTTS:\r\n\tOK\r\n\tERROR\r\n");
+static StrsSetTag tts_stop_rsp = STRSSET_DEF("+CTTS: 0\r\n\tOK\r\n\tERROR\r\n");
+static StrsSetTag tts_param_rsp = STRSSET_DEF("+CTTSPARAM:\tOK\r\n\tERROR\r\n");
+static StrsSetTag tts_cdtam_rsp = STRSSET_DEF("+CDTAM: 0\r\n\t+CDTAM: 1\r\n\tOK\r\n\tERROR\r\n");
+static StrsSetTag tts_volinv_rsp = STRSSET_DEF("+CTTSVOLINV: 0\r\n\t+CTTSVOLINV: 1\r\n\tOK\r\n\tERROR\r\n");
+
 /**
  * @brief Get the current status of TTS, whether it is stopped or playing TTS voice.
  * @return Returning 0 indicates successful execution and returning -1 indicates that 
  *  The TTS module is executing other tasks,please try late.
  */
 int sam_tts_get_status(void) {
-    TTS_Tag_T *pTTS = &mTTSTag;
+    TTS_Tag_T *pTTS = &(SamCtxCur()->tts);
 
     if (pTTS->sta == TTS_GET_STATUS){
         return 0;
@@ -67,7 +49,7 @@ int sam_tts_get_status(void) {
  *  The TTS module is executing other tasks,please try late.
  */
 int sam_tts_stop_playing(void) {
-    TTS_Tag_T *pTTS = &mTTSTag;
+    TTS_Tag_T *pTTS = &(SamCtxCur()->tts);
     if(pTTS->sta == TTS_STOP_PLAYING) {
         return 0;
     } else if(pTTS->sta != TTS_IDLE) {
@@ -111,7 +93,7 @@ int sam_tts_play(uint8 *pData,uint16 dataSize,TTS_PLAYING_DATA_FORMAT_E format)
  *               Please check the input parameters correctly.
  */
 int sam_tts_play_and_save_wav(uint8 *pData,uint16 dataSize,char *fileName,TTS_PLAYING_DATA_FORMAT_E format) {
-    TTS_Tag_T *pTTS = &mTTSTag;
+    TTS_Tag_T *pTTS = &(SamCtxCur()->tts);
 
     if (pTTS->sta != TTS_IDLE || pData == NULL) {
         return -1;
@@ -163,7 +145,7 @@ int sam_tts_play_and_save_wav(uint8 *pData,uint16 dataSize,char *fileName,TTS_PL
  *               Please check the input parameters correctly. 
  */
 int sam_tts_init(uint8 atcIndex,sam_tts_callback ttsCallback,sam_tts_urc_callback urcTTSCallback) {
-    TTS_Tag_T *pTTS = &mTTSTag;
+    TTS_Tag_T *pTTS = &(SamCtxCur()->tts);
 
     if(atcIndex >= ATCBUS_CHMAX) {
         return -1;
@@ -176,8 +158,9 @@ int sam_tts_init(uint8 atcIndex,sam_tts_callback ttsCallback,sam_tts_urc_callbac
     pTTS->writeCount = 0;
     pTTS->dataFormat = TTS_PLAYING_NONE_FORMAT;
     memset(pTTS->ttsParams.params,0,sizeof(pTTS->ttsParams.params));
-    pTTS->msclk = SamGetMsCnt(0);
+    pTTS->stmr = SamTmrStart(pTTS->stmr, 1000, 1000);
     pTTS->runlink =	SamAtcFunLink(pTTS->phatc, pTTS, sam_tts_proc, sam_tts_urc_cb);
+    SamAtcFunPrio(pTTS->phatc, pTTS->runlink, LOW_FUNPRIO, 0);
     pTTS->ttsCallback = ttsCallback;
     pTTS->ttsURCCallback = urcTTSCallback;
     return 0;
@@ -188,8 +171,10 @@ int sam_tts_init(uint8 atcIndex,sam_tts_callback ttsCallback,sam_tts_urc_callbac
  */
 void sam_tts_deinit(void)
 {
-	TTS_Tag_T *pTTS = &mTTSTag;
+	TTS_Tag_T *pTTS = &(SamCtxCur()->tts);
 	SamAtcFunUnlink(pTTS->phatc, pTTS->runlink);
+	SamTmrStop(pTTS->stmr);
+	pTTS->stmr = 0;
 }
 
 /**
@@ -206,7 +191,7 @@ void sam_tts_deinit(void)
  *               Please check the input parameters correctly. 
  */
 int sam_tts_set_YOUNGTONE_param(TTS_param_T *pParam){
-    TTS_Tag_T *pTTS = &mTTSTag;
+    TTS_Tag_T *pTTS = &(SamCtxCur()->tts);
 
     if(pParam == NULL) {
         return -1;
@@ -229,7 +214,7 @@ int sam_tts_set_YOUNGTONE_param(TTS_param_T *pParam){
  *  The TTS module is executing other tasks,please try late.
  */
 int sam_tts_get_YOUNGTONE_param(void){
-    TTS_Tag_T *pTTS = &mTTSTag;
+    TTS_Tag_T *pTTS = &(SamCtxCur()->tts);
     if(pTTS->sta == TTS_GET_YOUNGTONE_PARAM) {
         return 0;
     } else if(pTTS->sta != TTS_IDLE) {
@@ -255,7 +240,7 @@ int sam_tts_get_YOUNGTONE_param(void){
  *               Please check the input parameters correctly. 
  */
 int sam_tts_set_IFLY_param(TTS_param_T *pParam){
-    TTS_Tag_T *pTTS = &mTTSTag;
+    TTS_Tag_T *pTTS = &(SamCtxCur()->tts);
 
     if(pParam == NULL) {
         return -1;
@@ -278,7 +263,7 @@ int sam_tts_set_IFLY_param(TTS_param_T *pParam){
  *  The TTS module is executing other tasks,please try late.
  */
 int sam_tts_get_IFLY_param(void){
-    TTS_Tag_T *pTTS = &mTTSTag;
+    TTS_Tag_T *pTTS = &(SamCtxCur()->tts);
     if(pTTS->sta == TTS_GET_IFLY_PARAM) {
         return 0;
     } else if(pTTS->sta != TTS_IDLE) {
@@ -296,7 +281,7 @@ int sam_tts_get_IFLY_param(void){
  *  The TTS module is executing other tasks,please try late.
  */
 int sam_tts_get_local_or_remote_status(void) {
-    TTS_Tag_T *pTTS = &mTTSTag;
+    TTS_Tag_T *pTTS = &(SamCtxCur()->tts);
     if (pTTS->sta == TTS_GET_LOCAL_OR_REMOTE_PLAY) {
         return 0;
     } else if(pTTS->sta != TTS_IDLE){
@@ -315,7 +300,7 @@ int sam_tts_get_local_or_remote_status(void) {
  *  The TTS module is executing other tasks,please try late.
  */
 int sam_tts_set_local_or_remote_status(uint8 localOrRemote) {
-    TTS_Tag_T *pTTS = &mTTSTag;
+    TTS_Tag_T *pTTS = &(SamCtxCur()->tts);
     if (pTTS->sta == TTS_SET_LOCAL_OR_REMOTE_PLAY) {
         return 0;
     } else if(pTTS->sta != TTS_IDLE){
@@ -334,7 +319,7 @@ int sam_tts_set_local_or_remote_status(uint8 localOrRemote) {
  *  The TTS module is executing other tasks,please try late.
  */
 int sam_tts_get_sys_vol_setting_status(void) {
-    TTS_Tag_T *pTTS = &mTTSTag;
+    TTS_Tag_T *pTTS = &(SamCtxCur()->tts);
 
     if (pTTS->sta == TTS_GET_SYS_VOLUME_SETTING) {
         return 0;
@@ -354,7 +339,7 @@ int sam_tts_get_sys_vol_setting_status(void) {
  *  The TTS module is executing other tasks,please try late.
  */
 int sam_tts_set_sys_vol_setting(uint8 sysVolSetting) {
-    TTS_Tag_T *pTTS = &mTTSTag;
+    TTS_Tag_T *pTTS = &(SamCtxCur()->tts);
 
     if (pTTS->sta == TTS_SET_SYS_VOLUME_SETTING) {
         return 0;
@@ -371,7 +356,6 @@ int sam_tts_set_sys_vol_setting(uint8 sysVolSetting) {
 unsigned char sam_tts_proc(void *pTTSTag)
 {
 	uint8 ratcret;
-	uint32 clk;
     char value[6];
 	TTS_Tag_T * pTTS = NULL;
 	HdsAtcTag * phatc = NULL;
@@ -385,13 +369,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
         return ('E'+2);
     }
 
-	clk = SamGetMsCnt(pTTS->msclk);
-	while(clk >= 1000)
-	{
-		pTTS->msclk +=1000;
-		pTTS->stim += 1;
-		clk -= 1000;
-	}
+	pTTS->stim += SamTmrPeriod(&(pTTS->stmr), 1000);
 	
 	switch(pTTS->sta)
 	{
@@ -401,7 +379,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
 			if(pTTS->step == 0)
 			{
 			    phatc->type = CRLF_HATCTYP;
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) {
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) {
                     phatc->retbufp = 0;
                 }
                 SamSendAtCmd(pTTS->phatc, "AT+CTTS?\r\n", CRLF_HATCTYP, 80);
@@ -412,7 +390,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
 			else if(pTTS->step == 1)
 			{
 			    pTTS->phatc->type = CRLF_HATCTYP;
-				ratcret = SamChkAtcRet(pTTS->phatc, "+CTTS: 0\r\n\t+CTTS: 1\r\n\tOK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(pTTS->phatc, &tts_play_rsp);
 				if(ratcret == NOSTRRET_ATCRET) {
                 	return RETCHAR_KEEP;
 				}
@@ -452,7 +430,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
                 uint16 dataLen = 0;
 			    char data[544] = {0};
 			    phatc->type = CRLF_HATCTYP;
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) {
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) {
                     phatc->retbufp = 0;
                 }
                 if (pTTS->dataFormat == TTS_PLAYING_UCS2_FORMAT) {
@@ -492,7 +470,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
                     status = TTS_PLAY_AND_SAVE_TO_FILE;
                 }
 			    pTTS->phatc->type = CRLF_HATCTYP;
-				ratcret = SamChkAtcRet(pTTS->phatc, "+CTTS:\r\n\tOK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(pTTS->phatc, &tts_ctts_rsp);
 				if(ratcret == NOSTRRET_ATCRET) {
                 	return RETCHAR_KEEP;
 				} else if(ratcret == OVERTIME_ATCRET || ratcret == 3) {
@@ -520,7 +498,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
 			if(pTTS->step == 0)
 			{
 			    phatc->type = CRLF_HATCTYP;
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) {
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) {
                     phatc->retbufp = 0;
                 }
                 SamSendAtCmd(phatc, "AT+CTTS=0\r\n", CRLF_HATCTYP, 80);
@@ -531,7 +509,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
 			else if(pTTS->step == 1)
 			{
 			    pTTS->phatc->type = CRLF_HATCTYP;
-				ratcret = SamChkAtcRet(pTTS->phatc, "+CTTS: 0\r\n\tOK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(pTTS->phatc, &tts_stop_rsp);
 				if(ratcret == NOSTRRET_ATCRET) {
                 	return RETCHAR_KEEP;
 				}
@@ -563,7 +541,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
 			{
 			    char data[32] = {0};
 			    phatc->type = CRLF_HATCTYP;
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) {
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) {
                     phatc->retbufp = 0;
                 }
                 sprintf(data,"AT+CTTSPARAM=%u,%u,%u,%u,%u,%u\r\n" \
@@ -581,7 +559,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
 			else if(pTTS->step == 1)
 			{
 			    pTTS->phatc->type = CRLF_HATCTYP;
-				ratcret = SamChkAtcRet(pTTS->phatc, "OK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(pTTS->phatc, &AtcOkErrSet);
 				if(ratcret == NOSTRRET_ATCRET) {
                 	return RETCHAR_KEEP;
 				} else if(ratcret == OVERTIME_ATCRET || ratcret == 2) {
@@ -607,7 +585,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
             if(pTTS->step == 0)
 			{
 			    phatc->type = CRLF_HATCTYP;
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) {
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) {
                     phatc->retbufp = 0;
                 }
                 SamSendAtCmd(phatc, "AT+CTTSPARAM?\r\n", CRLF_HATCTYP, 80);
@@ -618,7 +596,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
 			else if(pTTS->step == 1)
 			{
 			    pTTS->phatc->type = CRLF_HATCTYP;
-				ratcret = SamChkAtcRet(pTTS->phatc, "+CTTSPARAM:\tOK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(pTTS->phatc, &tts_param_rsp);
 				if(ratcret == NOSTRRET_ATCRET) {
                 	return RETCHAR_KEEP;
 				} else if(ratcret == OVERTIME_ATCRET || ratcret == 3) {
@@ -656,7 +634,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
             if(pTTS->step == 0)
 			{
 			    phatc->type = CRLF_HATCTYP;
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) {
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) {
                     phatc->retbufp = 0;
                 }
                 SamSendAtCmd(pTTS->phatc, "AT+CDTAM?\r\n", CRLF_HATCTYP, 80);
@@ -667,7 +645,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
 			else if(pTTS->step == 1)
 			{
 			    pTTS->phatc->type = CRLF_HATCTYP;
-				ratcret = SamChkAtcRet(pTTS->phatc, "+CDTAM: 0\r\n\t+CDTAM: 1\r\n\tOK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(pTTS->phatc, &tts_cdtam_rsp);
 				if(ratcret == NOSTRRET_ATCRET) {
                 	return RETCHAR_KEEP;
 				}
@@ -701,7 +679,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
 			{
 			    char data[16] = {0};
 			    phatc->type = CRLF_HATCTYP;
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) {
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) {
                     phatc->retbufp = 0;
                 }
                 sprintf(data,"AT+CDTAM=%d\r\n",pTTS->localOrRomote);
@@ -713,7 +691,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
 			else if(pTTS->step == 1)
 			{
 			    pTTS->phatc->type = CRLF_HATCTYP;
-				ratcret = SamChkAtcRet(pTTS->phatc, "OK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(pTTS->phatc, &AtcOkErrSet);
 				if(ratcret == NOSTRRET_ATCRET) {
                 	return RETCHAR_KEEP;
 				}
@@ -740,7 +718,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
             if(pTTS->step == 0)
 			{
 			    phatc->type = CRLF_HATCTYP;
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) {
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) {
                     phatc->retbufp = 0;
                 }
                 SamSendAtCmd(pTTS->phatc, "AT+CTTSVOLINV?\r\n", CRLF_HATCTYP, 80);
@@ -751,7 +729,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
 			else if(pTTS->step == 1)
 			{
 			    pTTS->phatc->type = CRLF_HATCTYP;
-				ratcret = SamChkAtcRet(pTTS->phatc, "+CTTSVOLINV: 0\r\n\t+CTTSVOLINV: 1\r\n\tOK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(pTTS->phatc, &tts_volinv_rsp);
 				if(ratcret == NOSTRRET_ATCRET) {
                 	return RETCHAR_KEEP;
 				}
@@ -785,7 +763,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
 			{
 			    char data[32] = {0};
 			    phatc->type = CRLF_HATCTYP;
-				while(SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n") != NOSTRRET_ATCRET) {
+				while(SamChkAtcSet(phatc, &AtcOkErrSet) != NOSTRRET_ATCRET) {
                     phatc->retbufp = 0;
                 }
                 sprintf(data,"AT+CTTSVOLINV=%d\r\n",pTTS->ttsSysVolSetting);
@@ -797,7 +775,7 @@ unsigned char sam_tts_proc(void *pTTSTag)
 			else if(pTTS->step == 1)
 			{
 			    pTTS->phatc->type = CRLF_HATCTYP;
-				ratcret = SamChkAtcRet(pTTS->phatc, "OK\r\n\tERROR\r\n");
+				ratcret = SamChkAtcSet(pTTS->phatc, &AtcOkErrSet);
 				if(ratcret == NOSTRRET_ATCRET) {
                 	return RETCHAR_KEEP;
 				}
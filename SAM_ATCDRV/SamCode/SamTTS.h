@@ -55,6 +55,29 @@ typedef struct {
 typedef void (* sam_tts_callback)(TTS_Status_E ttsStatus,char *result);
 typedef char (* sam_tts_urc_callback)(char *urcStr);
 
+#define	TTS_WRITE_BUF_LEN 512
+#define	TTS_SAVE_WAVE_FILE_NAME_LEN 64
+
+//TTS unit state, one per SamCtx
+typedef struct{
+    uint8 sta;
+    uint8 step;
+    uint8 dcnt;
+    uint8 runlink; //for run link in atclink  
+    SamTmrId stmr;  //second tick timer
+    uint8 stim;    //second timer for user  
+    uint8 localOrRomote;
+    uint8 ttsSysVolSetting;
+    TTS_PLAYING_DATA_FORMAT_E dataFormat;
+    HdsAtcTag* phatc;
+    char writeBuf[TTS_WRITE_BUF_LEN];
+    uint16 writeCount;
+    char fileName[TTS_SAVE_WAVE_FILE_NAME_LEN];
+    sam_tts_callback ttsCallback;
+    sam_tts_urc_callback ttsURCCallback;
+    TTS_param_T ttsParams;
+}TTS_Tag_T;
+
 
 /**
  * @brief Register TTS module.
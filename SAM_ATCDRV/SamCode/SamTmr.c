@@ -0,0 +1,222 @@
+/**
+ * @file 	SamTmr.c
+ * @brief   Millisecond timers shared by the functional units
+ * @details Hierarchical timing wheel: level n slot covers 64^n ms, a timer sits in
+ *			the lowest level its remaining time fits in and moves down when the
+ *			slot above is reached (cascade). Each tick only looks at one level 0 slot.
+ *
+ * @version 1.0.0
+ * @date 	2025-08-01
+ * @author 	Alex <fanbing.kong@sunseaaiot.com>
+ * @copyright Copyright (c) 2025, SIMCom Wireless Solutions Limited. All rights reserved.
+ *
+ * @note
+ *
+ *
+ */
+//---------------------------------------------------------------------------
+
+#define __SAMTMR_C
+
+#include "SamInc.h"
+
+#define TMR_MASK	(TMR_SLOTS - 1)
+#define TMR_SPAN	((uint32)1 << (TMR_BITS * TMR_LVLS))	//range of the wheel, longer timers cascade again
+
+#define TMRSTA_FREE		0
+#define TMRSTA_IDLE		1	//taken, not running
+#define TMRSTA_RUN		2
+
+static void SamTmrLink(SamTmrWheelTag * pw, uint8 i)
+{
+	SamTmrTag * ptmr = &pw->pool[i];
+	uint32 d, t;
+	uint8 l;
+
+	t = ptmr->expire;
+	d = t - pw->now;
+	if((int32)d < 0)
+	{//due, fires on the slot being run
+		d = 0;
+		t = pw->now;
+	}
+	if(d >= TMR_SPAN) t = pw->now + TMR_SPAN - 1;
+	for(l = 0; l < TMR_LVLS - 1; l++)
+	{
+		if(d < ((uint32)1 << (TMR_BITS * (l + 1)))) break;
+	}
+	ptmr->lvl = l;
+	ptmr->slot = (t >> (TMR_BITS * l)) & TMR_MASK;
+	ptmr->prev = 0;
+	ptmr->next = pw->slot[l][ptmr->slot];
+	if(ptmr->next != 0) pw->pool[ptmr->next - 1].prev = i + 1;
+	pw->slot[l][ptmr->slot] = i + 1;
+	ptmr->sta = TMRSTA_RUN;
+	pw->run++;
+}
+
+static void SamTmrUnlink(SamTmrWheelTag * pw, uint8 i)
+{
+	SamTmrTag * ptmr = &pw->pool[i];
+	if(ptmr->sta != TMRSTA_RUN) return;
+	if(ptmr->prev != 0) pw->pool[ptmr->prev - 1].next = ptmr->next;
+	else pw->slot[ptmr->lvl][ptmr->slot] = ptmr->next;
+	if(ptmr->next != 0) pw->pool[ptmr->next - 1].prev = ptmr->prev;
+	ptmr->sta = TMRSTA_IDLE;
+	pw->run--;
+}
+
+//Move the timers of one upper slot down, they are due within its span
+static void SamTmrCascade(SamTmrWheelTag * pw, uint8 l)
+{
+	uint8 i, slot;
+	slot = (pw->now >> (TMR_BITS * l)) & TMR_MASK;
+	while((i = pw->slot[l][slot]) != 0)
+	{
+		SamTmrUnlink(pw, i - 1);
+		SamTmrLink(pw, i - 1);
+	}
+}
+
+//One ms step of the wheel
+static void SamTmrTick(SamTmrWheelTag * pw)
+{
+	uint8 i, slot;
+	SamTmrTag * ptmr;
+
+	pw->now++;
+	if((pw->now & ((1 << (TMR_BITS * 3)) - 1)) == 0) SamTmrCascade(pw, 3);
+	if((pw->now & ((1 << (TMR_BITS * 2)) - 1)) == 0) SamTmrCascade(pw, 2);
+	if((pw->now & TMR_MASK) == 0) SamTmrCascade(pw, 1);
+
+	slot = pw->now & TMR_MASK;
+	while((i = pw->slot[0][slot]) != 0)
+	{
+		ptmr = &pw->pool[i - 1];
+		SamTmrUnlink(pw, i - 1);
+		if(ptmr->fired != 0xFFFF) ptmr->fired++;
+		if(ptmr->period != 0)
+		{
+			ptmr->expire += ptmr->period;
+			SamTmrLink(pw, i - 1);
+		}
+	}
+}
+
+SamTmrId SamTmrStart(SamTmrId id, uint32 ms, uint32 period)
+{
+	SamTmrWheelTag * pw = &(SamCtxCur()->tmr);
+	uint8 i;
+	if(id == 0)
+	{
+		for(i = 0; i < SAM_TMR_NUM; i++)
+		{
+			if(pw->pool[i].sta == TMRSTA_FREE) break;
+		}
+		if(i == SAM_TMR_NUM)
+		{
+			SAM_DBG_MODULE(SAM_MOD_ATC, SAM_DBG_LEVEL_WARN, "Timer pool empty\r\n");
+			return(0);
+		}
+		id = i + 1;
+		pw->pool[i].sta = TMRSTA_IDLE;
+	}
+	else if(id > SAM_TMR_NUM || pw->pool[id - 1].sta == TMRSTA_FREE) return(0);
+
+	i = id - 1;
+	SamTmrUnlink(pw, i);
+	pw->pool[i].fired = 0;
+	pw->pool[i].period = period;
+	pw->pool[i].expire = pw->now + ((ms != 0) ? ms : 1);	//the slot of now is already run
+	SamTmrLink(pw, i);
+	return(id);
+}
+
+void SamTmrStop(SamTmrId id)
+{
+	SamTmrWheelTag * pw = &(SamCtxCur()->tmr);
+	if(id == 0 || id > SAM_TMR_NUM) return;
+	SamTmrUnlink(pw, id - 1);
+	pw->pool[id - 1].sta = TMRSTA_FREE;
+}
+
+uint16 SamTmrFired(SamTmrId id)
+{
+	SamTmrWheelTag * pw = &(SamCtxCur()->tmr);
+	uint16 n;
+	if(id == 0 || id > SAM_TMR_NUM) return(0);
+	n = pw->pool[id - 1].fired;
+	pw->pool[id - 1].fired = 0;
+	return(n);
+}
+
+uint32 SamTmrLeft(SamTmrId id)
+{
+	SamTmrWheelTag * pw = &(SamCtxCur()->tmr);
+	if(id == 0 || id > SAM_TMR_NUM || pw->pool[id - 1].sta != TMRSTA_RUN) return(0);
+	return(pw->pool[id - 1].expire - pw->now);
+}
+
+uint16 SamTmrPeriod(SamTmrId * pid, uint32 ms)
+{
+	SamTmrWheelTag * pw = &(SamCtxCur()->tmr);
+	if(*pid == 0 || *pid > SAM_TMR_NUM || pw->pool[*pid - 1].sta != TMRSTA_RUN)
+	{
+		*pid = SamTmrStart(*pid, ms, ms);
+		return(0);
+	}
+	return(SamTmrFired(*pid));
+}
+
+uint32 SamTmrNow(void)
+{
+	SamTmrWheelTag * pw = &(SamCtxCur()->tmr);
+	return(pw->now);
+}
+
+void SamTmrPoll(void)
+{
+	SamTmrWheelTag * pw = &(SamCtxCur()->tmr);
+	uint32 clk, n;
+	clk = GetSysTickCnt();
+	if(pw->init == 0)
+	{
+		pw->init = 1;
+		pw->clk = clk;
+		return;
+	}
+	n = clk - pw->clk;
+	pw->clk = clk;
+	if(pw->run == 0)
+	{
+		pw->now += n;	//nothing to expire on the way
+		return;
+	}
+	while(n--) SamTmrTick(pw);
+}
+
+uint32 SamTmrNextMs(void)
+{
+	SamTmrWheelTag * pw = &(SamCtxCur()->tmr);
+	uint32 d, t;
+	uint8 l, k;
+
+	if(pw->run == 0) return(SAM_CFG_IDLE_MAX_MS);
+	for(k = 1; k <= TMR_SLOTS; k++)
+	{
+		if(pw->slot[0][(pw->now + k) & TMR_MASK] != 0) return(k);
+	}
+	//no timer due within level 0, wake at the first cascade of an occupied slot
+	d = TMR_SPAN;
+	for(l = 1; l < TMR_LVLS; l++)
+	{
+		for(k = 1; k <= TMR_SLOTS; k++)
+		{
+			if(pw->slot[l][((pw->now >> (TMR_BITS * l)) + k) & TMR_MASK] == 0) continue;
+			t = (((pw->now >> (TMR_BITS * l)) + k) << (TMR_BITS * l)) - pw->now;
+			if(t < d) d = t;
+			break;
+		}
+	}
+	return(d);
+}
@@ -0,0 +1,141 @@
+/**
+ * @file 	SamTmr.h
+ * @brief   Millisecond timers shared by the functional units
+ * @details A hierarchical timing wheel of 4 levels x 64 slots (1ms, 64ms, 4.1s, 262s)
+ *			holds one-shot and periodic timers. SamMdmProc reads the clock once per
+ *			pass and advances the wheel, units only check the expiry counts of their
+ *			timers, and SamNextDeadlineMs includes the next expiry.
+ *
+ * @version 1.0.0
+ * @date 	2025-08-01
+ * @author 	Alex <fanbing.kong@sunseaaiot.com>
+ * @copyright Copyright (c) 2025, SIMCom Wireless Solutions Limited. All rights reserved.
+ *
+ * @note
+ *		Timers live in a pool of SAM_TMR_NUM entries per SamCtx and are named by an
+ *		id, 0 is no timer. A unit keeps its id over a re-init by passing it back to
+ *		SamTmrStart, and calls SamTmrStop before it is cleared with memset, otherwise
+ *		its pool entry stays taken until the context is initialized again.
+ *
+ */
+
+//---------------------------------------------------------------------------
+#ifndef __SAMTMR_H
+#define __SAMTMR_H
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef uint8 SamTmrId;		//pool index + 1, 0: no timer
+
+#define TMR_LVLS	4
+#define TMR_BITS	6
+#define TMR_SLOTS	(1 << TMR_BITS)
+
+typedef struct{
+	uint8	sta;
+	uint8	next;		//slot list links, pool index + 1
+	uint8	prev;
+	uint8	lvl;
+	uint8	slot;
+	uint16	fired;		//expiries not checked yet
+	uint32	expire;		//wheel time of the next expiry
+	uint32	period;
+}SamTmrTag;
+
+//Wheel of one SamCtx, the functions below act on the current context
+typedef struct{
+	SamTmrTag pool[SAM_TMR_NUM];
+	uint8	slot[TMR_LVLS][TMR_SLOTS];	//list heads, pool index + 1
+	uint32	now;		//wheel time in ms
+	uint32	clk;		//system tick at now
+	uint8	run;		//timers linked in the wheel
+	uint8	init;
+}SamTmrWheelTag;
+
+/**
+ * @brief Arm a timer.
+ *
+ * Takes a timer from the pool when id is 0, otherwise rearms the given timer and
+ * clears its expiry count.
+ *
+ * @param id Timer to rearm, 0 to take a new one.
+ * @param ms Time to the first expiry in ms.
+ * @param period Time between the following expiries in ms, 0 for a one-shot timer.
+ * @return The timer id, 0 when the pool is empty.
+ */
+extern SamTmrId SamTmrStart(SamTmrId id, uint32 ms, uint32 period);
+
+/**
+ * @brief Stop a timer and give it back to the pool.
+ *
+ * @param id Timer to stop, 0 is ignored.
+ */
+extern void SamTmrStop(SamTmrId id);
+
+/**
+ * @brief Get and clear the number of expiries since the last call.
+ *
+ * @param id Timer to check.
+ * @return Expiries counted, 0 when the timer has not expired.
+ */
+extern uint16 SamTmrFired(SamTmrId id);
+
+/**
+ * @brief Get the time left to the next expiry.
+ *
+ * @param id Timer to check.
+ * @return Time in ms, 0 when the timer is not running.
+ */
+extern uint32 SamTmrLeft(SamTmrId id);
+
+/**
+ * @brief Count the periods of a periodic timer, arming it on first use.
+ *
+ * The common form of a unit's second counter: stim += SamTmrPeriod(&stmr, 1000).
+ *
+ * @param pid Timer id kept by the unit, set when the timer is taken.
+ * @param ms Period in ms.
+ * @return Periods elapsed since the last call.
+ */
+extern uint16 SamTmrPeriod(SamTmrId * pid, uint32 ms);
+
+/**
+ * @brief Get the wheel time.
+ *
+ * The system tick read by the last SamTmrPoll, for time stamps that need no clock read.
+ *
+ * @return Wheel time in ms.
+ */
+extern uint32 SamTmrNow(void);
+
+/**
+ * @brief Read the system tick once and advance the wheel to it.
+ *
+ * Called at the start of every SamMdmProc pass.
+ */
+extern void SamTmrPoll(void);
+
+/**
+ * @brief Get the time to the next wheel event.
+ *
+ * Exact for timers due within 64ms, otherwise the time to the next cascade of the
+ * upper levels, which is never later than the expiry itself.
+ *
+ * @return Time in ms, SAM_CFG_IDLE_MAX_MS when no timer is running.
+ */
+extern uint32 SamTmrNextMs(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
+/*****************************************************************************
+**                            End Of File
+******************************************************************************/
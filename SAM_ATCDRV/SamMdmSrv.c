@@ -3,11 +3,19 @@
 #include "include.h"
 
 HdsAtcTag 	AtcA = {0};
-HdsAtcTag * pAtcBusArray[ATCBUS_CHMAX] = {NULL};
+#if SAM_CFG_CMUX_ENABLED
+HdsAtcTag 	AtcDlc[ATCBUS_CHMAX - 1];	//AT channels on DLC2..n, AtcA runs on DLC1
+SamCmuxTag	CmuxA;
+#endif
 
 char MdmACfgStr[256] ="\vCFGMDM_A1\t0\tA\t1,1,\"IP\",\"cmiot\",1,\"user123\",\"psw123\"\v";   //,2,\"IP\",\"cmnet\",1,\"user123\",\"psw123\"\v";
 TMdmTag MdmABdy = {0};
 void * pMdmA = NULL;
+static SamMdmStoreFunTag MdmAStore = NULL;
+static SamMdmResetFunTag MdmAReset = NULL;
+static SamMdmLinkFunTag MdmALink = NULL;
+static uint32 MdmALinkBase, MdmALinkMax;
+static uint8 MdmALinkFlow;
 
 SamRetChar SamMdmSrvCmd(SamMdmOptCmdTag cmd, void * pin, void * pout)
 {
@@ -17,9 +25,11 @@ SamRetChar SamMdmSrvCmd(SamMdmOptCmdTag cmd, void * pin, void * pout)
 
 	if(pMdmA == NULL) return(RETCHAR_FALSE);
 	pmdm = (TMdmTag *)pMdmA;
-	if(cmd > MDMCMD_CHKMDMIP && pout == NULL) return(RETCHAR_FALSE); 
+	if(cmd > MDMCMD_CHKMDMIP && cmd != MDMCMD_USERATC && cmd != MDMCMD_CFGPWR && pout == NULL) return(RETCHAR_FALSE); 
 	switch(cmd)
 	{
+		case MDMCMD_USERATC :
+			return((SamRetChar)SamMdmUserAtc(pmdm, (AtcReqTag *)pin));
 		case MDMCMD_CHKMDMIP :
 			if((pmdm->conditon & IPACT_MDMCND) != 0)
 			{
@@ -35,6 +45,12 @@ SamRetChar SamMdmSrvCmd(SamMdmOptCmdTag cmd, void * pin, void * pout)
 		case MDMCMD_GETIMSI :
 			strcpy((char *)pout, pmdm->imsi);
 			return(RETCHAR_TRUE);
+		case MDMCMD_GETFWVER :
+			strcpy((char *)pout, pmdm->fwver);
+			return(RETCHAR_TRUE);
+		case MDMCMD_GETRCVSTAT :
+			memcpy(pout, &(pmdm->rcvstat), sizeof(TMdmRcvStatTag));
+			return(RETCHAR_TRUE);
 		case MDMCMD_GETIP :
 			if(pin == NULL)
 			{
@@ -43,16 +59,41 @@ SamRetChar SamMdmSrvCmd(SamMdmOptCmdTag cmd, void * pin, void * pout)
 			else
 			{
 				i = *((uint8*)(pin));
-				if(i > pmdm->pdncnt) i = 1;
+				if(i == 0 || i > MDMPDN_MAX) i = 1;
+			}
+			pstr = (char *)pout;
+			if(pmdm->pdn[i-1].state != UP_MDMPDN)
+			{
+				pstr[0] = '\0';
+			}
+			else
+			{
+				sprintf(pstr, "%u.%u.%u.%u", pmdm->pdn[i-1].ip4[0], pmdm->pdn[i-1].ip4[1], pmdm->pdn[i-1].ip4[2], pmdm->pdn[i-1].ip4[3]);
 			}
-			ReadCfgTab(pmdm->ipstrtab, NULL, i-1, (char *)pout);
 			return(RETCHAR_TRUE);
+		case MDMCMD_GETPDN :
+			if(pin == NULL || SamMdmPdnGet(pmdm, *((uint8*)(pin))) == NULL) return(RETCHAR_FALSE);
+			memcpy(pout, SamMdmPdnGet(pmdm, *((uint8*)(pin))), sizeof(TMdmPdnTag));
+			return(RETCHAR_TRUE);
+		case MDMCMD_GETCSQ :
+			*((uint8 *)pout) = pmdm->radio.csq;
+			return(RETCHAR_TRUE);
+		case MDMCMD_GETRADIO :
+			return((SamRetChar)SamMdmRadioGet(pmdm, (pin == NULL) ? 0 : *((uint8 *)pin), (TMdmRadioTag *)pout));
 		case MDMCMD_CFGPDN :
 			//2,1,\"IP\",\"cmiot\",1,\"user123\",\"psw123\",2,\"IP\",\"cmnet\",1,\"user123\",\"psw123\""
 			pstr = (char *)pin;
 			if(pstr == NULL || pstr[0]>'9'||pstr[0]<'0'||pstr[1]!=',') return(RETCHAR_FALSE);
 			WriteCfgTab(MdmACfgStr, CFGMDM_HEADSTR, CFGMDM_PDNCFG, (char *)pin);
 			return(RETCHAR_TRUE);
+		case MDMCMD_CFGPWR :
+			//3600,20,20480,30000
+			pstr = (char *)pin;
+			if(pstr == NULL || pstr[0]>'9'||pstr[0]<'0') return(RETCHAR_FALSE);
+			WriteCfgTab(MdmACfgStr, CFGMDM_HEADSTR, CFGMDM_PWRCFG, (char *)pin);
+			return(RETCHAR_TRUE);
+		case MDMCMD_GETPWRSTAT :
+			return((SamRetChar)SamPwrStatGet((SamPwrStatTag *)pout));
 		default :
 			return(RETCHAR_FALSE);
 			break;
@@ -65,7 +106,17 @@ SamRetChar SamMdmSrvCmd(SamMdmOptCmdTag cmd, void * pin, void * pout)
 void SamMdmSrvStart(void)
 {
 	TMdmTag * pmdm = NULL;
+#if SAM_CFG_CMUX_ENABLED
+	uint8 i;
+	SamCmuxInit(&CmuxA, ATCCH_A);
+	pAtcBusArray[0] = SamAtcInit(&AtcA,  CMUXCH_DLC(1));
+	for(i = 1; i < ATCBUS_CHMAX; i++)
+	{
+		pAtcBusArray[i] = SamAtcInit(&AtcDlc[i - 1], CMUXCH_DLC(i + 1));
+	}
+#else
 	pAtcBusArray[0] = SamAtcInit(&AtcA,  ATCCH_A);
+#endif
 	pmdm = (void *)&(MdmABdy);
 	pMdmA = SamMdmInit(pmdm, MdmACfgStr);
 	if(pMdmA == NULL)
@@ -73,12 +124,39 @@ void SamMdmSrvStart(void)
 		DebugTrace("SamScmInit Fail\n");
 		pmdm = NULL;
 	}
+	else
+	{
+		SamMdmSetStore(pmdm, MdmAStore);
+		SamMdmSetReset(pmdm, MdmAReset);
+		SamMdmSetLink(pmdm, MdmALink, MdmALinkBase, MdmALinkMax, MdmALinkFlow);
+	}
+}
+
+void SamMdmSrvSetStore(SamMdmStoreFunTag pfun)
+{
+	MdmAStore = pfun;
+	if(pMdmA != NULL) SamMdmSetStore((TMdmTag *)pMdmA, pfun);
+}
+
+void SamMdmSrvSetReset(SamMdmResetFunTag pfun)
+{
+	MdmAReset = pfun;
+	if(pMdmA != NULL) SamMdmSetReset((TMdmTag *)pMdmA, pfun);
+}
+
+void SamMdmSrvSetLink(SamMdmLinkFunTag pfun, uint32 base, uint32 max, uint8 flow)
+{
+	MdmALink = pfun;
+	MdmALinkBase = base;
+	MdmALinkMax = max;
+	MdmALinkFlow = flow;
+	if(pMdmA != NULL) SamMdmSetLink((TMdmTag *)pMdmA, pfun, base, max, flow);
 }
 
 
 void SamMdmSrvRun(void)
 {
-	SamMdmProc(pMdmA);
+	SamCtxRun(&SamCtxDef, SAM_MDM_PROC_BUDUS);	//CmuxA and MdmABdy run in the default context
 }
 
 
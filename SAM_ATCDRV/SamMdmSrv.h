@@ -48,6 +48,13 @@ typedef enum{
 	MDMCMD_GETIMSI,		//Read imsi
 	MDMCMD_GETCSQ,		//Read Csq
 	MDMCMD_GETIP,		//Get IP 
+	MDMCMD_GETFWVER,	//Read firmware version
+	MDMCMD_USERATC,		//Queue a user AT command, pin: AtcReqTag, see SamMdmUserAtc
+	MDMCMD_GETRCVSTAT,	//Read recovery statistics, pout: TMdmRcvStatTag
+	MDMCMD_GETRADIO,	//Read a radio snapshot, pin: uint8 records back or NULL for the latest, pout: TMdmRadioTag
+	MDMCMD_GETPDN,		//Read a PDN context that is up, pin: uint8 cid, pout: TMdmPdnTag
+	MDMCMD_CFGPWR,		//Configure PSM, eDRX and uplink batching, pin: "tau_s,active_s,edrx_ms,window_ms", used from the next bring-up
+	MDMCMD_GETPWRSTAT,	//Read radio time statistics of the batching, pout: SamPwrStatTag
 
 	
 }SamMdmOptCmdTag;
@@ -59,6 +66,15 @@ extern void SamMdmSrvStart(void);
 extern void SamMdmSrvRun(void);
 extern void SamMdmSrvStop(void);
 
+//Warm start record storage, call before SamMdmSrvStart or before the first SamMdmSrvRun
+extern void SamMdmSrvSetStore(SamMdmStoreFunTag pfun);
+
+//Module reset hook of the recovery, NULL: AT+CRESET, see SamMdmSetReset
+extern void SamMdmSrvSetReset(SamMdmResetFunTag pfun);
+
+//UART rate and flow control negotiation, call before SamMdmSrvStart or before the first SamMdmSrvRun, see SamMdmSetLink
+extern void SamMdmSrvSetLink(SamMdmLinkFunTag pfun, uint32 base, uint32 max, uint8 flow);
+
 
 
 
@@ -195,6 +195,12 @@ void SocketDataCallback(uint8_t socketId, const uint8_t* data, uint32_t length,
  */
 void newSocket(void)
 {
+    // a socket of an earlier call gives its timer and function link back before the clear
+    if (sock.phatc != NULL)
+    {
+        SamAtcFunUnlink(sock.phatc, sock.runlink);
+    }
+    SamTmrStop(sock.base.stmr);
     memset((void *)&sock, 0x00, sizeof(Sam_Mdm_Socket_t));
     
     // Initialize the socket with the default configuration
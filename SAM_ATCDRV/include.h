@@ -38,7 +38,6 @@ typedef struct{
 #define RI_ACT          	(1<<14)
 #define CTS_PIN         	(1<<15)
 
-extern UartTag UartTA;
 
 
 
@@ -0,0 +1,14 @@
+#!/bin/sh
+# Rebuild the library and linux_sam_test with CMUX and run it against one emulated modem,
+# the port taking at most 16 bytes per write so frames go out in several writes.
+# usage: emu/run_cmux.sh secs [linux_sam_test options], from examples/linux.
+# Leaves the tree cleaned, make builds the default configuration again.
+secs=${1:-45}
+[ $# -gt 0 ] && shift
+dir=$(cd "$(dirname "$0")" && pwd)
+cd "$dir/.." || exit 1
+make clean > /dev/null
+make SAM_CFG=-DSAM_CFG_CMUX_ENABLED=1 linux_sam_test > /dev/null 2>&1 || { echo "CMUX build failed"; exit 1; }
+"$dir/run_test.sh" "$secs" -w 16 "$@"
+echo "CMUX $(grep -ac 'DLCs Open' "${EMU_DIR:-/tmp/sam_emu}/app.log") start(s)"
+make clean > /dev/null
@@ -0,0 +1,25 @@
+#!/bin/sh
+# Run linux_sam_gw for a number of seconds against N emulated modems.
+# usage: emu/run_gw.sh N secs [linux_sam_gw options], from examples/linux after make.
+# The report goes to stdout, emulator logs to $EMU_DIR/emu<i>.log.
+n=${1:-4}
+secs=${2:-30}
+shift 2
+dir=$(cd "$(dirname "$0")" && pwd)
+EMU_DIR=${EMU_DIR:-/tmp/sam_emu}
+export EMU_DIR
+pids=""
+args=""
+for i in $(seq 1 "$n"); do
+    rm -f "$EMU_DIR/pty$i"
+    EMU_ID=$i python3 "$dir/sam_modem_emu.py" > /dev/null 2>&1 &
+    pids="$pids $!"
+done
+for i in $(seq 1 "$n"); do
+    while [ ! -s "$EMU_DIR/pty$i" ]; do sleep 0.1; done
+    args="$args -D $(cat "$EMU_DIR/pty$i")"
+done
+timeout $((secs + 5)) "$dir/../linux_sam_gw" $args -T "$secs" "$@"
+rc=$?
+kill $pids 2>/dev/null
+exit $rc
@@ -0,0 +1,17 @@
+#!/bin/sh
+# Run linux_sam_lat against one emulated modem pushing stamped socket data.
+# usage: emu/run_lat.sh secs [linux_sam_lat options], from examples/linux after make.
+# EMU_RXMS sets the push period, 200 ms unless given; other EMU_* pass to the emulator.
+secs=${1:-60}
+[ $# -gt 0 ] && shift
+dir=$(cd "$(dirname "$0")" && pwd)
+EMU_DIR=${EMU_DIR:-/tmp/sam_emu}
+EMU_RXMS=${EMU_RXMS:-200}
+export EMU_DIR EMU_RXMS
+rm -f "$EMU_DIR/pty"
+python3 "$dir/sam_modem_emu.py" > /dev/null 2>&1 &
+epid=$!
+while [ ! -s "$EMU_DIR/pty" ]; do sleep 0.1; done
+"$dir/../linux_sam_lat" -D "$(cat "$EMU_DIR/pty")" -T "$secs" "$@" > "$EMU_DIR/lat.log" 2>&1
+kill $epid 2>/dev/null
+tail -n 2 "$EMU_DIR/lat.log"
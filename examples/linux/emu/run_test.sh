@@ -0,0 +1,16 @@
+#!/bin/sh
+# Run linux_sam_test for a number of seconds against one emulated modem.
+# usage: emu/run_test.sh secs [linux_sam_test options], from examples/linux after make.
+# EMU_* variables pass to the emulator, see sam_modem_emu.py.
+secs=${1:-45}
+[ $# -gt 0 ] && shift
+dir=$(cd "$(dirname "$0")" && pwd)
+EMU_DIR=${EMU_DIR:-/tmp/sam_emu}
+export EMU_DIR
+rm -f "$EMU_DIR/pty"
+python3 "$dir/sam_modem_emu.py" > /dev/null 2>&1 &
+epid=$!
+while [ ! -s "$EMU_DIR/pty" ]; do sleep 0.1; done
+timeout "$secs" stdbuf -oL "$dir/../linux_sam_test" -D "$(cat "$EMU_DIR/pty")" "$@" > "$EMU_DIR/app.log" 2>&1
+kill $epid 2>/dev/null
+echo "MQTT messages received $(grep -ac pMsg "$EMU_DIR/app.log"), published $(grep -c 'CMQTTPUB=' "$EMU_DIR/emu.log")"
@@ -0,0 +1,415 @@
+#!/usr/bin/env python3
+# SIMCom modem emulator on a pty, for running the Linux examples without a module.
+#
+# Answers the bring-up, PDN, socket, MQTT and SMS commands the library sends, switches
+# UART rate on AT+IPR, and speaks 27.010 basic-option frames after AT+CMUX=0. Unknown
+# commands get OK.
+#
+# Environment:
+#   EMU_DIR      directory of the pty name and log files, default /tmp/sam_emu
+#   EMU_ID       instance suffix of the file names when several emulators run
+#   EMU_CHUNK    write replies in chunks of this many bytes
+#   EMU_BADRATE  UART rate the module switches to but cannot carry
+#   EMU_LOSS     drop EPS registration for 1 s after 20 s
+#   EMU_NOSRV    1/2: lose service after 15 s, until PDN deactivation (1) or CFUN=0 (2)
+#   EMU_PDN      1: network deactivates PDN 1 after 25 s, 2: and re-activation fails
+#   EMU_DETACH   network detaches PS after this many s and re-attaches 5 s later
+#   EMU_QUIET    with EMU_DETACH, no registration URC on the re-attach
+#   EMU_V6       report a dual stack address
+#   EMU_RXMS     push socket data every this many ms once a socket is open, stamped
+#                with CLOCK_MONOTONIC in us ("T<us>\n") for latency measurements
+#   EMU_SMSMS    time the network takes to accept an SMS in ms, default 1500
+#
+# The pty name goes to $EMU_DIR/pty$EMU_ID and the traffic log to $EMU_DIR/emu$EMU_ID.log.
+import os, pty, re, select, termios, time, tty
+
+EMU_DIR = os.environ.get('EMU_DIR', '/tmp/sam_emu')
+EMU_ID = os.environ.get('EMU_ID', '')
+os.makedirs(EMU_DIR, exist_ok=True)
+
+master, slave = pty.openpty()
+tty.setraw(master)
+tty.setraw(slave)
+LOG = open(os.path.join(EMU_DIR, 'emu%s.log' % EMU_ID), 'w')
+CHUNK = int(os.environ.get('EMU_CHUNK', '0'))
+BADRATE = int(os.environ.get('EMU_BADRATE', '0'))
+RXMS = int(os.environ.get('EMU_RXMS', '0'))
+SMSMS = int(os.environ.get('EMU_SMSMS', '1500'))
+
+SPD = {getattr(termios, 'B%d' % r): r for r in
+       (9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600,
+        1000000, 1500000, 2000000, 3000000, 4000000) if hasattr(termios, 'B%d' % r)}
+
+st = {
+    'rate': 115200,     # module UART rate
+    'switch': None,     # rate taking effect after the OK
+    'mux': False,
+    'cur': 0,           # DLC of the command being answered
+    'regn': {},         # +C(E|G)REG=<n> per domain
+    'nosrv': None,
+    'pdndown': None,
+    'detach': None,
+    'echo': b'',        # socket receive data
+    'rxsid': None,      # open socket receiving EMU_RXMS data
+    'rxnext': 0.0,
+    'mq': {},
+    'smsmr': 0,
+}
+pending = []            # (time, bytes, dlc)
+
+
+def log(s):
+    LOG.write(s + '\n')
+    LOG.flush()
+
+
+def fcs(bs):
+    c = 0xFF
+    for x in bs:
+        c ^= x
+        for _ in range(8):
+            c = (c >> 1) ^ 0xE0 if c & 1 else c >> 1
+    return 0xFF - c
+
+
+def frame(dlci, ctrl, data=b'', cr=1):
+    hdr = bytes([(dlci << 2) | (cr << 1) | 1, ctrl, (len(data) << 1) | 1])
+    return b'\xf9' + hdr + data + bytes([fcs(hdr)]) + b'\xf9'
+
+
+def host_rate():
+    try:
+        return SPD.get(termios.tcgetattr(master)[5])
+    except termios.error:
+        return None
+
+
+def link_ok(rx=False):
+    r = host_rate()
+    return r is None or (r == st['rate'] and (rx or st['rate'] != BADRATE))
+
+
+def w(b):
+    if isinstance(b, str):
+        b = b.encode()
+    if not link_ok():
+        log('>> garbled (host %s, modem %d) %r' % (host_rate(), st['rate'], b))
+        return
+    log('>> %s%r' % (('[%d]' % st['cur']) if st['mux'] else '', b))
+    if st['mux']:
+        for i in range(0, len(b), 31):
+            os.write(master, frame(st['cur'], 0xEF, b[i:i + 31], 0))
+    elif CHUNK:
+        for i in range(0, len(b), CHUNK):
+            os.write(master, b[i:i + CHUNK])
+            time.sleep(0.001)
+    else:
+        os.write(master, b)
+
+
+def line(s):
+    w('\r\n' + s + '\r\n')
+
+
+def later(dt, s):
+    pending.append((time.time() + dt, s, st['cur']))
+
+
+def due(key):
+    t = st[key]
+    return t is not None and time.time() >= t
+
+
+def handle_one(c):
+    """Answer one command: True for OK, None when answered with an error, 'MUX' or
+    'LATER' when the final result is sent elsewhere, ('>', n, cb) to take n data bytes."""
+    cu = c.upper()
+    if cu in ('AT', 'ATE0', 'ATE1'):
+        return True
+    if cu.startswith('AT'):
+        cu = cu[2:]
+    env = os.environ.get
+    if cu == '+CPIN?':
+        line('+CPIN: READY'); return True
+    if cu == '+IPR=?':
+        line('+IPR: (0,300,600,1200,2400,4800,9600,19200,38400,57600,115200,230400,460800,'
+             '921600,3000000,3200000,3686400)'); return True
+    if cu == '+IPR?':
+        line('+IPR: %d' % st['rate']); return True
+    m = re.match(r'\+IPR=(\d+)$', cu)
+    if m:
+        st['switch'] = int(m.group(1)); return True
+    if cu.startswith('+IFC='):
+        return True
+    if cu == '+CRESET':
+        st['switch'] = 115200; return True
+    m = re.match(r'\+C(E|G|)REG=(\d)', cu)
+    if m:
+        st['regn'][m.group(1)] = int(m.group(2)); return True
+    if cu == '+CFUN=1' and st['regn'].get('E', 0) >= 1:
+        later(0.3, '\r\n+CEREG: 1,"5A1E","0B28A403",7\r\n')
+        if env('EMU_NOSRV') and st['nosrv'] is None:
+            st['nosrv'] = time.time() + 15
+        if env('EMU_PDN') and st['pdndown'] is None:
+            later(25, '\r\n+CGEV: NW PDN DEACT 1\r\n')
+            st['pdndown'] = time.time() + 25
+        if env('EMU_DETACH') and st['detach'] is None:
+            t = float(env('EMU_DETACH'))
+            st['detach'] = time.time() + t
+            later(t, '\r\n+CGEV: NW DETACH\r\n\r\n+CEREG: 2\r\n')
+            if not env('EMU_QUIET'):
+                later(t + 5, '\r\n+CEREG: 1,"5A1E","0B28A403",7\r\n')
+        if env('EMU_LOSS'):
+            later(20, '\r\n+CEREG: 2\r\n')
+            if env('EMU_NOSRV') != '2':
+                later(21, '\r\n+CEREG: 1,"5A1F","0B28A404",7\r\n')
+        return True
+    if cu == '+CLAC':
+        line(','.join('+C%04d' % i for i in range(300))); return True
+    if cu == '+CSQ':
+        line('+CSQ: 20,99'); return True
+    detached = st['detach'] is not None and 0 <= time.time() - st['detach'] < 5
+    if cu == '+CGATT?':
+        line('+CGATT: %d' % (0 if due('nosrv') or detached else 1)); return True
+    if due('nosrv') and (cu.startswith('+CGACT=0') and env('EMU_NOSRV') == '1'
+                         or cu == '+CFUN=0' and env('EMU_NOSRV') == '2'):
+        st['nosrv'] = 1e18
+    if cu == '+CPSI?' and due('nosrv'):
+        line('+CPSI: NO SERVICE,Online'); return True
+    if cu.startswith('+CGACT=1') and (due('pdndown') or detached):
+        if env('EMU_PDN') == '2' or detached:
+            line('ERROR'); return None
+        st['pdndown'] = None
+    if cu.startswith('+CGPADDR') and (due('pdndown') or detached):
+        line('+CGPADDR: 1,0.0.0.0'); return True
+    if cu.startswith('+CGACT'):
+        return True
+    if cu == '+CPSI?':
+        line('+CPSI: LTE,Online,460-00,0x5A1E,187214083,257,EUTRAN-BAND3,1300,5,5,-94,-850,-545,15')
+        return True
+    if cu == '+SIMEI?':
+        line('+SIMEI: 864865021112233'); return True
+    if cu == '+CICCID':
+        line('+ICCID: 89860012345678901234'); return True
+    if cu == '+CCID':
+        line('ERROR'); return None
+    if cu == '+CIMI':
+        line('460001234567890'); return True
+    if cu == '+CGMR':
+        line('+CGMR: LE20B04SIM7600M22'); return True
+    if cu.startswith('+CGPADDR') and env('EMU_V6'):
+        line('+CGPADDR: 1,"10.88.44.193","254.128.0.0.0.0.0.0.0.0.0.0.0.0.0.1"'); return True
+    if cu.startswith('+CGPADDR'):
+        line('+CGPADDR: 1,10.88.44.193'); return True
+    if cu.startswith('+CGCONTRDP'):
+        line('+CGCONTRDP: 1,5,cmiot,10.88.44.193.255.255.255.0,10.88.44.1,211.136.17.107,'
+             '211.136.20.203,0.0.0.0,0.0.0.0,0,0,1500'); return True
+    if cu.startswith('+CGREG?'):
+        line('+CGREG: 0,1'); return True
+    if cu.startswith('+CEREG?'):
+        line('+CEREG: %d,1' % st['regn'].get('E', 0)); return True
+    if cu.startswith('+CREG?'):
+        line('+CREG: 0,1'); return True
+    if cu == '+NETOPEN':
+        later(0.05, '\r\n+NETOPEN: 0\r\n'); return True
+    if cu == '+NETOPEN?':
+        line('+NETOPEN: 1'); return True
+    m = re.match(r'\+CIPOPEN=(\d+),', cu)
+    if m:
+        sid = m.group(1)
+        later(0.05, '\r\n+CIPOPEN: %s,0\r\n' % sid)
+        st['echo'] = b'server says hello\r\n' * 3
+        later(2.0, '\r\n+CIPRXGET: 1,%s\r\n' % sid)
+        if RXMS:
+            st['rxsid'] = sid
+            st['rxnext'] = time.time() + 3.0
+        return True
+    m = re.match(r'\+CIPSEND=(\d+),(\d+)', cu)
+    if m:
+        sid, n = m.group(1), int(m.group(2))
+
+        def sent(data, sid=sid, n=n):
+            w('\r\nOK\r\n\r\n+CIPSEND: %s,%d,%d\r\n' % (sid, n, n))
+            st['echo'] += data
+            later(0.05, '\r\n+CIPRXGET: 1,%s\r\n' % sid)
+        return ('>', n, sent)
+    m = re.match(r'\+CIPRXGET=(\d),(\d+),?(\d*)', cu)
+    if m:
+        mode, sid = m.group(1), m.group(2)
+        if mode in '23':
+            d = st['echo']
+            if m.group(3):
+                d = d[:int(m.group(3))]
+            st['echo'] = st['echo'][len(d):]
+            w(('\r\n+CIPRXGET: %s,%s,%d,%d\r\n' % (mode, sid, len(d), len(st['echo']))).encode() + d)
+        elif mode == '4':
+            line('+CIPRXGET: 4,%s,%d' % (sid, len(st['echo'])))
+        return True
+    if cu == '+CMUX=0':
+        w('\r\nOK\r\n')
+        st['mux'] = True
+        return 'MUX'
+    if cu == '+COPS=?':
+        later(3.0, '\r\n+COPS: (2,"CHINA MOBILE","CMCC","46000",7),,(0-4),(0-2)\r\n\r\nOK\r\n')
+        return 'LATER'
+    if cu.startswith('+CMQTTSTART'):
+        later(0.05, '\r\n+CMQTTSTART: 0\r\n'); return True
+    m = re.match(r'\+CMQTTCONNECT=(\d+)', cu)
+    if m:
+        later(0.05, '\r\n+CMQTTCONNECT: %s,0\r\n' % m.group(1)); return True
+    m = re.match(r'\+CMQTT(SUBTOPIC|TOPIC|PAYLOAD|WILLTOPIC|WILLMSG|SUB|UNSUB)=(\d+),(\d+)', cu)
+    if m:
+        kind, idx, n = m.group(1), m.group(2), int(m.group(3))
+
+        def took(data, kind=kind, idx=idx):
+            st['mq'][(idx, kind)] = data
+            w('\r\nOK\r\n')
+            if kind in ('SUB', 'UNSUB'):
+                later(0.05, '\r\n+CMQTT%s: %s,0\r\n' % (kind, idx))
+        return ('>', n, took)
+    m = re.match(r'\+CMQTTSUB=(\d+)$', cu)
+    if m:
+        later(0.05, '\r\n+CMQTTSUB: %s,0\r\n' % m.group(1)); return True
+    m = re.match(r'\+CMQTTPUB=(\d+)', cu)
+    if m:
+        idx = m.group(1)
+        t = st['mq'].get((idx, 'TOPIC'), b'x')
+        p = st['mq'].get((idx, 'PAYLOAD'), b'y')
+        later(0.05, '\r\n+CMQTTPUB: %s,0\r\n' % idx)
+        later(0.2, ('\r\n+CMQTTRXSTART: %s,%d,%d\r\n+CMQTTRXTOPIC: %s,%d\r\n'
+                    % (idx, len(t), len(p), idx, len(t))).encode() + t
+              + ('\r\n+CMQTTRXPAYLOAD: %s,%d\r\n' % (idx, len(p))).encode() + p
+              + ('\r\n+CMQTTRXEND: %s\r\n' % idx).encode())
+        return True
+    if cu == '+CSCA?':
+        line('+CSCA: "+8613800100500",145'); return True
+    if cu.startswith('+CPMS='):
+        line('+CPMS: 0,50,0,50,0,50'); return True
+    if cu.startswith('+CMGS='):
+        def smsgo(data):
+            st['smsmr'] = (st['smsmr'] + 1) & 0xFF
+            later(SMSMS / 1000.0, '\r\n+CMGS: %d\r\n\r\nOK\r\n' % st['smsmr'])
+        return ('>', b'\x1a', smsgo)
+    return True
+
+
+def handle(cmdline):
+    log('<< %r' % cmdline)
+    c = cmdline.decode(errors='replace').strip()
+    if not c or not c.upper().startswith('AT'):
+        return None
+    parts = [c]
+    if ';' in c[2:]:
+        s = c[2:].split(';')
+        parts = ['AT' + x for x in s]
+    for p in parts:
+        r = handle_one(p)
+        if r is None or r in ('MUX', 'LATER'):
+            return None
+        if isinstance(r, tuple):
+            w('\r\n> ')
+            return (r[1], r[2])
+    w('\r\nOK\r\n')
+    if st['switch']:
+        st['rate'] = st['switch']
+        st['switch'] = None
+        log('rate %d' % st['rate'])
+    return None
+
+
+def process(b, dw):
+    """Split host bytes into command lines and data blocks, dw: data still awaited."""
+    while True:
+        if dw:
+            n, cb = dw
+            if isinstance(n, bytes):
+                i = b.find(n)           # data up to a terminator, e.g. Ctrl-Z of AT+CMGS
+                if i < 0:
+                    break
+                data, b = b[:i], b[i + 1:]
+            else:
+                if len(b) < n:
+                    break
+                data, b = b[:n], b[n:]
+            dw = None
+            log('<< data %r' % data)
+            cb(data)
+            continue
+        i = b.find(b'\r')
+        if i < 0:
+            break
+        cmd, b = b[:i], b[i + 1:]
+        if b.startswith(b'\n'):
+            b = b[1:]
+        dw = handle(cmd)
+    return b, dw
+
+
+dlcbuf = {}
+dlcwait = {}
+
+
+def muxparse(buf):
+    while True:
+        while buf and buf[0] != 0xF9:
+            buf = buf[1:]
+        while len(buf) > 1 and buf[1] == 0xF9:
+            buf = buf[1:]
+        if len(buf) < 5:
+            return buf
+        a, c, n = buf[1], buf[2], buf[3] >> 1
+        if len(buf) < 4 + n + 2:
+            return buf
+        data, f = buf[4:4 + n], buf[4 + n]
+        buf = buf[4 + n + 2:]
+        if fcs(bytes([a, c, (n << 1) | 1])) != f:
+            log('bad fcs')
+            continue
+        d = a >> 2
+        c &= ~0x10
+        log('F dlci=%d ctrl=%02x len=%d' % (d, c, n))
+        if c in (0x2F, 0x43):           # SABM, DISC: UA
+            os.write(master, frame(d, 0x73, b'', 1))
+        elif c == 0xEF and d > 0:
+            st['cur'] = d
+            dlcbuf[d], dlcwait[d] = process(dlcbuf.get(d, b'') + data, dlcwait.get(d))
+
+
+def main():
+    name = os.ttyname(slave)
+    with open(os.path.join(EMU_DIR, 'pty%s' % EMU_ID), 'w') as f:
+        f.write(name)
+    print(name, flush=True)
+    buf = b''
+    wait = None
+    while True:
+        now = time.time()
+        for it in [x for x in pending if x[0] <= now]:
+            pending.remove(it)
+            st['cur'] = it[2]
+            w(it[1])
+        if st['rxsid'] is not None and now >= st['rxnext']:
+            st['rxnext'] = now + RXMS / 1000.0
+            st['echo'] += b'T%d\n' % (time.clock_gettime_ns(time.CLOCK_MONOTONIC) // 1000)
+            w('\r\n+CIPRXGET: 1,%s\r\n' % st['rxsid'])
+        r, _, _ = select.select([master], [], [], 0.005)
+        if not r:
+            continue
+        try:
+            d = os.read(master, 4096)
+        except OSError:
+            break
+        if not st['mux'] and not link_ok(True):
+            log('<< garbled %r' % d)
+            continue
+        buf += d
+        if st['mux']:
+            buf = muxparse(buf)
+            continue
+        buf, wait = process(buf, wait)
+        if st['mux']:
+            buf = muxparse(buf)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,446 @@
+/*
+ * Gateway runner: several modem stacks in one process.
+ *
+ * Every modem has its own SamCtx, serial port, AT channel and TMdmTag. The modems
+ * are shared out to a few worker threads, modem i to worker i % workers, and a
+ * worker keeps its modems for the whole run, so the state machine of a modem only
+ * ever runs on one thread. A worker sleeps in epoll on the ttys of its modems until
+ * one of them has data or the earliest driver deadline of its modems is due.
+ */
+#include "serial_port.h"
+#include "sam_port.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include "../../SAM_ATCDRV/include.h"
+
+#if !SAM_CFG_CTXTLS_ENABLED
+#error "linux_sam_gw runs modem stacks on several threads, it needs SAM_CFG_CTXTLS_ENABLED"
+#endif
+
+#define GW_MODEM_MAX    32
+#define GW_WORKER_MAX   16
+#define GW_MODEM_PER_WORKER 4   // default pool size: one worker per 4 modems
+
+typedef struct {
+    uint32_t passes;        // SamCtxRun calls
+    uint32_t iowakes;       // passes started by tty data
+    uint64_t runus;         // time spent in passes
+    uint32_t runmax;
+    uint64_t latus;         // from tty data or deadline to the start of the pass
+    uint32_t latmax;
+    uint32_t probes;        // probe commands completed
+    uint32_t probeerr;      // ... not ended by OK
+    uint64_t probeus;       // probe round trip, submit to final result
+    uint32_t probemax;
+} gw_stat_t;
+
+typedef struct {
+    SamCtxTag ctx;          // current while the modem runs, see gw_cur
+    int idx;
+    int worker;
+    serial_port_t port;
+    HdsAtcTag atc;
+    TMdmTag mdm;
+    char cfg[256];
+    uint8_t ready;          // tty data since the last pass
+    uint8_t wout;           // EPOLLOUT armed for buffered tx
+    uint8_t dbgnl;          // trace output is at the start of a line
+    uint32_t rdyus;         // GetSysUsCnt when the data was seen
+    uint32_t dueus;         // GetSysUsCnt of the next pass
+    AtcReqTag probe;        // periodic command once the modem has an IP
+    uint32_t probeat;       // GetSysTickCnt of the next probe
+    uint32_t probeus;       // GetSysUsCnt of the submit
+    gw_stat_t st;           // written by the worker under its lock
+} gw_modem_t;
+
+typedef struct {
+    pthread_t tid;
+    pthread_mutex_t lock;   // held while the modems run, the report takes it to read
+    int id;
+    int epfd;
+    int cnt;
+    gw_modem_t *modem[GW_MODEM_MAX];
+} gw_worker_t;
+
+static gw_modem_t *gw_modem;
+static int gw_nmodem = 0;
+static gw_worker_t gw_worker[GW_WORKER_MAX];
+static int gw_nworker = 0;
+// Set by the signal handler or the run timer, polled by the workers
+static volatile sig_atomic_t gw_stop = 0;
+#define GW_STOPPED()    __atomic_load_n(&gw_stop, __ATOMIC_RELAXED)
+#define GW_STOP()       __atomic_store_n(&gw_stop, 1, __ATOMIC_RELAXED)
+static int gw_verbose = 0;
+static char gw_probe_cmd[64] = "AT+CSQ\r";
+static uint32_t gw_probe_ms = 5000;
+
+// Modem of the context running on this thread, NULL outside SamCtxRun
+static gw_modem_t *gw_cur(void)
+{
+    SamCtxTag *pctx = SamCtxCur();
+    if (pctx == &SamCtxDef) return NULL;
+    return (gw_modem_t *)((char *)pctx - offsetof(gw_modem_t, ctx));
+}
+
+// Serial port of the modem running on this thread, for the shared port
+static serial_port_t *gw_port(void)
+{
+    gw_modem_t *m = gw_cur();
+    return (m != NULL) ? &m->port : NULL;
+}
+
+// Debug channel with -v, lines tagged with the modem
+static void gw_debug(const char *dp, unsigned short dlen)
+{
+    gw_modem_t *m = gw_cur();
+    if (m != NULL && m->dbgnl) printf("[m%d] ", m->idx);
+    fwrite(dp, 1, dlen, stdout);
+    if (m != NULL) m->dbgnl = (dlen > 0 && dp[dlen - 1] == '\n');
+}
+
+// SAM_DBG output of all modems, one call per message
+static void gw_log(char *msg, uint16_t len)
+{
+    gw_modem_t *m = gw_cur();
+    if (m != NULL) printf("[m%d] %.*s", m->idx, (int)len, msg);
+    else printf("%.*s", (int)len, msg);
+}
+
+static void gw_probe_done(void *pd, AtcReqTag *preq, unsigned char ret, char *line)
+{
+    gw_modem_t *m = (gw_modem_t *)pd;
+    uint32_t us;
+    (void)preq;
+    (void)line;
+    if (ret == NOSTRRET_ATCRET || ret == PARTLINE_ATCRET) return;
+    us = GetSysUsCnt() - m->probeus;
+    m->st.probes++;
+    if (ret != 1) m->st.probeerr++;     // 1: OK of the user command set
+    m->st.probeus += us;
+    if (us > m->st.probemax) m->st.probemax = us;
+}
+
+// Queue the probe when due, in the context of the modem
+static void gw_probe(gw_modem_t *m)
+{
+    if (gw_probe_ms == 0 || (m->mdm.conditon & IPACT_MDMCND) == 0) return;
+    if (m->probe.state == WAIT_ATCREQ || m->probe.state == BUSY_ATCREQ) return;
+    if ((int32_t)(GetSysTickCnt() - m->probeat) < 0) return;
+    m->probeat = GetSysTickCnt() + gw_probe_ms;
+    m->probe.pset = NULL;
+    m->probeus = GetSysUsCnt();
+    SamMdmUserAtc(&m->mdm, &m->probe);
+}
+
+// Watch for tx room only while the port holds unsent bytes
+static void gw_modem_tx(gw_worker_t *w, gw_modem_t *m)
+{
+    struct epoll_event ev;
+    uint8_t out = (m->port.tx_buffer.head != m->port.tx_buffer.tail);
+    if (out == m->wout) return;
+    m->wout = out;
+    ev.events = EPOLLIN | (out ? EPOLLOUT : 0);
+    ev.data.ptr = m;
+    epoll_ctl(w->epfd, EPOLL_CTL_MOD, m->port.fd, &ev);
+}
+
+static void gw_modem_pass(gw_worker_t *w, gw_modem_t *m, uint32_t now)
+{
+    SamCtxTag *pold;
+    uint32_t lat, t, next;
+
+    lat = now - (m->ready ? m->rdyus : m->dueus);
+    if (m->ready) m->st.iowakes++;
+    m->ready = 0;
+
+    t = GetSysUsCnt();
+    pold = SamCtxUse(&m->ctx);
+    gw_probe(m);
+    SamCtxUse(pold);
+    SamCtxRun(&m->ctx, SAM_MDM_PROC_BUDUS);
+    next = SamCtxNextDeadlineMs(&m->ctx);
+    now = GetSysUsCnt();
+    t = now - t;
+    m->dueus = now + next * 1000;
+    gw_modem_tx(w, m);
+
+    m->st.passes++;
+    m->st.runus += t;
+    if (t > m->st.runmax) m->st.runmax = t;
+    if ((int32_t)lat > 0) {
+        m->st.latus += lat;
+        if (lat > m->st.latmax) m->st.latmax = lat;
+    }
+}
+
+static void *gw_worker_run(void *arg)
+{
+    gw_worker_t *w = (gw_worker_t *)arg;
+    struct epoll_event ev[GW_MODEM_MAX];
+    gw_modem_t *m;
+    uint32_t now;
+    int32_t d;
+    int i, n, tmo;
+
+    while (!GW_STOPPED()) {
+        // Sleep until the earliest deadline of the modems of this worker
+        now = GetSysUsCnt();
+        tmo = SAM_CFG_IDLE_MAX_MS;
+        for (i = 0; i < w->cnt && tmo > 0; i++) {
+            d = (int32_t)(w->modem[i]->dueus - now);
+            if (d <= 0) tmo = 0;
+            else if ((d + 999) / 1000 < tmo) tmo = (d + 999) / 1000;
+        }
+        n = epoll_wait(w->epfd, ev, GW_MODEM_MAX, tmo);
+        now = GetSysUsCnt();
+        for (i = 0; i < n; i++) {
+            m = (gw_modem_t *)ev[i].data.ptr;
+            if (ev[i].events & EPOLLOUT) serial_flush(&m->port);
+            if ((ev[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && !m->ready) {
+                m->ready = 1;
+                m->rdyus = now;
+            }
+        }
+
+        pthread_mutex_lock(&w->lock);
+        for (i = 0; i < w->cnt; i++) {
+            m = w->modem[i];
+            if (m->ready || (int32_t)(m->dueus - now) <= 0) gw_modem_pass(w, m, GetSysUsCnt());
+        }
+        pthread_mutex_unlock(&w->lock);
+    }
+    return NULL;
+}
+
+static int gw_modem_open(gw_modem_t *m, int idx, const char *device, const char *pdn)
+{
+    serial_config_t config = {
+        .baudrate = 115200,
+        .parity = 'N',
+        .data_bits = 8,
+        .stop_bits = 1,
+        .flow_control = false
+    };
+    SamCtxTag *pold;
+
+    m->idx = idx;
+    m->dbgnl = 1;
+    if (!serial_init(&m->port, device, &config)) {
+        fprintf(stderr, "m%d: failed to initialize %s\n", idx, device);
+        return -1;
+    }
+    snprintf(m->cfg, sizeof(m->cfg), "\vCFGMDM_A1\t0\tA\t%s\v", pdn);
+    m->probe.cmd = gw_probe_cmd;
+    m->probe.timwm = 10;
+    m->probe.pcb = gw_probe_done;
+    m->probe.pd = m;
+
+    // The units register into the current context while they are set up
+    SamCtxInit(&m->ctx);
+    pold = SamCtxUse(&m->ctx);
+    pAtcBusArray[0] = SamAtcInit(&m->atc, ATCCH_A);
+    if (SamMdmInit(&m->mdm, m->cfg) == NULL) {
+        SamCtxUse(pold);
+        fprintf(stderr, "m%d: SamMdmInit failed\n", idx);
+        serial_close(&m->port);
+        return -1;
+    }
+    SamCtxUse(pold);
+    m->dueus = GetSysUsCnt();
+    m->probeat = GetSysTickCnt();
+    return 0;
+}
+
+static void gw_report(uint32_t wallms, double cpus)
+{
+    static uint32_t last_passes = 0;
+    uint32_t passes = 0, iowakes = 0, up = 0, latmax = 0;
+    uint32_t atcnt, aterr, attmo, atsum, atmax;
+    SamCtxTag *pold;
+    gw_modem_t *m;
+    gw_stat_t st;
+    int i;
+
+    for (i = 0; i < gw_nmodem; i++) {
+        m = &gw_modem[i];
+        atcnt = aterr = attmo = atsum = atmax = 0;
+        pthread_mutex_lock(&gw_worker[m->worker].lock);
+        st = m->st;
+#if SAM_CFG_ATCSTAT_ENABLED
+        const AtcStatTag *pst;
+        uint8_t k;
+        pold = SamCtxUse(&m->ctx);
+        for (k = 0; (pst = SamAtcStatGet(k)) != NULL; k++) {
+            atcnt += pst->cnt;
+            aterr += pst->errcnt;
+            attmo += pst->tmocnt;
+            atsum += pst->summs;
+            if (pst->maxms > atmax) atmax = pst->maxms;
+        }
+        SamCtxUse(pold);
+#else
+        (void)pold;
+#endif
+        printf("m%-2d w%d %-4s csq %2u  pass %7u io %7u  run avg %4u max %6u us  lat avg %5u max %6u us"
+               "  at %5u err %3u tmo %3u avg %4u max %5u ms  probe %4u err %3u avg %5u max %6u us\n",
+               m->idx, m->worker, (m->mdm.conditon & IPACT_MDMCND) ? "up" : "down", m->mdm.radio.csq,
+               st.passes, st.iowakes,
+               st.passes ? (uint32_t)(st.runus / st.passes) : 0, st.runmax,
+               st.passes ? (uint32_t)(st.latus / st.passes) : 0, st.latmax,
+               atcnt, aterr, attmo, (atcnt + aterr) ? atsum / (atcnt + aterr) : 0, atmax,
+               st.probes, st.probeerr, st.probes ? (uint32_t)(st.probeus / st.probes) : 0, st.probemax);
+        if (m->mdm.conditon & IPACT_MDMCND) up++;
+        pthread_mutex_unlock(&gw_worker[m->worker].lock);
+        passes += st.passes;
+        iowakes += st.iowakes;
+        if (st.latmax > latmax) latmax = st.latmax;
+    }
+    printf("all: %d modems %d up, %d workers  pass %u (%u/s) io %u  lat max %u us  cpu %.1f%%\n",
+           gw_nmodem, up, gw_nworker, passes,
+           wallms ? (uint32_t)((uint64_t)(passes - last_passes) * 1000 / wallms) : 0,
+           iowakes, latmax, wallms ? cpus * 100000.0 / wallms : 0.0);
+    fflush(stdout);
+    last_passes = passes;
+}
+
+static double gw_cpu_sec(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static void gw_signal(int sig)
+{
+    (void)sig;
+    GW_STOP();
+}
+
+int main(int argc, char *argv[]) {
+    const char *device[GW_MODEM_MAX];
+    const char *pdn = "1,1,\"IP\",\"cmiot\",1,\"user123\",\"psw123\"";
+    uint32_t report_ms = 10000, run_ms = 0, start, last, now;
+    double cpu, cpu_last;
+    struct epoll_event ev;
+    gw_worker_t *w;
+    int opt, i, ndev = 0, nworker = 0;
+
+    while ((opt = getopt(argc, argv, "D:W:P:A:I:R:T:v")) != -1) {
+        switch (opt) {
+            case 'D':
+                if (ndev < GW_MODEM_MAX) device[ndev++] = optarg;
+                break;
+            case 'W':
+                nworker = atoi(optarg);
+                break;
+            case 'P':
+                pdn = optarg;
+                break;
+            case 'A':
+                snprintf(gw_probe_cmd, sizeof(gw_probe_cmd), "%s\r", optarg);
+                break;
+            case 'I':
+                gw_probe_ms = (uint32_t)atoi(optarg) * 1000;
+                break;
+            case 'R':
+                report_ms = (uint32_t)atoi(optarg) * 1000;
+                break;
+            case 'T':
+                run_ms = (uint32_t)atoi(optarg) * 1000;
+                break;
+            case 'v':
+                gw_verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s -D /dev/ttyXXX [-D ...] [-W workers] [-P pdn_config]"
+                        " [-A probe_command] [-I probe_interval_s] [-R report_interval_s] [-T run_time_s] [-v]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (ndev == 0) {
+        fprintf(stderr, "No device specified. Use -D option once per modem.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (nworker <= 0) nworker = (ndev + GW_MODEM_PER_WORKER - 1) / GW_MODEM_PER_WORKER;
+    if (nworker > ndev) nworker = ndev;
+    if (nworker > GW_WORKER_MAX) nworker = GW_WORKER_MAX;
+    if (report_ms == 0) report_ms = 10000;
+
+    // Logging setup of the default context, each modem context starts with a copy
+    sam_dbg_init(gw_log, NULL);
+    sam_port_serial_sel(gw_port);
+    if (gw_verbose) sam_port_debug(gw_debug);
+    if (!gw_verbose) sam_dbg_set_level(SAM_DBG_LEVEL_WARN);
+    for (i = 0; i < SAM_MOD_MAX; i++) {
+        if (!gw_verbose) sam_dbg_set_module_level((sam_module_id_e)i, SAM_DBG_LEVEL_WARN);
+    }
+
+    gw_modem = (gw_modem_t *)calloc(ndev, sizeof(gw_modem_t));
+    if (gw_modem == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < nworker; i++) {
+        w = &gw_worker[i];
+        w->id = i;
+        w->epfd = epoll_create1(0);
+        pthread_mutex_init(&w->lock, NULL);
+        if (w->epfd < 0) {
+            perror("epoll_create1");
+            return 1;
+        }
+    }
+    gw_nworker = nworker;
+    for (i = 0; i < ndev; i++) {
+        gw_modem_t *m = &gw_modem[gw_nmodem];
+        if (gw_modem_open(m, i, device[i], pdn) != 0) continue;
+        m->worker = gw_nmodem % nworker;
+        w = &gw_worker[m->worker];
+        ev.events = EPOLLIN;    // level triggered: bytes a pass left in the tty wake the worker again
+        ev.data.ptr = m;
+        if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, m->port.fd, &ev) < 0) {
+            perror("epoll_ctl");
+            serial_close(&m->port);
+            continue;
+        }
+        w->modem[w->cnt++] = m;
+        fprintf(stderr, "m%d: %s on worker %d\n", m->idx, device[i], m->worker);
+        gw_nmodem++;
+    }
+    if (gw_nmodem == 0) return 1;
+
+    signal(SIGINT, gw_signal);
+    signal(SIGTERM, gw_signal);
+    for (i = 0; i < gw_nworker; i++) {
+        pthread_create(&gw_worker[i].tid, NULL, gw_worker_run, &gw_worker[i]);
+    }
+
+    // The main thread only reports
+    start = last = GetSysTickCnt();
+    cpu_last = gw_cpu_sec();
+    while (!GW_STOPPED()) {
+        usleep(100000);
+        now = GetSysTickCnt();
+        if (run_ms != 0 && now - start >= run_ms) GW_STOP();
+        if (now - last >= report_ms || GW_STOPPED()) {
+            cpu = gw_cpu_sec();
+            gw_report(now - last, cpu - cpu_last);
+            cpu_last = cpu;
+            last = now;
+        }
+    }
+
+    for (i = 0; i < gw_nworker; i++) {
+        pthread_join(gw_worker[i].tid, NULL);
+        close(gw_worker[i].epfd);
+    }
+    for (i = 0; i < gw_nmodem; i++) serial_close(&gw_modem[i].port);
+    free(gw_modem);
+    return 0;
+}
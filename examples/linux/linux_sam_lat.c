@@ -0,0 +1,153 @@
+/*
+ * Socket RX latency under channel load.
+ *
+ * One modem, one TCP socket and optionally an MQTT client and an SMS unit sharing
+ * the AT channel with it. The peer (the emulator with EMU_RXMS set) stamps every
+ * socket message as "T<CLOCK_MONOTONIC us>\n" when it raises +CIPRXGET; the data
+ * callback takes the difference to its own clock, so a number is the time from the
+ * modem announcing data to the application holding it. At the end the run prints
+ * count, average, p50, p99 and max.
+ *
+ *   linux_sam_lat -D tty [-T secs] [-m mqtt_pub_ms] [-s sms_period_s] [-v]
+ */
+#include "serial_port.h"
+#include "sam_port.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../../SAM_ATCDRV/include.h"
+
+#define LAT_MAX     20000
+
+static serial_port_t port;
+
+static uint32_t lat_us[LAT_MAX];
+static uint32_t lat_cnt = 0;
+static char lat_line[32];           // stamp split over two reads
+static uint32_t lat_len = 0;
+
+static char lat_sockcfg[] = "\vCFGSCT_M1\t0\tA\t0\t0\t0\t1\t117.131.85.139\t60057\t0\v";
+static char lat_mqttcfg[] = "\vCFGMQTT_C1\t0\t0\t\"lat client\"\t\"tcp://test.mosquitto.org:1883\"\t\"cmd_topic\"\t\"will_topic_lat\"\t\"will_msg_lat\"\v";
+static char lat_smscfg[] = "\vCFGSMS_C1\t0\t1\t\"+8613800210500\"\v";
+static TMqttTag lat_mqtt;
+static TSmsTag lat_sms;
+
+static void lat_stamp(void)
+{
+    uint64_t sent, now;
+    lat_line[lat_len] = '\0';
+    if (lat_line[0] != 'T' || lat_cnt >= LAT_MAX) return;
+    sent = strtoull(lat_line + 1, NULL, 10);
+    now = sam_port_now_us();
+    if (sent == 0 || sent > now) return;
+    lat_us[lat_cnt++] = (uint32_t)(now - sent);
+}
+
+static void lat_data(uint8_t sid, const uint8_t *data, uint32_t len, void *ctx)
+{
+    uint32_t i;
+    (void)sid; (void)ctx;
+    for (i = 0; i < len; i++) {
+        if (data[i] == '\n') {
+            lat_stamp();
+            lat_len = 0;
+        } else if (lat_len < sizeof(lat_line) - 1) {
+            lat_line[lat_len++] = (char)data[i];
+        }
+    }
+}
+
+static void lat_event(uint8_t sid, Sam_Mdm_Socket_Event_t event, void *msg, void *ctx)
+{
+    (void)sid; (void)event; (void)msg; (void)ctx;
+}
+
+static int lat_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[])
+{
+    serial_config_t config = {
+        .baudrate = 115200,
+        .parity = 'N',
+        .data_bits = 8,
+        .stop_bits = 1,
+        .flow_control = false
+    };
+    Sam_Mdm_Socket_t *psock;
+    char *device = NULL;
+    uint32_t secs = 60, mqtt_ms = 0, sms_s = 0;
+    uint32_t start, mqtt_clk, sms_clk, pubs = 0, smss = 0;
+    uint64_t sum = 0;
+    uint32_t i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "D:T:m:s:v")) != -1) {
+        switch (opt) {
+            case 'D': device = optarg; break;
+            case 'T': secs = (uint32_t)atoi(optarg); break;
+            case 'm': mqtt_ms = (uint32_t)atoi(optarg); break;
+            case 's': sms_s = (uint32_t)atoi(optarg); break;
+            case 'v': sam_port_debug(sam_port_debug_stdout); break;
+            default:
+                fprintf(stderr, "Usage: %s -D /dev/ttyXXX [-T secs] [-m mqtt_pub_ms] [-s sms_period_s] [-v]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (device == NULL) {
+        fprintf(stderr, "No device specified. Use -D option.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!serial_init(&port, device, &config)) {
+        fprintf(stderr, "Failed to initialize serial port\n");
+        return 1;
+    }
+    sam_port_serial(&port, 0);
+
+    SamMdmSrvStart();
+    psock = Sam_Mdm_Socket_Create(NULL);
+    if (psock == NULL || !Sam_Mdm_Socket_init(psock, lat_sockcfg)) {
+        fprintf(stderr, "Socket init failed\n");
+        return 1;
+    }
+    Sam_Mdm_Socket_setCallback(psock, lat_event, lat_data, NULL);
+    if (mqtt_ms != 0 && sam_mqtt_init(&lat_mqtt, lat_mqttcfg) == NULL) mqtt_ms = 0;
+    if (sms_s != 0 && sam_sms_init(&lat_sms, lat_smscfg) == NULL) sms_s = 0;
+
+    start = mqtt_clk = sms_clk = GetSysTickCnt();
+    while (GetSysTickCnt() - start < secs * 1000) {
+        SamMdmSrvRun();
+        if (mqtt_ms != 0 && GetSysTickCnt() - mqtt_clk >= mqtt_ms) {
+            mqtt_clk = GetSysTickCnt();
+            if (sam_mqtt_get_connection_status(&lat_mqtt) == 1) {
+                char msg[24];
+                snprintf(msg, sizeof(msg), "lat%u", pubs++);
+                sam_mqtt_publish_message(&lat_mqtt, "lat_topic", msg);
+            }
+        }
+        if (sms_s != 0 && GetSysTickCnt() - sms_clk >= sms_s * 1000) {
+            char msg[24];
+            sms_clk = GetSysTickCnt();
+            snprintf(msg, sizeof(msg), "lat%u", smss++);
+            sam_sms_send_message(&lat_sms, msg, "13621615716", ENCODING_ASCII, LANG_EN);
+        }
+        serial_wait(&port, SamNextDeadlineMs());
+    }
+
+    printf("socket state %u, mqtt publishes %u, sms sends %u\n", Sam_Mdm_Socket_getState(psock), pubs, smss);
+    if (lat_cnt == 0) {
+        printf("no stamped socket data received\n");
+        return 1;
+    }
+    qsort(lat_us, lat_cnt, sizeof(lat_us[0]), lat_cmp);
+    for (i = 0; i < lat_cnt; i++) sum += lat_us[i];
+    printf("rx latency: n %u avg %.1f ms p50 %.1f ms p99 %.1f ms max %.1f ms\n", lat_cnt,
+        sum / 1000.0 / lat_cnt, lat_us[lat_cnt / 2] / 1000.0, lat_us[lat_cnt * 99 / 100] / 1000.0,
+        lat_us[lat_cnt - 1] / 1000.0);
+    serial_close(&port);
+    return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * AT response framing throughput.
+ *
+ * Feeds a canned stream of responses and unsolicited lines through SamChkAtcRet on a
+ * bare channel, no modem and no units linked. The shared port reads the stream from a
+ * temporary file with one pread per call, so every call costs a system call as a
+ * serial_read does. The stream runs twice: ReadfoCom handing out one byte per call,
+ * the way the framer read before the staging block, and up to ATRXBUFLEN bytes per
+ * call. The run prints the throughput and ReadfoCom calls of both and checks that
+ * they framed the same lines.
+ *
+ *   linux_sam_rxbench [-n rounds]
+ *
+ * Building the library with SAM_CFG=-DATRXBUFLEN=1 (after a make clean) runs the
+ * byte-wise framer loop itself for both passes.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../../SAM_ATCDRV/include.h"
+#include "sam_port.h"
+
+static HdsAtcTag bench_atc;
+
+// Time of the rounds in ns; frames counts the returned lines, sum adds up their bytes
+static uint64_t bench_run(HdsAtcTag *phatc, uint32_t rounds, uint32_t chunk, uint32_t *frames, uint32_t *sum)
+{
+    uint64_t t0;
+    uint32_t r;
+    uint8_t ret;
+
+    *frames = 0;
+    *sum = 0;
+    t0 = sam_port_now_ns();
+    for (r = 0; r < rounds; r++) {
+        sam_port_stream_rewind(chunk);
+        while (sam_port_stream_left() != 0 || phatc->rxbufh < phatc->rxbuft) {
+            ret = SamChkAtcRet(phatc, "OK\r\n\tERROR\r\n");
+            if (ret != NOSTRRET_ATCRET) {
+                (*frames)++;
+                *sum += phatc->retbufp;
+                phatc->retbufp = 0;     // taken, as a unit does after acting on it
+            }
+        }
+    }
+    return sam_port_now_ns() - t0;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *lines[] = {
+        "+CSQ: 20,99", "OK",
+        "+CPSI: LTE,Online,460-00,0x5A1E,187343875,300,EUTRAN-BAND3,1850,5,5,-94,-1089,-762,15", "OK",
+        "+CGCONTRDP: 1,5,\"cmnet\",\"10.164.6.156.255.255.255.0\",\"10.164.6.1\",\"211.136.17.107\",\"211.136.20.203\"", "OK",
+        "+CIPRXGET: 1,0",
+        "+CIPRXGET: 4,0,1460", "OK",
+        "+CMQTTRXTOPIC: 0,9", "cmd_topic",
+        "+CREG: 2,1,\"5A1E\",\"0B28A403\",7", "OK",
+        "ERROR",
+    };
+    char stream[1024];
+    HdsAtcTag *phatc;
+    uint32_t len = 0, rounds = 2000, i;
+    uint32_t bframes, bsum, kframes, ksum, bcalls, kcalls;
+    uint64_t bns, kns;
+    double mb;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n': rounds = (uint32_t)atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-n rounds]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (rounds == 0) rounds = 1;
+
+    for (i = 0; i < sizeof(lines) / sizeof(lines[0]); i++) {
+        len += sprintf(&stream[len], "\r\n%s\r\n", lines[i]);
+    }
+    if (!sam_port_stream(stream, len, true)) {
+        fprintf(stderr, "Cannot write the stream file\n");
+        return 1;
+    }
+
+    phatc = SamAtcInit(&bench_atc, ATCCH_A);
+    phatc->type = CRLF_HATCTYP;     // line framing, as left by the last command sent
+
+    bcalls = sam_port_stream_reads();
+    bns = bench_run(phatc, rounds, 1, &bframes, &bsum);
+    bcalls = sam_port_stream_reads() - bcalls;
+    kcalls = sam_port_stream_reads();
+    kns = bench_run(phatc, rounds, ATRXBUFLEN, &kframes, &ksum);
+    kcalls = sam_port_stream_reads() - kcalls;
+
+    mb = (double)len * rounds / (1024.0 * 1024.0);
+    printf("%u bytes x %u rounds, ATRXBUFLEN %u, %u lines framed\n", len, rounds, ATRXBUFLEN, kframes);
+    printf("byte reads:  %.2f MB/s, %u ReadfoCom calls\n", mb * 1e9 / bns, bcalls);
+    printf("block reads: %.2f MB/s, %u ReadfoCom calls (%.1fx)\n", mb * 1e9 / kns, kcalls, (double)bns / kns);
+    if (bframes != kframes || bsum != ksum) {
+        printf("FAIL: framed %u lines/%u bytes byte-wise, %u lines/%u bytes by block\n", bframes, bsum, kframes, ksum);
+        return 1;
+    }
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "serial_port.h"
+#include "sam_port.h"
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/time.h>
@@ -19,33 +20,61 @@ void msleep(unsigned int milliseconds) {
     nanosleep(&ts, NULL);
 }
 
-unsigned int GetSysTickCnt()
+// -w: bytes the port takes per write at most, like a small UART FIFO, 0: no limit
+static unsigned short tx_max = 0;
+
+// File keeping the modem warm start record, NULL: full bring-up on every start
+static const char *warm_file = NULL;
+
+unsigned short WarmStore(unsigned char wr, void *dp, unsigned short dlen)
 {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+	FILE *fp;
+	size_t n;
+	fp = fopen(warm_file, wr ? "wb" : "rb");
+	if(fp == NULL) return 0;
+	n = wr ? fwrite(dp, 1, dlen, fp) : fread(dp, 1, dlen, fp);
+	fclose(fp);
+	return (unsigned short)n;
+}
+
+// Highest rate and RTS/CTS from -B and -F, the modem switches to them after it answers
+static int link_max = 0;
+static bool link_flow = false;
+
+unsigned char LinkSet(unsigned long baud, unsigned char flow, unsigned char apply)
+{
+	if (!apply) return serial_baud_supported((int)baud) ? 1 : 0;
+	fprintf(stderr, "UART %lu baud, RTS/CTS %s\n", baud, flow ? "on" : "off");
+	return serial_set_line(&port, (int)baud, flow != 0) ? 1 : 0;
 }
 
-unsigned short SendtoCom(unsigned char com, char *dp, unsigned short dlen)
+// PSM/eDRX and uplink batching from -W "tau_s,active_s,edrx_ms,window_ms"
+static char *pwr_cfg = NULL;
+static unsigned int pwr_batches = 0;
+
+void PwrReport(void)
 {
-	if(com == ATCCH_A)
-	{
-		serial_write(&port , (const uint8_t *)dp,(uint32_t)dlen);
-	}
-	else if(com == DBGCH_A)
-	{
-		printf("%s",dp);
-	}
-
-	return 0;
+	SamPwrStatTag stat;
+	if (SamMdmSrvCmd(MDMCMD_GETPWRSTAT, NULL, &stat) != RETCHAR_TRUE || stat.batches == pwr_batches) return;
+	pwr_batches = stat.batches;
+	printf("PWR sends %u batches %u wakes %u/%u radio %u/%u ms held max %u ms\n", stat.sends, stat.batches,
+		stat.wakes, stat.vwakes, stat.radioms, stat.vradioms, stat.holdms);
 }
 
-unsigned short ReadfoCom(unsigned char com, char *dp,  unsigned short dmax)
+// User AT commands from -A, queued once the modem has an IP
+#define USER_ATC_MAX 4
+static char user_cmd[USER_ATC_MAX][128];
+static AtcReqTag user_req[USER_ATC_MAX];
+static int user_cnt = 0;
+
+void UserAtcSink(void *pd, AtcReqTag *preq, unsigned char ret, char *line)
 {
-	unsigned short len=0;
-    (void)com; // Unused parameter, can be used for different commands in the future
-	len= serial_read(&port,(uint8_t *)dp , (uint32_t)dmax);
-	return len;
+	int i = (int)(long)pd;
+	if (ret == NOSTRRET_ATCRET || ret == PARTLINE_ATCRET)
+		printf("USER AT%d: %s%s", i, line, (ret == PARTLINE_ATCRET) ? " ...\n" : "");
+	else
+		printf("USER AT%d done: %u\n", i, ret);
+	(void)preq;
 }
 
 /* USER CODE END 0 */
@@ -63,13 +92,38 @@ int main(int argc, char *argv[]) {
     char *device = NULL;
     int opt;
 
-    while ((opt = getopt(argc, argv, "D:")) != -1) {
+    while ((opt = getopt(argc, argv, "D:S:A:B:FW:w:")) != -1) {
         switch (opt) {
             case 'D':
                 device = optarg;
                 break;
+            case 'S':
+                warm_file = optarg;
+                break;
+            case 'A':
+                if (user_cnt < USER_ATC_MAX) {
+                    snprintf(user_cmd[user_cnt], sizeof(user_cmd[0]), "%s\r", optarg);
+                    user_req[user_cnt].cmd = user_cmd[user_cnt];
+                    user_req[user_cnt].timwm = 10;
+                    user_req[user_cnt].pcb = UserAtcSink;
+                    user_req[user_cnt].pd = (void *)(long)user_cnt;
+                    user_cnt++;
+                }
+                break;
+            case 'B':
+                link_max = atoi(optarg);
+                break;
+            case 'F':
+                link_flow = true;
+                break;
+            case 'W':
+                pwr_cfg = optarg;
+                break;
+            case 'w':
+                tx_max = (unsigned short)atoi(optarg);
+                break;
             default:
-                fprintf(stderr, "Usage: %s -D /dev/ttyXXX\n", argv[0]);
+                fprintf(stderr, "Usage: %s -D /dev/ttyXXX [-S warm_start_file] [-A at_command ...] [-B max_baud] [-F] [-W tau,active,edrx_ms,window_ms] [-w max_write]\n", argv[0]);
                 exit(EXIT_FAILURE);
         }
     }
@@ -86,11 +140,24 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "Failed to initialize serial port\n");
         return 1;
     }
+    sam_port_serial(&port, tx_max);
+    sam_port_debug(sam_port_debug_stdout);
     
+	if (warm_file != NULL) SamMdmSrvSetStore(WarmStore);
+	if (link_max > config.baudrate || link_flow)
+		SamMdmSrvSetLink(LinkSet, config.baudrate, (link_max > config.baudrate) ? link_max : config.baudrate, link_flow ? 1 : 0);
 	TesterInit();
+	if (pwr_cfg != NULL && SamMdmSrvCmd(MDMCMD_CFGPWR, pwr_cfg, NULL) != RETCHAR_TRUE)
+		fprintf(stderr, "Bad -W %s\n", pwr_cfg);
     while (1) {
         TesterProc();
-        msleep(1); // 1ms delay
+        if (pwr_cfg != NULL) PwrReport();
+        if (user_cnt > 0 && SamMdmSrvCmd(MDMCMD_CHKMDMIP, NULL, NULL) == RETCHAR_MDMIPOK) {
+            for (int i = 0; i < user_cnt; i++) SamMdmSrvCmd(MDMCMD_USERATC, &user_req[i], NULL);
+            user_cnt = 0;
+        }
+        // Sleep until the modem sends data or the driver has a timer due
+        serial_wait(&port, SamNextDeadlineMs());
     }
     
     // Clean up
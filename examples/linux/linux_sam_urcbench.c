@@ -0,0 +1,116 @@
+/*
+ * URC routing cost on one AT channel.
+ *
+ * Links several sockets and two MQTT clients to the first channel, the way an
+ * application does, then feeds a canned stream of unsolicited lines through
+ * SamChkAtcRet with the shared port reading it from memory. Each round carries one
+ * "+CIPRXGET: 1,<id>" per socket and two lines no unit owns, which end at the
+ * modem. The same stream runs twice: routed by the channel prefix trie, and with
+ * the trie switched off so every line goes to every URC handler as it did before
+ * the units declared their prefixes. No modem or serial port is needed.
+ *
+ *   linux_sam_urcbench [-s sockets] [-m mqtt_clients] [-n rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../../SAM_ATCDRV/include.h"
+#include "sam_port.h"
+
+#define BENCH_SOCK_MAX  10
+#define BENCH_MQTT_MAX  2
+
+static char bench_stream[4096];
+
+static TMqttTag bench_mqtt[BENCH_MQTT_MAX];
+
+static void bench_event(uint8_t sid, Sam_Mdm_Socket_Event_t event, void *msg, void *ctx)
+{
+    (void)sid; (void)event; (void)msg; (void)ctx;
+}
+
+static void bench_data(uint8_t sid, const uint8_t *data, uint32_t len, void *ctx)
+{
+    (void)sid; (void)data; (void)len; (void)ctx;
+}
+
+// Nanoseconds per line over the rounds, the stream replayed each round
+static double bench_run(HdsAtcTag *phatc, uint32_t rounds, uint32_t lines)
+{
+    uint64_t t0;
+    uint32_t r;
+
+    t0 = sam_port_now_ns();
+    for (r = 0; r < rounds; r++) {
+        sam_port_stream_rewind(0);
+        while (sam_port_stream_left() != 0 || phatc->rxbufh < phatc->rxbuft) {
+            if (SamChkAtcRet(phatc, "OK\r\n") == RETURNSR_ATCRET) {
+                phatc->retbufp = 0;     // a line nobody took, dropped as the modem unit does
+            }
+        }
+    }
+    return (double)(sam_port_now_ns() - t0) / ((double)rounds * lines);
+}
+
+int main(int argc, char *argv[])
+{
+    Sam_Mdm_Socket_t *psock;
+    HdsAtcTag *phatc;
+    uint32_t socks = 8, mqtts = 2, rounds = 20000, len = 0, lines, i;
+    uint16_t urcmsk;
+    double trie, bcast;
+    char cfg[160];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:m:n:")) != -1) {
+        switch (opt) {
+            case 's': socks = (uint32_t)atoi(optarg); break;
+            case 'm': mqtts = (uint32_t)atoi(optarg); break;
+            case 'n': rounds = (uint32_t)atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-s sockets] [-m mqtt_clients] [-n rounds]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (socks > BENCH_SOCK_MAX) socks = BENCH_SOCK_MAX;
+    if (mqtts > BENCH_MQTT_MAX) mqtts = BENCH_MQTT_MAX;
+    if (rounds == 0) rounds = 1;
+
+    SamMdmSrvStart();
+    phatc = pAtcBusArray[0];
+    for (i = 0; i < socks; i++) {
+        snprintf(cfg, sizeof(cfg), "\vCFGSCT_M1\t0\tA\t%u\t0\t0\t1\t117.131.85.139\t60057\t0\v", i);
+        psock = Sam_Mdm_Socket_Create(NULL);
+        if (psock == NULL || !Sam_Mdm_Socket_init(psock, cfg)) {
+            fprintf(stderr, "Socket %u init failed\n", i);
+            return 1;
+        }
+        Sam_Mdm_Socket_setCallback(psock, bench_event, bench_data, NULL);
+    }
+    for (i = 0; i < mqtts; i++) {
+        snprintf(cfg, sizeof(cfg), "\vCFGMQTT_C1\t0\t%u\t\"bench%u\"\t\"tcp://test.mosquitto.org:1883\"\t\"cmd_topic\"\t\"will_topic\"\t\"will_msg\"\v", i, i);
+        if (sam_mqtt_init(&bench_mqtt[i], cfg) == NULL) {
+            fprintf(stderr, "MQTT client %u init failed\n", i);
+            return 1;
+        }
+    }
+
+    for (i = 0; i < socks; i++) {
+        len += sprintf(&bench_stream[len], "\r\n+CIPRXGET: 1,%u\r\n", i);
+    }
+    len += sprintf(&bench_stream[len], "\r\n+CSQ: 20,99\r\n\r\n+CPSI: LTE,Online,460-00,0x5A1E,187343875,300,EUTRAN-BAND3,1850,5,5,-94,-1089,-762,15\r\n");
+    sam_port_stream(bench_stream, len, false);
+    lines = socks + 2;
+    phatc->type = CRLF_HATCTYP;     // line framing, as left by the last command sent
+
+    trie = bench_run(phatc, rounds, lines);
+    urcmsk = phatc->urcmsk;
+    phatc->urcmsk = 0;      // every line to every URC handler
+    bcast = bench_run(phatc, rounds, lines);
+    phatc->urcmsk = urcmsk;
+
+    printf("%u sockets, %u mqtt clients, %u lines x %u rounds\n", socks, mqtts, lines, rounds);
+    printf("broadcast %.0f ns/line, prefix trie %.0f ns/line (%.1fx)\n", bcast, trie, bcast / trie);
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "sam_port.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "../../SAM_ATCDRV/include.h"
+
+static bool port_vclk = false;              // GetSysTickCnt on the virtual clock
+static uint32_t port_vms = 0;
+
+static serial_port_t *port_sp = NULL;
+static serial_port_t *(*port_sel)(void) = NULL;
+static unsigned short port_txmax = 0;
+
+static const char *port_stm = NULL;         // stream read from memory
+static FILE *port_stmfp = NULL;             // or from this file, one pread per read
+static uint32_t port_stmlen = 0;
+static uint32_t port_stmpos = 0;
+static uint32_t port_stmchunk = 0;
+static uint32_t port_stmreads = 0;
+
+static void (*port_dbg)(const char *dp, unsigned short dlen) = NULL;
+
+void sam_port_clock_set(uint32_t ms)
+{
+    port_vms = ms;
+    port_vclk = true;
+}
+
+uint64_t sam_port_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint64_t sam_port_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+unsigned int GetSysTickCnt()
+{
+    if (port_vclk) return port_vms;
+    return (unsigned int)(sam_port_now_us() / 1000);
+}
+
+unsigned int GetSysUsCnt()
+{
+    if (port_vclk) return port_vms * 1000;
+    return (unsigned int)sam_port_now_us();
+}
+
+void sam_port_serial(serial_port_t *port, unsigned short tx_max)
+{
+    port_sp = port;
+    port_txmax = tx_max;
+}
+
+void sam_port_serial_sel(serial_port_t *(*sel)(void))
+{
+    port_sel = sel;
+}
+
+bool sam_port_stream(const char *dp, uint32_t len, bool file)
+{
+    if (port_stmfp != NULL) fclose(port_stmfp);
+    port_stmfp = NULL;
+    port_stm = NULL;
+    port_stmlen = 0;
+    if (file) {
+        port_stmfp = tmpfile();
+        if (port_stmfp == NULL) return false;
+        if (fwrite(dp, 1, len, port_stmfp) != len || fflush(port_stmfp) != 0) {
+            fclose(port_stmfp);
+            port_stmfp = NULL;
+            return false;
+        }
+    } else {
+        port_stm = dp;
+    }
+    port_stmlen = len;
+    port_stmpos = 0;
+    port_stmreads = 0;
+    return true;
+}
+
+void sam_port_stream_rewind(uint32_t chunk)
+{
+    port_stmpos = 0;
+    port_stmchunk = chunk;
+}
+
+uint32_t sam_port_stream_left(void)
+{
+    return port_stmlen - port_stmpos;
+}
+
+uint32_t sam_port_stream_reads(void)
+{
+    return port_stmreads;
+}
+
+void sam_port_debug(void (*out)(const char *dp, unsigned short dlen))
+{
+    port_dbg = out;
+}
+
+void sam_port_debug_stdout(const char *dp, unsigned short dlen)
+{
+    fwrite(dp, 1, dlen, stdout);
+}
+
+// Serial port of the AT channel for the calling thread, NULL: none
+static serial_port_t *port_serial_cur(void)
+{
+    return (port_sel != NULL) ? port_sel() : port_sp;
+}
+
+unsigned short SendtoCom(unsigned char com, char *dp, unsigned short dlen)
+{
+    serial_port_t *sp;
+    int n;
+
+    if (com == DBGCH_A) {
+        if (port_dbg != NULL) port_dbg(dp, dlen);
+        return dlen;
+    }
+    if (com != ATCCH_A) return 0;
+    sp = port_serial_cur();
+    if (sp == NULL) return dlen;    // stream or no modem: nothing goes out
+    if (port_txmax != 0 && dlen > port_txmax) dlen = port_txmax;
+    n = serial_write(sp, (const uint8_t *)dp, (uint32_t)dlen);
+    if (n < 0) n = 0;   // the driver resumes what was not taken
+    return (unsigned short)n;
+}
+
+unsigned short ReadfoCom(unsigned char com, char *dp, unsigned short dmax)
+{
+    serial_port_t *sp;
+    uint32_t m;
+    ssize_t n;
+
+    if (com != ATCCH_A) return 0;
+    sp = port_serial_cur();
+    if (sp != NULL) {
+        n = serial_read(sp, (uint8_t *)dp, (uint32_t)dmax);
+        return (n > 0) ? (unsigned short)n : 0;
+    }
+    if (port_stm == NULL && port_stmfp == NULL) return 0;
+    port_stmreads++;
+    m = port_stmlen - port_stmpos;
+    if (m > dmax) m = dmax;
+    if (port_stmchunk != 0 && m > port_stmchunk) m = port_stmchunk;
+    if (port_stmfp != NULL) {
+        n = pread(fileno(port_stmfp), dp, m, port_stmpos);
+        if (n <= 0) return 0;
+    } else {
+        memcpy(dp, &port_stm[port_stmpos], m);
+        n = m;
+    }
+    port_stmpos += (uint32_t)n;
+    return (unsigned short)n;
+}
@@ -0,0 +1,99 @@
+#ifndef SAM_PORT_H
+#define SAM_PORT_H
+
+/*
+ * Host port of the driver shared by the Linux examples: GetSysTickCnt, GetSysUsCnt,
+ * SendtoCom and ReadfoCom. A program chooses where the AT channel goes (a serial
+ * port, a canned stream or nowhere) and what becomes of the debug channel; the
+ * functions the driver calls stay the same in every program.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "serial_port.h"
+
+/**
+ * @brief Microsecond clock, provided whether or not the library options ask for it
+ */
+unsigned int GetSysUsCnt(void);
+
+/**
+ * @brief Run GetSysTickCnt and GetSysUsCnt on a virtual clock
+ *
+ * Until the first call both read CLOCK_MONOTONIC. From then on they return the
+ * time of the last call, GetSysUsCnt in whole milliseconds.
+ *
+ * @param ms Virtual time in milliseconds
+ */
+void sam_port_clock_set(uint32_t ms);
+
+/**
+ * @brief CLOCK_MONOTONIC in microseconds, 64 bits, the virtual clock does not apply
+ */
+uint64_t sam_port_now_us(void);
+
+/**
+ * @brief CLOCK_MONOTONIC in nanoseconds, 64 bits, the virtual clock does not apply
+ */
+uint64_t sam_port_now_ns(void);
+
+/**
+ * @brief Put the AT channel on a serial port
+ * @param port Open serial port
+ * @param tx_max Bytes taken per SendtoCom at most, like a small UART FIFO, 0: no limit
+ */
+void sam_port_serial(serial_port_t *port, unsigned short tx_max);
+
+/**
+ * @brief Put the AT channel on the serial port of the calling thread
+ *
+ * For programs running several modems: sel returns the port of the modem whose
+ * context runs on the calling thread, NULL when there is none, and the channel
+ * then reads nothing and drops what is sent.
+ *
+ * @param sel Port of the calling thread
+ */
+void sam_port_serial_sel(serial_port_t *(*sel)(void));
+
+/**
+ * @brief Put the AT channel on a canned stream, what is sent is dropped
+ *
+ * With file set the stream is copied to a temporary file and each ReadfoCom costs
+ * one pread, as a serial_read costs a read; otherwise it is copied from memory and
+ * must stay valid while it is read.
+ *
+ * @param dp Stream data
+ * @param len Stream length
+ * @param file Read through a temporary file
+ * @return true on success, false if the file could not be written
+ */
+bool sam_port_stream(const char *dp, uint32_t len, bool file);
+
+/**
+ * @brief Restart the stream from its first byte
+ * @param chunk Bytes handed out per ReadfoCom at most, 0: no limit
+ */
+void sam_port_stream_rewind(uint32_t chunk);
+
+/**
+ * @brief Bytes of the stream not read yet
+ */
+uint32_t sam_port_stream_left(void);
+
+/**
+ * @brief ReadfoCom calls on the stream since it was set
+ */
+uint32_t sam_port_stream_reads(void);
+
+/**
+ * @brief Route the debug channel
+ * @param out Called with each trace, NULL: traces are formatted but dropped
+ */
+void sam_port_debug(void (*out)(const char *dp, unsigned short dlen));
+
+/**
+ * @brief Debug output writing the traces to stdout as they come
+ */
+void sam_port_debug_stdout(const char *dp, unsigned short dlen);
+
+#endif // SAM_PORT_H
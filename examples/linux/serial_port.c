@@ -7,6 +7,7 @@
 #include <termios.h>
 #include <errno.h>
 #include <sys/ioctl.h>
+#include <poll.h>
 
 // Internal function prototypes
 static bool init_ringbuffer(ringbuffer_t *rb, uint32_t size);
@@ -15,6 +16,7 @@ static uint32_t ringbuffer_available(ringbuffer_t *rb);
 static uint32_t ringbuffer_free(ringbuffer_t *rb);
 static uint32_t ringbuffer_write(ringbuffer_t *rb, const uint8_t *data, uint32_t length);
 static uint32_t ringbuffer_read(ringbuffer_t *rb, uint8_t *data, uint32_t length);
+static bool baud_to_speed(int baudrate, speed_t *speed);
 static bool configure_serial_port(serial_port_t *port);
 
 /**
@@ -133,6 +135,35 @@ static uint32_t ringbuffer_read(ringbuffer_t *rb, uint8_t *data, uint32_t length
     return length;
 }
 
+/**
+ * @brief Map a baud rate to its termios speed
+ * @param baudrate Baud rate
+ * @param speed Receives the termios speed
+ * @return true if the rate is supported, false otherwise
+ */
+static bool baud_to_speed(int baudrate, speed_t *speed) {
+    switch (baudrate) {
+        case 9600:   *speed = B9600;   break;
+        case 19200:  *speed = B19200;  break;
+        case 38400:  *speed = B38400;  break;
+        case 57600:  *speed = B57600;  break;
+        case 115200: *speed = B115200; break;
+        case 230400: *speed = B230400; break;
+        case 460800: *speed = B460800; break;
+        case 921600: *speed = B921600; break;
+#ifdef B4000000
+        case 1000000: *speed = B1000000; break;
+        case 1500000: *speed = B1500000; break;
+        case 2000000: *speed = B2000000; break;
+        case 3000000: *speed = B3000000; break;
+        case 4000000: *speed = B4000000; break;
+#endif
+        default:
+            return false;
+    }
+    return true;
+}
+
 /**
  * @brief Configure serial port with specified parameters
  * @param port Pointer to serial port structure
@@ -149,18 +180,9 @@ static bool configure_serial_port(serial_port_t *port) {
     
     // Set input/output baud rate
     speed_t baud;
-    switch (port->config.baudrate) {
-        case 9600:   baud = B9600;   break;
-        case 19200:  baud = B19200;  break;
-        case 38400:  baud = B38400;  break;
-        case 57600:  baud = B57600;  break;
-        case 115200: baud = B115200; break;
-        case 230400: baud = B230400; break;
-        case 460800: baud = B460800; break;
-        case 921600: baud = B921600; break;
-        default:
-            fprintf(stderr, "Unsupported baud rate\n");
-            return false;
+    if (!baud_to_speed(port->config.baudrate, &baud)) {
+        fprintf(stderr, "Unsupported baud rate\n");
+        return false;
     }
     cfsetispeed(&options, baud);
     cfsetospeed(&options, baud);
@@ -283,6 +305,45 @@ bool serial_init(serial_port_t *port, const char *port_name, const serial_config
     }
     
     port->is_open = true;
+    port->rx_unread = 0;
+    return true;
+}
+
+/**
+ * @brief Check whether a baud rate is supported
+ * @param baudrate Baud rate
+ * @return true if supported, false otherwise
+ */
+bool serial_baud_supported(int baudrate) {
+    speed_t speed;
+    return baud_to_speed(baudrate, &speed);
+}
+
+/**
+ * @brief Change baud rate and flow control of an open port
+ * @param port Pointer to serial port structure
+ * @param baudrate New baud rate
+ * @param flow_control Hardware flow control enabled/disabled
+ * @return true on success, false if the port keeps its settings
+ */
+bool serial_set_line(serial_port_t *port, int baudrate, bool flow_control) {
+    serial_config_t old = port->config;
+
+    if (!port->is_open) {
+        return false;
+    }
+
+    // Pending output goes out at the old rate
+    serial_flush(port);
+    tcdrain(port->fd);
+
+    port->config.baudrate = baudrate;
+    port->config.flow_control = flow_control;
+    if (!configure_serial_port(port)) {
+        port->config = old;
+        configure_serial_port(port);
+        return false;
+    }
     return true;
 }
 
@@ -437,4 +498,48 @@ void serial_flush(serial_port_t *port) {
             port->tx_buffer.tail -= port->tx_buffer.size;
         }
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Wait until received data is available or the timeout passes
+ * @param port Pointer to serial port structure
+ * @param timeout_ms Maximum time to wait in milliseconds, 0 to only check
+ * @return 1 if data is available, 0 on timeout, -1 on error
+ */
+int serial_wait(serial_port_t *port, uint32_t timeout_ms) {
+    if (!port->is_open) {
+        return -1;
+    }
+
+    if (ringbuffer_available(&port->rx_buffer) > 0) {
+        return 1;
+    }
+
+    // Bytes the application did not read since the last call only count on timeout
+    int pending = 0;
+    if (ioctl(port->fd, FIONREAD, &pending) < 0) {
+        pending = 0;
+    }
+    bool unread = (pending > 0 && (uint32_t)pending == port->rx_unread);
+    port->rx_unread = (uint32_t)pending;
+
+    struct pollfd pfd;
+    pfd.fd = port->fd;
+    pfd.events = unread ? 0 : POLLIN;
+    if (ringbuffer_available(&port->tx_buffer) > 0) {
+        pfd.events |= POLLOUT;
+    }
+
+    int ret = poll(&pfd, 1, (int)timeout_ms);
+    if (ret < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        perror("poll failed");
+        return -1;
+    }
+    if (ret > 0 && (pfd.revents & POLLOUT)) {
+        serial_flush(port);
+    }
+    return (ret > 0 && (pfd.revents & POLLIN)) ? 1 : 0;
+}
@@ -29,6 +29,7 @@ typedef struct {
     ringbuffer_t rx_buffer;      // Receive ring buffer
     ringbuffer_t tx_buffer;      // Transmit ring buffer
     bool is_open;               // Flag indicating if port is open
+    uint32_t rx_unread;         // Bytes the port held at the last serial_wait
 } serial_port_t;
 
 /**
@@ -40,6 +41,25 @@ typedef struct {
  */
 bool serial_init(serial_port_t *port, const char *port_name, const serial_config_t *config);
 
+/**
+ * @brief Check whether a baud rate is supported
+ * @param baudrate Baud rate
+ * @return true if supported, false otherwise
+ */
+bool serial_baud_supported(int baudrate);
+
+/**
+ * @brief Change baud rate and flow control of an open port
+ *
+ * Buffered transmit data is sent at the old rate first.
+ *
+ * @param port Pointer to serial port structure
+ * @param baudrate New baud rate
+ * @param flow_control Hardware flow control enabled/disabled
+ * @return true on success, false if the port keeps its settings
+ */
+bool serial_set_line(serial_port_t *port, int baudrate, bool flow_control);
+
 /**
  * @brief Close serial port and free resources
  * @param port Pointer to serial port structure
@@ -77,4 +97,16 @@ uint32_t serial_available(serial_port_t *port);
  */
 void serial_flush(serial_port_t *port);
 
+/**
+ * @brief Wait until received data is available or the timeout passes
+ *
+ * Buffered transmit data is flushed while waiting. Bytes left unread since the
+ * last call do not end the wait again, so the caller does not spin on them.
+ *
+ * @param port Pointer to serial port structure
+ * @param timeout_ms Maximum time to wait in milliseconds, 0 to only check
+ * @return 1 if data is available, 0 on timeout, -1 on error
+ */
+int serial_wait(serial_port_t *port, uint32_t timeout_ms);
+
 #endif // SERIAL_PORT_H
\ No newline at end of file
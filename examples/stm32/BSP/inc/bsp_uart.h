@@ -6,10 +6,11 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stddef.h>
 
 void    bsp_uart_init(void);
-void    bsp_usart_write(const char* str , uint32_t len);
-uint32_t  bsp_usart_read(const char* str,uint32_t len);
+size_t  bsp_usart_write(const char* str , size_t len);
+size_t  bsp_usart_read(const char* str,size_t len);
 #ifdef __cplusplus
 }
 #endif
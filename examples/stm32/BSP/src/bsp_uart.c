@@ -24,7 +24,6 @@ extern UART_HandleTypeDef huart3;
 void    usart_init(void);
 void    usart_rx_check(void);
 void    usart_process_data(const void* data, size_t len);
-void    bsp_usart_write(const char* str , size_t len);
 uint8_t usart_start_tx_dma_transfer(void);
 
 /**
@@ -263,11 +262,13 @@ usart_process_data(const void* data, size_t len) {
 /**
  * \brief           Send data over USART
  * \param[in]       str: date to send
+ * \return          Number of bytes taken by the transmit buffer
  */
-void
+size_t
 bsp_usart_write(const char* str,size_t len) {
-    lwrb_write(&usart_tx_rb, str, len);   /* Write data to transmit buffer */
+    size_t n = lwrb_write(&usart_tx_rb, str, len);   /* Write data to transmit buffer */
     usart_start_tx_dma_transfer();
+    return n;
 }
 
 /**
@@ -100,19 +100,35 @@ unsigned int GetSysTickCnt()
 	return HAL_GetTick();
 }
 
+/**
+ * @brief Get system time in us, from the tick count and the SysTick counter.
+ * 
+ */
+unsigned int GetSysUsCnt()
+{
+	unsigned int ms, val;
+	do
+	{//read again if the tick went on in between
+		ms = HAL_GetTick();
+		val = SysTick->VAL;
+	}while(ms != HAL_GetTick());
+	return ms * 1000 + (SysTick->LOAD - val) / (SystemCoreClock / 1000000);
+}
+
 unsigned short SendtoCom(unsigned char com, char *dp, unsigned short dlen)
 {
-	
+	unsigned short n = 0;
 	if(com == ATCCH_A)
 	{
-		bsp_usart_write(dp,dlen);
+		n = (unsigned short)bsp_usart_write(dp,dlen);	// bytes the TX ring took, the driver resumes the rest
 	}
 	else if(com == DBGCH_A)
 	{
 		printf("%s",dp);
+		n = dlen;
 	}
 
-	return 0;
+	return n;
 }
 
 unsigned short ReadfoCom(unsigned char com, char *dp,  unsigned short dmax)
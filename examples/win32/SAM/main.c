@@ -134,6 +134,16 @@ unsigned int GetSysTickCnt(void)
 	return(cms);
 }
 
+unsigned int GetSysUsCnt(void)
+{
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER cnt;
+	if(freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&cnt);
+	//whole seconds and the remainder apart, cnt * 1000000 overflows after some days of uptime
+	return((unsigned int)((cnt.QuadPart / freq.QuadPart) * 1000000 + (cnt.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart));
+}
+
 unsigned int SaLHalGetMsCnt(unsigned int stms)
 {
     unsigned int   cms;